@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Host collector for the binary record streams of many scanners
+ *
+ * The main thread reads every source (serial port, pty, RTT telnet port or a
+ * file being replayed) through epoll and cuts the streams into records (see
+ * struct rid_record_hdr in src/rid_output.h). Records travel in batches: the
+ * main thread fills a batch, a pool of workers decodes it with the
+ * firmware's own ODID decoder, and the merge thread folds it into a single
+ * time-ordered stream. Copies of the same transmission heard by several
+ * scanners become one observation carrying the RSSI seen by each of them.
+ *
+ * Batches come from a fixed pool, so a slow consumer stalls the reader
+ * instead of growing memory.
+ */
+
+#ifndef COLLECTOR_H_
+#define COLLECTOR_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "odid_decoder.h"
+
+#define RECORD_SYNC          0xA5
+#define RECORD_FRAME         1
+#define RECORD_ALERT         2
+#define RECORD_HDR_SIZE      12
+#define RECORD_ALERT_SIZE    22
+#define RECORD_MAX_LEN       2304     // longest 802.11 frame body, as in scripts/rid_decode.py
+
+#define MAX_SOURCES          64
+#define BATCH_RECORDS        64
+#define BATCH_DATA           (32 * 1024)
+#define BATCH_POOL           128
+#define GROUP_MAX_SENSORS    8
+
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+
+/* One record cut from a source stream; the payload lives in the batch. */
+struct record {
+	int64_t time;           // ms on the common timeline
+	uint32_t offset;        // payload offset in batch data
+	uint16_t len;
+	uint8_t type;           // RECORD_FRAME or RECORD_ALERT
+	int8_t rssi;
+	uint8_t channel;
+};
+
+#define OBS_ID        0x01    // uas_id is set
+#define OBS_LOCATION  0x02    // latitude .. vertical_speed are set
+#define OBS_OPERATOR  0x04    // operator_latitude and operator_longitude are set
+
+/* What a worker decoded out of one record. */
+struct obs {
+	int64_t time;
+	uint32_t key;           // frames: message counter; alerts: ALERT_KEY()
+	uint16_t source;
+	uint8_t type;
+	uint8_t flags;          // OBS_*
+	int8_t rssi;
+	uint8_t channel;
+	uint8_t mac[6];
+	char uas_id[ODID_ID_SIZE + 1];
+	int32_t latitude;       // 1e-7 degrees
+	int32_t longitude;
+	int32_t altitude;       // decimetres, geodetic if known, else pressure altitude
+	uint16_t speed;         // cm/s
+	uint16_t direction;     // degrees
+	int16_t vertical_speed; // cm/s
+	int32_t operator_latitude;
+	int32_t operator_longitude;
+	uint8_t event;          // alerts only: enum rid_geofence_event_type
+	uint8_t subject;        // alerts only: enum rid_geofence_subject
+	uint16_t zone;          // alerts only
+};
+
+#define ALERT_KEY(event, subject, zone) \
+	(0x80000000U | ((uint32_t)(event) << 24) | ((uint32_t)(subject) << 16) | (zone))
+
+struct batch {
+	struct batch *next;     // queue link
+	uint16_t source;
+	bool last;              // the source has ended; no batches follow this one
+	uint32_t seq;           // per source, so the merge thread can restore order
+	int64_t high;           // latest record time in the batch
+	uint32_t count;         // records
+	uint32_t used;          // payload bytes
+	uint32_t nobs;          // observations decoded
+	uint32_t other;         // frames without ODID
+	struct record rec[BATCH_RECORDS];
+	struct obs obs[BATCH_RECORDS];
+	uint8_t data[BATCH_DATA];
+};
+
+struct queue {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct batch *head;
+	struct batch *tail;
+	bool closed;
+};
+
+void queue_init(struct queue *q);
+
+void queue_put(struct queue *q, struct batch *b);
+
+/* Take the oldest batch, waiting up to timeout_ms (forever if negative).
+ * Returns NULL on timeout, or once the queue is closed and empty.
+ */
+struct batch *queue_get(struct queue *q, int timeout_ms);
+
+/* Wake every waiter; queue_get() returns NULL once the queue runs empty. */
+void queue_close(struct queue *q);
+
+struct source_stats {
+	uint64_t records;
+	uint64_t bytes;
+	uint64_t resyncs;       // bytes skipped to find the next record boundary
+};
+
+struct collector {
+	const char *names[MAX_SOURCES];
+	unsigned int nsources;
+	unsigned int workers;
+	bool replay;            // every source is a file
+	bool json;
+	bool quiet;             // decode and merge but print nothing
+	bool align;             // replay: start every file at time 0
+	unsigned int repeat;    // replay: read every file this many times
+	int window_ms;          // live: longest a record waits for slower sources
+	int coalesce_ms;        // copies of a frame this far apart are merged
+	int baud;
+	int64_t epoch_ms;       // unix time of timeline 0, for printing
+
+	struct queue pool;      // free batches
+	struct queue work;      // batches to decode
+	struct queue merged;    // decoded batches
+
+	struct source_stats source_stats[MAX_SOURCES];
+};
+
+/* Monotonic milliseconds, the timeline of live sources. */
+int64_t now_ms(void);
+
+/* Open every source and read them until all have ended or stop is set.
+ * Returns 0, or -errno if a source could not be opened.
+ */
+int sources_open(struct collector *c, char *const *specs, unsigned int count);
+void sources_run(struct collector *c, volatile const int *stop);
+
+int workers_start(struct collector *c);
+void workers_join(void);
+
+struct merge_stats {
+	uint64_t observations;
+	uint64_t other;         // frames without ODID
+	uint64_t alerts;
+	uint64_t groups;        // merged observations printed
+	uint64_t shared;        // groups heard by more than one sensor
+	uint64_t late;          // observations older than what was already printed
+	uint64_t drones;        // distinct MAC addresses
+};
+
+int merge_start(struct collector *c);
+void merge_join(struct merge_stats *stats);
+
+#endif /* COLLECTOR_H_ */
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "collector.h"
+
+static const char usage[] =
+	"usage: rid_collector [options] [name=]source...\n"
+	"\n"
+	"Merge the binary record streams of several scanners into one time-ordered\n"
+	"stream of observations, keyed by UAS ID, with the RSSI seen by each scanner.\n"
+	"A source is a serial port or pty, tcp:HOST:PORT (J-Link RTT telnet), or a\n"
+	"record or capture file, which is replayed as fast as it can be decoded.\n"
+	"\n"
+	"  -j, --json          print JSON lines instead of text\n"
+	"  -q, --quiet         print nothing but the summary\n"
+	"  -w, --workers N     decode threads (default: one less than the CPUs)\n"
+	"      --window MS     longest a live record waits for other sources (500)\n"
+	"      --coalesce MS   copies of a frame this far apart are merged (100)\n"
+	"      --baud N        serial port speed (1000000)\n"
+	"      --repeat N      replay every file N times\n"
+	"      --no-align      replay files on their recorded timestamps instead of\n"
+	"                      starting all of them together\n"
+	"      --bench         report records per second and per CPU second\n";
+
+static volatile int stop;
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stop = 1;
+}
+
+int64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static double cpu_seconds(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+
+	return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+	       (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option options[] = {
+		{ "json", no_argument, NULL, 'j' },
+		{ "quiet", no_argument, NULL, 'q' },
+		{ "workers", required_argument, NULL, 'w' },
+		{ "window", required_argument, NULL, 'W' },
+		{ "coalesce", required_argument, NULL, 'C' },
+		{ "baud", required_argument, NULL, 'b' },
+		{ "repeat", required_argument, NULL, 'r' },
+		{ "no-align", no_argument, NULL, 'A' },
+		{ "bench", no_argument, NULL, 'B' },
+		{ "help", no_argument, NULL, 'h' },
+		{ 0 },
+	};
+	static struct collector c = {
+		.align = true,
+		.repeat = 1,
+		.window_ms = 500,
+		.coalesce_ms = 100,
+		.baud = 1000000,
+	};
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	bool bench = false;
+	int opt;
+
+	c.workers = cpus > 1 ? cpus - 1 : 1;
+	while ((opt = getopt_long(argc, argv, "jqw:h", options, NULL)) != -1) {
+		switch (opt) {
+		case 'j':
+			c.json = true;
+			break;
+		case 'q':
+			c.quiet = true;
+			break;
+		case 'w':
+			c.workers = atoi(optarg) > 0 ? atoi(optarg) : 1;
+			break;
+		case 'W':
+			c.window_ms = atoi(optarg);
+			break;
+		case 'C':
+			c.coalesce_ms = atoi(optarg);
+			break;
+		case 'b':
+			c.baud = atoi(optarg);
+			break;
+		case 'r':
+			c.repeat = atoi(optarg) > 0 ? atoi(optarg) : 1;
+			break;
+		case 'A':
+			c.align = false;
+			break;
+		case 'B':
+			bench = true;
+			break;
+		default:
+			fputs(usage, opt == 'h' ? stdout : stderr);
+			return opt == 'h' ? 0 : 2;
+		}
+	}
+	if (optind == argc) {
+		fputs(usage, stderr);
+		return 2;
+	}
+
+	queue_init(&c.pool);
+	queue_init(&c.work);
+	queue_init(&c.merged);
+	for (int i = 0; i < BATCH_POOL; i++) {
+		struct batch *b = malloc(sizeof(*b));
+
+		if (b == NULL) {
+			return 1;
+		}
+		queue_put(&c.pool, b);
+	}
+
+	if (sources_open(&c, &argv[optind], argc - optind) < 0) {
+		return 1;
+	}
+	if (!c.replay) {
+		struct timespec ts;
+
+		// live timestamps are printed as unix time, replayed ones from the start
+		clock_gettime(CLOCK_REALTIME, &ts);
+		c.epoch_ms = (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000 - now_ms();
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+
+	int64_t start = now_ms();
+	double cpu_start = cpu_seconds();
+	int err = workers_start(&c);
+
+	if (err == 0) {
+		err = merge_start(&c);
+	}
+	if (err) {
+		fprintf(stderr, "cannot start threads: %s\n", strerror(-err));
+		return 1;
+	}
+
+	sources_run(&c, &stop);
+	queue_close(&c.work);
+	workers_join();
+
+	struct merge_stats ms;
+
+	merge_join(&ms);
+
+	double elapsed = (now_ms() - start) / 1000.0;
+	double cpu = cpu_seconds() - cpu_start;
+	uint64_t records = 0;
+	uint64_t bytes = 0;
+	uint64_t resyncs = 0;
+
+	for (unsigned int i = 0; i < c.nsources; i++) {
+		records += c.source_stats[i].records;
+		bytes += c.source_stats[i].bytes;
+		resyncs += c.source_stats[i].resyncs;
+	}
+
+	fprintf(stderr, "%llu records (%.1f MB) from %u sources in %.2f s, %llu bytes skipped\n",
+		(unsigned long long)records, bytes / 1e6, c.nsources, elapsed,
+		(unsigned long long)resyncs);
+	fprintf(stderr, "%llu observations, %llu alerts, %llu frames without ODID\n",
+		(unsigned long long)ms.observations, (unsigned long long)ms.alerts,
+		(unsigned long long)ms.other);
+	fprintf(stderr, "%llu merged, %llu heard by more than one sensor, %llu late, %llu drones\n",
+		(unsigned long long)ms.groups, (unsigned long long)ms.shared,
+		(unsigned long long)ms.late, (unsigned long long)ms.drones);
+	for (unsigned int i = 0; i < c.nsources; i++) {
+		fprintf(stderr, "  %s: %llu records, %llu bytes skipped\n", c.names[i],
+			(unsigned long long)c.source_stats[i].records,
+			(unsigned long long)c.source_stats[i].resyncs);
+	}
+	if (bench && elapsed > 0 && cpu > 0) {
+		fprintf(stderr, "bench: %.0f records/s, %.0f records/s per core "
+			"(%.2f cpu s, %u workers)\n",
+			records / elapsed, records / cpu, cpu, c.workers);
+	}
+
+	return 0;
+}
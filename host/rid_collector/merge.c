@@ -0,0 +1,459 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* The merge thread puts the decoded batches of each source back in order,
+ * folds copies of one transmission into a group (same transmitter, same
+ * message counter, within the coalescing window) and prints groups in time
+ * order once no source can still deliver anything older: every source has
+ * moved past them, or, for live sources, the window has run out.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "collector.h"
+
+#define HASH_BUCKETS  4096      // power of two
+#define DRONE_SLOTS   8192      // power of two
+
+struct group {
+	struct group *hash_next;
+	uint64_t order;         // arrival, breaks ties between equal times
+	struct obs obs;         // the first copy, with gaps filled from later ones
+	uint8_t nsensors;
+	struct {
+		uint16_t source;
+		int8_t rssi;
+		uint8_t channel;
+	} sensors[GROUP_MAX_SENSORS];
+};
+
+struct drone {
+	bool used;
+	uint8_t mac[6];
+	char uas_id[ODID_ID_SIZE + 1];
+};
+
+struct merge_source {
+	uint32_t next_seq;
+	int64_t watermark;      // latest time delivered in order
+	bool ended;
+	struct batch *pending[BATCH_POOL];  // arrived ahead of next_seq
+};
+
+static struct merge_source msrc[MAX_SOURCES];
+static struct collector *col;
+static pthread_t thread;
+static struct merge_stats stats;
+static unsigned int ended;
+
+static struct group *buckets[HASH_BUCKETS];
+static struct group **heap;
+static size_t heap_len;
+static size_t heap_cap;
+static struct group *free_groups;
+static uint64_t arrivals;
+static int64_t printed_time = INT64_MIN;
+
+static struct drone drones[DRONE_SLOTS];
+
+static const char *const events[] = { "?", "ENTER", "EXIT", "BREACH" };
+static const char *const subjects[] = { "UA", "operator" };
+
+static uint32_t hash_of(const uint8_t mac[6], uint32_t key)
+{
+	uint32_t h = odid_le32(&mac[2]) ^ (key * 0x9E3779B1U);
+
+	h ^= h >> 15;
+	h *= 0x85EBCA6BU;
+	h ^= h >> 13;
+
+	return h;
+}
+
+static bool before(const struct group *a, const struct group *b)
+{
+	return a->obs.time < b->obs.time || (a->obs.time == b->obs.time && a->order < b->order);
+}
+
+static void heap_push(struct group *g)
+{
+	if (heap_len == heap_cap) {
+		heap_cap = heap_cap ? heap_cap * 2 : 1024;
+		heap = realloc(heap, heap_cap * sizeof(*heap));
+		if (heap == NULL) {
+			abort();
+		}
+	}
+
+	size_t i = heap_len++;
+
+	while (i > 0 && before(g, heap[(i - 1) / 2])) {
+		heap[i] = heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	heap[i] = g;
+}
+
+static struct group *heap_pop(void)
+{
+	struct group *top = heap[0];
+	struct group *last = heap[--heap_len];
+	size_t i = 0;
+
+	for (;;) {
+		size_t child = 2 * i + 1;
+
+		if (child >= heap_len) {
+			break;
+		}
+		if (child + 1 < heap_len && before(heap[child + 1], heap[child])) {
+			child++;
+		}
+		if (!before(heap[child], last)) {
+			break;
+		}
+		heap[i] = heap[child];
+		i = child;
+	}
+	if (heap_len > 0) {
+		heap[i] = last;
+	}
+
+	return top;
+}
+
+static struct drone *drone_slot(const uint8_t mac[6])
+{
+	uint32_t h = hash_of(mac, 0);
+
+	for (uint32_t n = 0; n < DRONE_SLOTS; n++) {
+		struct drone *d = &drones[(h + n) & (DRONE_SLOTS - 1)];
+
+		if (!d->used || memcmp(d->mac, mac, 6) == 0) {
+			return d;
+		}
+	}
+
+	return NULL;  // table full; IDs of further drones are not remembered
+}
+
+static void add_sensor(struct group *g, const struct obs *o)
+{
+	for (unsigned int i = 0; i < g->nsensors; i++) {
+		if (g->sensors[i].source == o->source) {
+			if (o->rssi > g->sensors[i].rssi) {
+				g->sensors[i].rssi = o->rssi;
+			}
+			return;
+		}
+	}
+	if (g->nsensors < GROUP_MAX_SENSORS) {
+		g->sensors[g->nsensors].source = o->source;
+		g->sensors[g->nsensors].rssi = o->rssi;
+		g->sensors[g->nsensors].channel = o->channel;
+		g->nsensors++;
+	}
+}
+
+static void add_obs(const struct obs *o)
+{
+	uint32_t h = hash_of(o->mac, o->key) & (HASH_BUCKETS - 1);
+	struct group *g;
+
+	stats.observations++;
+	if (o->type == RECORD_ALERT) {
+		stats.alerts++;
+	}
+	if (o->time < printed_time) {
+		stats.late++;
+	}
+
+	for (g = buckets[h]; g != NULL; g = g->hash_next) {
+		if (g->obs.key == o->key && memcmp(g->obs.mac, o->mac, 6) == 0 &&
+		    llabs(g->obs.time - o->time) <= col->coalesce_ms) {
+			break;
+		}
+	}
+
+	if (g == NULL) {
+		g = free_groups;
+		if (g != NULL) {
+			free_groups = g->hash_next;
+		} else {
+			g = malloc(sizeof(*g));
+			if (g == NULL) {
+				abort();
+			}
+		}
+		g->obs = *o;
+		g->order = arrivals++;
+		g->nsensors = 0;
+		g->hash_next = buckets[h];
+		buckets[h] = g;
+		heap_push(g);
+	} else {
+		// a copy may have been cut short where another one was not
+		uint8_t missing = o->flags & ~g->obs.flags;
+
+		if (missing & OBS_ID) {
+			memcpy(g->obs.uas_id, o->uas_id, sizeof(o->uas_id));
+		}
+		if (missing & OBS_LOCATION) {
+			g->obs.latitude = o->latitude;
+			g->obs.longitude = o->longitude;
+			g->obs.altitude = o->altitude;
+			g->obs.speed = o->speed;
+			g->obs.direction = o->direction;
+			g->obs.vertical_speed = o->vertical_speed;
+		}
+		if (missing & OBS_OPERATOR) {
+			g->obs.operator_latitude = o->operator_latitude;
+			g->obs.operator_longitude = o->operator_longitude;
+		}
+		g->obs.flags |= missing;
+	}
+	add_sensor(g, o);
+}
+
+static void unlink_group(struct group *g)
+{
+	struct group **p = &buckets[hash_of(g->obs.mac, g->obs.key) & (HASH_BUCKETS - 1)];
+
+	while (*p != g) {
+		p = &(*p)->hash_next;
+	}
+	*p = g->hash_next;
+	g->hash_next = free_groups;
+	free_groups = g;
+}
+
+static void print_text(FILE *out, double t, const struct obs *o, const char *id,
+		       const struct group *g)
+{
+	char mac[18];
+
+	snprintf(mac, sizeof(mac), "%02x:%02x:%02x:%02x:%02x:%02x",
+		 o->mac[0], o->mac[1], o->mac[2], o->mac[3], o->mac[4], o->mac[5]);
+
+	if (o->type == RECORD_ALERT) {
+		fprintf(out, "%.3f  %-20s  %s  %-7s zone %u %s  %.7f %.7f  %.1f m",
+			t, id, mac, events[o->event < ARRAY_SIZE(events) ? o->event : 0], o->zone,
+			o->subject < ARRAY_SIZE(subjects) ? subjects[o->subject] : "?",
+			o->latitude / 1e7, o->longitude / 1e7, o->altitude / 10.0);
+	} else {
+		fprintf(out, "%.3f  %-20s  %s  #%-3u", t, id, mac, o->key);
+		if (o->flags & OBS_LOCATION) {
+			fprintf(out, "  %.7f %.7f  %.1f m  %.2f m/s %3u deg",
+				o->latitude / 1e7, o->longitude / 1e7, o->altitude / 10.0,
+				o->speed / 100.0, o->direction);
+		}
+		if (o->flags & OBS_OPERATOR) {
+			fprintf(out, "  op %.7f %.7f",
+				o->operator_latitude / 1e7, o->operator_longitude / 1e7);
+		}
+	}
+	for (unsigned int i = 0; i < g->nsensors; i++) {
+		fputs(i ? ", " : "  | ", out);
+		fputs(col->names[g->sensors[i].source], out);
+		// an alert is raised by the scanner, not received, so it has no RSSI
+		if (o->type == RECORD_FRAME) {
+			fprintf(out, " %d dBm ch %u", g->sensors[i].rssi, g->sensors[i].channel);
+		}
+	}
+	fputc('\n', out);
+}
+
+static void print_json(FILE *out, double t, const struct obs *o, const char *id,
+		       const struct group *g)
+{
+	fprintf(out, "{\"t\":%.3f,\"id\":\"%s\",\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\"",
+		t, id, o->mac[0], o->mac[1], o->mac[2], o->mac[3], o->mac[4], o->mac[5]);
+	if (o->type == RECORD_ALERT) {
+		fprintf(out, ",\"alert\":\"%s\",\"subject\":\"%s\",\"zone\":%u",
+			events[o->event < ARRAY_SIZE(events) ? o->event : 0],
+			o->subject < ARRAY_SIZE(subjects) ? subjects[o->subject] : "?", o->zone);
+	} else {
+		fprintf(out, ",\"counter\":%u", o->key);
+	}
+	if (o->flags & OBS_LOCATION) {
+		fprintf(out, ",\"lat\":%.7f,\"lon\":%.7f,\"alt\":%.1f",
+			o->latitude / 1e7, o->longitude / 1e7, o->altitude / 10.0);
+		if (o->type == RECORD_FRAME) {
+			fprintf(out, ",\"speed\":%.2f,\"dir\":%u,\"vspeed\":%.2f",
+				o->speed / 100.0, o->direction, o->vertical_speed / 100.0);
+		}
+	}
+	if (o->flags & OBS_OPERATOR) {
+		fprintf(out, ",\"op_lat\":%.7f,\"op_lon\":%.7f",
+			o->operator_latitude / 1e7, o->operator_longitude / 1e7);
+	}
+	fputs(",\"sensors\":[", out);
+	for (unsigned int i = 0; i < g->nsensors; i++) {
+		fprintf(out, "%s{\"name\":\"%s\"", i ? "," : "", col->names[g->sensors[i].source]);
+		if (o->type == RECORD_FRAME) {
+			fprintf(out, ",\"rssi\":%d,\"ch\":%u", g->sensors[i].rssi,
+				g->sensors[i].channel);
+		}
+		fputc('}', out);
+	}
+	fputs("]}\n", out);
+}
+
+static void emit(struct group *g)
+{
+	const struct obs *o = &g->obs;
+	struct drone *d = drone_slot(o->mac);
+	const char *id = "-";
+
+	// groups without a Basic ID take the last one their transmitter sent
+	if (d != NULL) {
+		if (!d->used) {
+			d->used = true;
+			memcpy(d->mac, o->mac, 6);
+			d->uas_id[0] = '\0';
+			stats.drones++;
+		}
+		if (o->flags & OBS_ID) {
+			memcpy(d->uas_id, o->uas_id, sizeof(d->uas_id));
+		}
+		if (d->uas_id[0] != '\0') {
+			id = d->uas_id;
+		}
+	} else if (o->flags & OBS_ID) {
+		id = o->uas_id;
+	}
+
+	stats.groups++;
+	if (g->nsensors > 1) {
+		stats.shared++;
+	}
+	if (o->time > printed_time) {
+		printed_time = o->time;
+	}
+	if (col->quiet) {
+		return;
+	}
+
+	double t = (double)(col->epoch_ms + o->time) / 1000.0;
+
+	if (col->json) {
+		print_json(stdout, t, o, id, g);
+	} else {
+		print_text(stdout, t, o, id, g);
+	}
+}
+
+/* Print every group at or before limit. */
+static void emit_until(int64_t limit)
+{
+	while (heap_len > 0 && heap[0]->obs.time <= limit) {
+		struct group *g = heap_pop();
+
+		emit(g);
+		unlink_group(g);
+	}
+}
+
+static int64_t ready_limit(void)
+{
+	int64_t low = INT64_MAX;
+
+	for (unsigned int i = 0; i < col->nsources; i++) {
+		if (!msrc[i].ended && msrc[i].watermark < low) {
+			low = msrc[i].watermark;
+		}
+	}
+	if (low == INT64_MAX) {
+		return low;
+	}
+	// a copy from a slower source may still join a group this recent
+	if (low != INT64_MIN) {
+		low -= col->coalesce_ms;
+	}
+
+	// live sources that fall silent hold nothing up for longer than the window
+	if (!col->replay && now_ms() - col->window_ms > low) {
+		low = now_ms() - col->window_ms;
+	}
+
+	return low;
+}
+
+static void absorb(struct batch *b)
+{
+	struct merge_source *st = &msrc[b->source];
+
+	stats.other += b->other;
+	for (uint32_t i = 0; i < b->nobs; i++) {
+		add_obs(&b->obs[i]);
+	}
+	if (b->high > st->watermark) {
+		st->watermark = b->high;
+	}
+	if (b->last) {
+		st->ended = true;
+		ended++;
+	}
+	queue_put(&col->pool, b);
+}
+
+static void *merge(void *arg)
+{
+	(void)arg;
+
+	while (ended < col->nsources) {
+		struct batch *b = queue_get(&col->merged, col->replay ? -1 : 50);
+
+		if (b != NULL) {
+			uint16_t source = b->source;
+
+			// workers finish batches out of order; hold them until their turn
+			if (b->seq != msrc[source].next_seq) {
+				msrc[source].pending[b->seq % BATCH_POOL] = b;
+				continue;
+			}
+			while (b != NULL) {
+				absorb(b);
+				msrc[source].next_seq++;
+				b = msrc[source].pending[msrc[source].next_seq % BATCH_POOL];
+				msrc[source].pending[msrc[source].next_seq % BATCH_POOL] = NULL;
+			}
+		}
+		emit_until(ready_limit());
+		if (!col->replay) {
+			fflush(stdout);
+		}
+	}
+	emit_until(INT64_MAX);
+	fflush(stdout);
+
+	return NULL;
+}
+
+int merge_start(struct collector *c)
+{
+	col = c;
+	for (unsigned int i = 0; i < c->nsources; i++) {
+		msrc[i].watermark = INT64_MIN;
+	}
+
+	return -pthread_create(&thread, NULL, merge, NULL);
+}
+
+void merge_join(struct merge_stats *out)
+{
+	pthread_join(thread, NULL);
+	while (free_groups != NULL) {
+		struct group *g = free_groups;
+
+		free_groups = g->hash_next;
+		free(g);
+	}
+	free(heap);
+	*out = stats;
+}
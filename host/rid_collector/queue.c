@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <time.h>
+
+#include "collector.h"
+
+void queue_init(struct queue *q)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&q->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	pthread_mutex_init(&q->lock, NULL);
+	q->head = NULL;
+	q->tail = NULL;
+	q->closed = false;
+}
+
+void queue_put(struct queue *q, struct batch *b)
+{
+	b->next = NULL;
+	pthread_mutex_lock(&q->lock);
+	if (q->tail != NULL) {
+		q->tail->next = b;
+	} else {
+		q->head = b;
+	}
+	q->tail = b;
+	pthread_cond_signal(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+}
+
+struct batch *queue_get(struct queue *q, int timeout_ms)
+{
+	struct timespec deadline;
+	struct batch *b;
+
+	if (timeout_ms >= 0) {
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += timeout_ms / 1000;
+		deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+	}
+
+	pthread_mutex_lock(&q->lock);
+	while (q->head == NULL && !q->closed) {
+		if (timeout_ms < 0) {
+			pthread_cond_wait(&q->cond, &q->lock);
+		} else if (pthread_cond_timedwait(&q->cond, &q->lock, &deadline) != 0) {
+			break;
+		}
+	}
+	b = q->head;
+	if (b != NULL) {
+		q->head = b->next;
+		if (q->head == NULL) {
+			q->tail = NULL;
+		}
+	}
+	pthread_mutex_unlock(&q->lock);
+
+	return b;
+}
+
+void queue_close(struct queue *q)
+{
+	pthread_mutex_lock(&q->lock);
+	q->closed = true;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+}
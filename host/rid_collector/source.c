@@ -0,0 +1,512 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "collector.h"
+
+#define CAPTURE_MAGIC     "RIDC"
+#define CAPTURE_HDR_SIZE  8
+
+// a stream buffer always has room for a read on top of one partial record
+#define READ_CHUNK        (16 * 1024)
+#define STREAM_BUF        (READ_CHUNK + RECORD_HDR_SIZE + RECORD_MAX_LEN)
+
+// bytes of a replayed file cut per turn, so that files interleave like live streams
+#define FILE_CHUNK        (64 * 1024)
+
+// a device clock stepping back further than this has restarted
+#define REBOOT_MS         1000
+
+struct source {
+	const char *path;
+	int fd;
+	bool file;
+	bool capture;           // file in the capture format of src/rid_capture.h
+	bool ended;
+
+	uint8_t *map;           // files are read whole
+	size_t size;
+	size_t pos;
+	unsigned int pass;
+	uint32_t capture_time;  // device time rebuilt from capture deltas
+
+	uint8_t buf[STREAM_BUF];
+	size_t fill;
+
+	bool synced;
+	int64_t offset;         // timeline minus device time
+	int64_t base;           // replay: where the current pass starts on the timeline
+	int64_t last;           // latest timeline value handed out
+	uint32_t last_dev;
+
+	struct batch *cur;
+	uint32_t seq;
+};
+
+static struct source sources[MAX_SOURCES];
+static int epfd = -1;
+static unsigned int active;
+
+static const struct {
+	int baud;
+	speed_t speed;
+} bauds[] = {
+	{ 115200, B115200 }, { 230400, B230400 }, { 460800, B460800 },
+	{ 921600, B921600 }, { 1000000, B1000000 }, { 2000000, B2000000 },
+};
+
+static uint8_t channel_of(uint16_t freq)
+{
+	if (freq == 2484) {
+		return 14;
+	}
+	if (freq >= 2412 && freq < 2484) {
+		return (freq - 2407) / 5;
+	}
+	if (freq >= 5000 && freq < 5900) {
+		return (freq - 5000) / 5;
+	}
+	return 0;
+}
+
+/* Map a device timestamp onto the common timeline. Live sources follow the
+ * host clock: the smallest host-minus-device difference seen so far is the
+ * one with the least transport delay in it. Replayed files start at the
+ * beginning of their pass. Within a source, time never runs backwards.
+ */
+static int64_t timeline(struct collector *c, struct source *s, uint32_t dev, int64_t host)
+{
+	if (s->synced && (int64_t)dev + REBOOT_MS < s->last_dev) {
+		s->synced = false;
+		s->base = s->last + 1;
+	}
+	s->last_dev = dev;
+
+	if (c->replay) {
+		if (!s->synced) {
+			s->offset = (c->align || s->pass > 0) ? s->base - dev : 0;
+		}
+	} else if (!s->synced || host - dev < s->offset) {
+		s->offset = host - dev;
+	}
+	s->synced = true;
+
+	int64_t t = dev + s->offset;
+
+	if (t < s->last) {
+		t = s->last;
+	}
+	s->last = t;
+
+	return t;
+}
+
+static struct batch *take_batch(struct collector *c, struct source *s)
+{
+	struct batch *b = queue_get(&c->pool, -1);
+
+	b->source = s - sources;
+	b->seq = s->seq++;
+	b->last = false;
+	b->high = s->last;
+	b->count = 0;
+	b->used = 0;
+	s->cur = b;
+
+	return b;
+}
+
+static void submit(struct collector *c, struct source *s, bool last)
+{
+	struct batch *b = s->cur != NULL ? s->cur : take_batch(c, s);
+
+	b->last = last;
+	s->cur = NULL;
+	queue_put(&c->work, b);
+}
+
+static void append_record(struct collector *c, struct source *s, uint8_t type, int64_t time,
+			  int8_t rssi, uint8_t channel, const uint8_t *payload, uint16_t len)
+{
+	struct batch *b = s->cur;
+	struct source_stats *st = &c->source_stats[s - sources];
+
+	if (b != NULL && (b->count == BATCH_RECORDS || b->used + len > BATCH_DATA)) {
+		submit(c, s, false);
+		b = NULL;
+	}
+	if (b == NULL) {
+		b = take_batch(c, s);
+	}
+
+	struct record *r = &b->rec[b->count++];
+
+	r->time = time;
+	r->offset = b->used;
+	r->len = len;
+	r->type = type;
+	r->rssi = rssi;
+	r->channel = channel;
+	memcpy(&b->data[b->used], payload, len);
+	b->used += len;
+	b->high = time;
+
+	st->records++;
+	st->bytes += len;
+}
+
+/* Cut the records out of a stream of struct rid_record_hdr framed records,
+ * resynchronising on the sync byte like scripts/rid_decode.py. Returns the
+ * number of bytes consumed; a partial record at the end is left alone.
+ */
+static size_t cut_records(struct collector *c, struct source *s, const uint8_t *p, size_t len,
+			  int64_t host)
+{
+	struct source_stats *st = &c->source_stats[s - sources];
+	size_t pos = 0;
+
+	while (len - pos >= RECORD_HDR_SIZE) {
+		const uint8_t *h = &p[pos];
+
+		if (h[0] != RECORD_SYNC) {
+			const uint8_t *sync = memchr(h, RECORD_SYNC, len - pos);
+			size_t skip = sync != NULL ? (size_t)(sync - h) : len - pos;
+
+			st->resyncs += skip;
+			pos += skip;
+			continue;
+		}
+
+		uint16_t rlen = odid_le16(&h[2]);
+
+		if ((h[1] != RECORD_FRAME && h[1] != RECORD_ALERT) || rlen > RECORD_MAX_LEN) {
+			// not a record boundary; skip this sync byte and look for the next one
+			st->resyncs++;
+			pos++;
+			continue;
+		}
+		if (len - pos < RECORD_HDR_SIZE + (size_t)rlen) {
+			break;
+		}
+		append_record(c, s, h[1], timeline(c, s, odid_le32(&h[4]), host), (int8_t)h[8],
+			      h[9], &h[RECORD_HDR_SIZE], rlen);
+		pos += RECORD_HDR_SIZE + rlen;
+	}
+
+	return pos;
+}
+
+static bool get_varint(const uint8_t *p, size_t len, size_t *pos, uint32_t *value)
+{
+	*value = 0;
+	for (unsigned int n = 0; n < 5 && *pos < len; n++) {
+		uint8_t b = p[(*pos)++];
+
+		*value |= (uint32_t)(b & 0x7F) << (7 * n);
+		if (!(b & 0x80)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Cut the records out of a capture (see src/rid_capture.h). */
+static size_t cut_capture(struct collector *c, struct source *s, const uint8_t *p, size_t len)
+{
+	size_t done = 0;
+
+	while (done < len) {
+		size_t pos = done;
+		uint32_t delta;
+		uint32_t flen;
+
+		if (!get_varint(p, len, &pos, &delta) || len - pos < 3) {
+			break;
+		}
+		int8_t rssi = (int8_t)p[pos];
+		uint16_t freq = odid_le16(&p[pos + 1]);
+
+		pos += 3;
+		if (!get_varint(p, len, &pos, &flen) || len - pos < flen) {
+			break;
+		}
+		if (flen > RECORD_MAX_LEN) {
+			c->source_stats[s - sources].resyncs += len - done;
+			return len;
+		}
+		s->capture_time += delta;
+		append_record(c, s, RECORD_FRAME, timeline(c, s, s->capture_time, 0), rssi,
+			      channel_of(freq), &p[pos], (uint16_t)flen);
+		done = pos + flen;
+	}
+
+	return done;
+}
+
+static void end_source(struct collector *c, struct source *s)
+{
+	if (s->ended) {
+		return;
+	}
+	s->ended = true;
+	active--;
+	if (s->fd >= 0) {
+		close(s->fd);
+		s->fd = -1;
+	}
+	submit(c, s, true);
+}
+
+static void read_stream(struct collector *c, struct source *s)
+{
+	ssize_t n = read(s->fd, &s->buf[s->fill], sizeof(s->buf) - s->fill);
+
+	if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+		return;
+	}
+	if (n <= 0) {
+		// a pty whose other end has gone away reports EIO
+		if (n < 0 && errno != EIO) {
+			fprintf(stderr, "%s: %s\n", s->path, strerror(errno));
+		}
+		end_source(c, s);
+		return;
+	}
+	s->fill += n;
+
+	size_t used = cut_records(c, s, s->buf, s->fill, now_ms());
+
+	memmove(s->buf, &s->buf[used], s->fill - used);
+	s->fill -= used;
+}
+
+static void read_file(struct collector *c, struct source *s)
+{
+	size_t left = s->size - s->pos;
+	size_t len = left < FILE_CHUNK ? left : FILE_CHUNK;
+	const uint8_t *p = &s->map[s->pos];
+	size_t used = s->capture ? cut_capture(c, s, p, len) : cut_records(c, s, p, len, 0);
+
+	s->pos += used;
+	if (used > 0) {
+		return;
+	}
+	if (len == FILE_CHUNK) {
+		// no record fits in a whole chunk, so the rest of the file is not a capture
+		c->source_stats[s - sources].resyncs += left;
+	}
+
+	// whatever is left is a partial record; start the next pass right after this one
+	s->pass++;
+	if (s->pass >= c->repeat) {
+		end_source(c, s);
+		return;
+	}
+	s->pos = s->capture ? CAPTURE_HDR_SIZE : 0;
+	s->capture_time = 0;
+	s->synced = false;
+	s->base = s->last + 1;
+}
+
+static int open_file(struct source *s)
+{
+	struct stat st;
+	int fd = open(s->path, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		return -errno;
+	}
+	s->size = st.st_size;
+	s->map = malloc(s->size ? s->size : 1);
+	if (s->map == NULL) {
+		close(fd);
+		return -ENOMEM;
+	}
+	for (size_t got = 0; got < s->size;) {
+		ssize_t n = read(fd, &s->map[got], s->size - got);
+
+		if (n <= 0) {
+			close(fd);
+			return n < 0 ? -errno : -EIO;
+		}
+		got += n;
+	}
+	close(fd);
+
+	s->file = true;
+	if (s->size >= CAPTURE_HDR_SIZE && memcmp(s->map, CAPTURE_MAGIC, 4) == 0) {
+		s->capture = true;
+		s->pos = CAPTURE_HDR_SIZE;
+	}
+
+	return 0;
+}
+
+static int open_tcp(struct source *s, const char *target)
+{
+	char host[256];
+	const char *port = strrchr(target, ':');
+	struct addrinfo hints = { .ai_socktype = SOCK_STREAM };
+	struct addrinfo *res;
+
+	if (port == NULL || (size_t)(port - target) >= sizeof(host)) {
+		return -EINVAL;
+	}
+	memcpy(host, target, port - target);
+	host[port - target] = '\0';
+	if (getaddrinfo(host, port + 1, &hints, &res) != 0) {
+		return -EHOSTUNREACH;
+	}
+
+	int err = -ECONNREFUSED;
+
+	for (struct addrinfo *ai = res; ai != NULL; ai = ai->ai_next) {
+		s->fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (s->fd < 0) {
+			continue;
+		}
+		if (connect(s->fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+			err = 0;
+			break;
+		}
+		err = -errno;
+		close(s->fd);
+		s->fd = -1;
+	}
+	freeaddrinfo(res);
+
+	return err;
+}
+
+static int open_device(struct source *s, int baud)
+{
+	struct termios tio;
+
+	s->fd = open(s->path, O_RDONLY | O_NOCTTY);
+	if (s->fd < 0) {
+		return -errno;
+	}
+	if (tcgetattr(s->fd, &tio) < 0) {
+		return 0;  // a FIFO or similar, nothing to set up
+	}
+	cfmakeraw(&tio);
+	for (size_t i = 0; i < ARRAY_SIZE(bauds); i++) {
+		if (bauds[i].baud == baud) {
+			cfsetspeed(&tio, bauds[i].speed);
+		}
+	}
+	tcsetattr(s->fd, TCSANOW, &tio);
+
+	return 0;
+}
+
+int sources_open(struct collector *c, char *const *specs, unsigned int count)
+{
+	unsigned int files = 0;
+
+	if (count > MAX_SOURCES) {
+		fprintf(stderr, "at most %d sources\n", MAX_SOURCES);
+		return -EINVAL;
+	}
+	epfd = epoll_create1(0);
+	if (epfd < 0) {
+		return -errno;
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		struct source *s = &sources[i];
+		char *eq = strchr(specs[i], '=');
+		struct stat st;
+		int err;
+
+		// "name=path", or just the path, which then also names the source
+		s->path = eq != NULL ? eq + 1 : specs[i];
+		if (eq != NULL) {
+			*eq = '\0';
+		}
+		c->names[i] = specs[i];
+		s->fd = -1;
+
+		if (strncmp(s->path, "tcp:", 4) == 0) {
+			err = open_tcp(s, s->path + 4);
+		} else if (stat(s->path, &st) == 0 && S_ISREG(st.st_mode)) {
+			err = open_file(s);
+			files++;
+		} else {
+			err = open_device(s, c->baud);
+		}
+		if (err) {
+			fprintf(stderr, "%s: %s\n", s->path, strerror(-err));
+			return err;
+		}
+
+		if (s->fd >= 0) {
+			struct epoll_event ev = { .events = EPOLLIN, .data.u32 = i };
+
+			fcntl(s->fd, F_SETFL, fcntl(s->fd, F_GETFL) | O_NONBLOCK);
+			if (epoll_ctl(epfd, EPOLL_CTL_ADD, s->fd, &ev) < 0) {
+				return -errno;
+			}
+		}
+	}
+
+	// a replayed file has no host time to line up with a live stream
+	if (files > 0 && files < count) {
+		fprintf(stderr, "files and live sources cannot be mixed\n");
+		return -EINVAL;
+	}
+	c->nsources = count;
+	c->replay = files > 0;
+	active = count;
+
+	return 0;
+}
+
+void sources_run(struct collector *c, volatile const int *stop)
+{
+	struct epoll_event events[MAX_SOURCES];
+
+	while (active > 0 && !*stop) {
+		if (!c->replay) {
+			int n = epoll_wait(epfd, events, ARRAY_SIZE(events), 100);
+
+			for (int i = 0; i < n; i++) {
+				read_stream(c, &sources[events[i].data.u32]);
+			}
+		}
+
+		for (unsigned int i = 0; i < c->nsources; i++) {
+			struct source *s = &sources[i];
+
+			if (s->ended) {
+				continue;
+			}
+			if (s->file) {
+				read_file(c, s);
+			} else if (s->cur != NULL && s->cur->count > 0) {
+				// live records do not wait for a batch to fill up
+				submit(c, s, false);
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < c->nsources; i++) {
+		end_source(c, &sources[i]);
+		free(sources[i].map);
+	}
+	close(epfd);
+}
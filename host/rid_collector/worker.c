@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "collector.h"
+#include "odid_locate.h"
+
+// transmitter address of a management frame
+#define WLAN_SA_OFFSET 10
+
+static pthread_t threads[64];
+static unsigned int thread_count;
+
+static void copy_id(char *dst, const uint8_t *src)
+{
+	size_t i;
+
+	// IDs are NUL padded ASCII; anything else would break the text and JSON output
+	for (i = 0; i < ODID_ID_SIZE && src[i] != '\0'; i++) {
+		dst[i] = (src[i] > ' ' && src[i] < 0x7F && src[i] != '"' && src[i] != '\\') ?
+			 (char)src[i] : '_';
+	}
+	dst[i] = '\0';
+}
+
+static bool decode_alert(const uint8_t *payload, size_t len, struct obs *o)
+{
+	if (len < RECORD_ALERT_SIZE) {
+		return false;
+	}
+	o->event = payload[0];
+	o->subject = payload[1];
+	o->zone = odid_le16(&payload[2]);
+	memcpy(o->mac, &payload[4], sizeof(o->mac));
+	o->latitude = (int32_t)odid_le32(&payload[10]);
+	o->longitude = (int32_t)odid_le32(&payload[14]);
+	o->altitude = (int32_t)odid_le32(&payload[18]);
+	o->key = ALERT_KEY(o->event, o->subject, o->zone);
+	o->flags = OBS_LOCATION;
+
+	return true;
+}
+
+static bool decode_frame(const uint8_t *frame, size_t len, struct obs *o)
+{
+	struct odid_message msgs[ODID_PACK_MAX_MSGS];
+	const uint8_t *pack;
+	size_t pack_len;
+	uint8_t counter;
+	int id_type = -1;
+
+	pack = odid_locate_pack(frame, len, &pack_len, &counter, NULL);
+	if (pack == NULL) {
+		return false;
+	}
+	int n = odid_decode_pack(pack, pack_len, msgs, ODID_PACK_MAX_MSGS);
+
+	if (n < 0) {
+		return false;
+	}
+
+	memcpy(o->mac, &frame[WLAN_SA_OFFSET], sizeof(o->mac));
+	o->key = counter;
+	o->flags = 0;
+
+	for (int i = 0; i < n; i++) {
+		const struct odid_message *m = &msgs[i];
+
+		switch (m->type) {
+		case ODID_MSG_BASIC_ID:
+			// a pack may carry several IDs; the serial number (type 1) wins
+			if (id_type != 1) {
+				id_type = m->basic_id.id_type;
+				copy_id(o->uas_id, m->basic_id.uas_id);
+				o->flags |= OBS_ID;
+			}
+			break;
+		case ODID_MSG_LOCATION:
+			o->latitude = m->location.latitude;
+			o->longitude = m->location.longitude;
+			o->altitude = m->location.geodetic_altitude != -10000 ?
+				      m->location.geodetic_altitude : m->location.pressure_altitude;
+			o->speed = m->location.speed;
+			o->direction = m->location.direction;
+			o->vertical_speed = m->location.vertical_speed;
+			o->flags |= OBS_LOCATION;
+			break;
+		case ODID_MSG_SYSTEM:
+			o->operator_latitude = m->system.operator_latitude;
+			o->operator_longitude = m->system.operator_longitude;
+			o->flags |= OBS_OPERATOR;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return true;
+}
+
+static void decode_batch(struct batch *b)
+{
+	b->nobs = 0;
+	b->other = 0;
+
+	for (uint32_t i = 0; i < b->count; i++) {
+		const struct record *r = &b->rec[i];
+		const uint8_t *payload = &b->data[r->offset];
+		struct obs *o = &b->obs[b->nobs];
+		bool ok;
+
+		o->type = r->type;
+		if (r->type == RECORD_ALERT) {
+			ok = decode_alert(payload, r->len, o);
+		} else {
+			ok = decode_frame(payload, r->len, o);
+		}
+		if (!ok) {
+			b->other++;
+			continue;
+		}
+		o->time = r->time;
+		o->source = b->source;
+		o->rssi = r->rssi;
+		o->channel = r->channel;
+		b->nobs++;
+	}
+}
+
+static void *worker(void *arg)
+{
+	struct collector *c = arg;
+	struct batch *b;
+
+	while ((b = queue_get(&c->work, -1)) != NULL) {
+		decode_batch(b);
+		queue_put(&c->merged, b);
+	}
+
+	return NULL;
+}
+
+int workers_start(struct collector *c)
+{
+	if (c->workers > ARRAY_SIZE(threads)) {
+		c->workers = ARRAY_SIZE(threads);
+	}
+	for (thread_count = 0; thread_count < c->workers; thread_count++) {
+		int err = pthread_create(&threads[thread_count], NULL, worker, c);
+
+		if (err) {
+			return -err;
+		}
+	}
+
+	return 0;
+}
+
+void workers_join(void)
+{
+	for (unsigned int i = 0; i < thread_count; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	thread_count = 0;
+}
@@ -0,0 +1,426 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Convert raw scan result captures to and from other formats.
+
+A capture (see src/rid_capture.h) is an 8-byte header, "RIDC" and a version
+byte, followed by records of: varint ms since the previous record, int8 RSSI,
+le16 frequency, varint frame length and the frame. Captures are replayed on
+the device or on native_sim with CONFIG_RID_REPLAY.
+
+Examples:
+    scripts/rid_capture.py info airfield.ridc
+    scripts/rid_capture.py to-pcap airfield.ridc airfield.pcap
+    scripts/rid_capture.py to-pcap --radiotap airfield.ridc airfield.pcap
+    scripts/rid_capture.py from-pcap airfield.pcap airfield.ridc
+    scripts/rid_capture.py from-records rid.bin airfield.ridc
+    scripts/rid_capture.py from-hex shell.log airfield.ridc
+    scripts/rid_capture.py synth --drones 3 --seconds 5 captures/synthetic.ridc
+    scripts/rid_capture.py synth --drones 2 --nan 2 --action 2 transports.ridc
+    scripts/rid_capture.py synth --drones 3 --auth 3 captures/auth.ridc
+    scripts/rid_capture.py synth --system captures/system.ridc
+    scripts/rid_capture.py synth --drones 2 --seconds 4 --stagger 8 arrivals.ridc
+    scripts/rid_capture.py flight --drones 3 --seconds 60 captures/flight.ridc
+"""
+
+import argparse
+import math
+import os
+import random
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import rid_decode  # noqa: E402
+
+MAGIC = b'RIDC'
+VERSION = 1
+FILE_HDR = MAGIC + bytes([VERSION, 0, 0, 0])
+
+PCAP_LINKTYPE_IEEE802_11 = 105
+PCAP_LINKTYPE_RADIOTAP = 127
+
+
+def put_varint(value):
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def get_varint(buf, off):
+    value = 0
+    for n in range(5):
+        if off + n >= len(buf):
+            raise ValueError('truncated varint')
+        value |= (buf[off + n] & 0x7F) << (7 * n)
+        if not buf[off + n] & 0x80:
+            return value, off + n + 1
+    raise ValueError('varint too long')
+
+
+def read_capture(path):
+    with open(path, 'rb') as f:
+        yield from parse_capture(f.read(), path)
+
+
+def parse_capture(buf, path):
+    """Yield (time_ms, rssi, frequency, frame) with time_ms from the start of the capture."""
+    if buf[:4] != MAGIC or buf[4] != VERSION:
+        raise SystemExit(f'{path}: not a version {VERSION} capture')
+    off = len(FILE_HDR)
+    now = 0
+    while off < len(buf):
+        delta, off = get_varint(buf, off)
+        rssi, freq = struct.unpack_from('<bH', buf, off)
+        length, off = get_varint(buf, off + 3)
+        frame = buf[off:off + length]
+        if len(frame) < length:
+            raise SystemExit(f'{path}: truncated record at offset {off}')
+        off += length
+        now += delta
+        yield now, rssi, freq, frame
+
+
+def write_capture(path, results):
+    """results: iterable of (time_ms, rssi, frequency, frame)."""
+    count = 0
+    last = None
+    with open(path, 'wb') as f:
+        f.write(FILE_HDR)
+        for ts, rssi, freq, frame in results:
+            delta = 0 if last is None else max(ts - last, 0)
+            last = ts
+            f.write(put_varint(delta) + struct.pack('<bH', rssi, freq) +
+                    put_varint(len(frame)) + frame)
+            count += 1
+    print(f'{path}: {count} records', file=sys.stderr)
+
+
+def radiotap(pkt):
+    """Strip a radiotap header; return (frequency, rssi, frame) with None where absent."""
+    length = struct.unpack_from('<H', pkt, 2)[0]
+    present = [struct.unpack_from('<I', pkt, 4)[0]]
+    off = 8
+    while present[-1] & 0x80000000:
+        present.append(struct.unpack_from('<I', pkt, off)[0])
+        off += 4
+    freq = rssi = None
+    # (alignment, size) of the fields up to antenna signal, in presence bit order
+    fields = [(8, 8), (1, 1), (1, 1), (2, 4), (2, 2), (1, 1)]
+    for bit, (align, size) in enumerate(fields):
+        if not present[0] & (1 << bit):
+            continue
+        off = (off + align - 1) & ~(align - 1)
+        if bit == 3:
+            freq = struct.unpack_from('<H', pkt, off)[0]
+        elif bit == 5:
+            rssi = struct.unpack_from('<b', pkt, off)[0]
+        off += size
+    return freq, rssi, pkt[length:]
+
+
+def read_pcap(path, default_rssi, default_freq):
+    with open(path, 'rb') as f:
+        buf = f.read()
+    magic = struct.unpack_from('<I', buf)[0]
+    endian = '<' if magic in (0xa1b2c3d4, 0xa1b23c4d) else '>'
+    nsec = magic in (0xa1b23c4d, 0x4d3cb2a1)
+    linktype = struct.unpack_from(endian + 'I', buf, 20)[0]
+    if linktype not in (PCAP_LINKTYPE_IEEE802_11, PCAP_LINKTYPE_RADIOTAP):
+        raise SystemExit(f'{path}: link type {linktype} is neither 802.11 nor radiotap')
+    off = 24
+    while off + 16 <= len(buf):
+        sec, frac, incl, _ = struct.unpack_from(endian + 'IIII', buf, off)
+        pkt = buf[off + 16:off + 16 + incl]
+        off += 16 + incl
+        ts = sec * 1000 + (frac // 1000000 if nsec else frac // 1000)
+        freq, rssi = default_freq, default_rssi
+        if linktype == PCAP_LINKTYPE_RADIOTAP:
+            rt_freq, rt_rssi, pkt = radiotap(pkt)
+            freq = rt_freq or freq
+            rssi = rt_rssi if rt_rssi is not None else rssi
+        yield ts, rssi, freq, pkt
+
+
+def read_records(path):
+    for rtype, ts, rssi, _, freq, frame in rid_decode.records(rid_decode.file_chunks(path)):
+        if rtype == rid_decode.RECORD_FRAME:
+            yield ts, rssi, freq, frame
+
+
+def read_hex(path):
+    """Reassemble the output of "wifi rid capture dump" from a console log."""
+    data = bytearray()
+    line_re = re.compile(r'([0-9a-f]{8}): ([0-9a-f]+)\s*$')
+    with open(path) as f:
+        for line in f:
+            m = line_re.search(line)
+            if m and int(m.group(1), 16) == len(data):
+                data += bytes.fromhex(m.group(2))
+    yield from parse_capture(bytes(data), path)
+
+
+def odid_pack(msgs):
+    return bytes([0xF2, 0x19, len(msgs)]) + b''.join(m.ljust(25, b'\0') for m in msgs)
+
+
+def odid_beacon(mac, counter, msgs):
+    """Beacon with an SSID and the ODID vendor specific element carrying a message pack."""
+    hdr = bytes([0x80, 0x00, 0, 0]) + b'\xff' * 6 + mac + mac + b'\x00\x00'
+    fixed = struct.pack('<QHH', 0, 100, 0x0421)
+    ssid = b'RID-' + mac[-2:].hex().encode()
+    vendor = bytes([0xFA, 0x0B, 0xBC, 0x0D, counter & 0xFF]) + odid_pack(msgs)
+    return hdr + fixed + bytes([0, len(ssid)]) + ssid + bytes([221, len(vendor)]) + vendor
+
+
+def odid_nan(mac, counter, msgs):
+    """NAN service discovery frame publishing the message pack under the ODID service ID."""
+    hdr = bytes([0xD0, 0x00, 0, 0, 0x51, 0x6F, 0x9A, 0x01, 0x00, 0x00]) + mac + \
+        bytes([0x50, 0x6F, 0x9A, 0x01, 0x00, 0xFF, 0x00, 0x00])
+    # public action, vendor specific, Wi-Fi Alliance OUI and the NAN type
+    sdf = bytes([0x04, 0x09, 0x50, 0x6F, 0x9A, 0x13])
+    info = bytes([counter & 0xFF]) + odid_pack(msgs)
+    # service ID (SHA-256 of "org.opendroneid.remoteid"), instance 1, publish with service info
+    sda = bytes([0x88, 0x69, 0x19, 0x9D, 0x92, 0x09, 0x01, 0x00, 0x10, len(info)]) + info
+    sdea = bytes([0x01, 0x00, 0x02, 0x00])  # instance 1, further service discovery, update 0
+    return hdr + sdf + bytes([0x03]) + struct.pack('<H', len(sda)) + sda + \
+        bytes([0x0E]) + struct.pack('<H', len(sdea)) + sdea
+
+
+def odid_action(mac, counter, msgs, public=True):
+    """Vendor specific action frame: public action or category 127, then the ODID OUI and type."""
+    hdr = bytes([0xD0, 0x00, 0, 0]) + b'\xff' * 6 + mac + mac + b'\x00\x00'
+    category = bytes([0x04, 0x09]) if public else bytes([0x7F])
+    return hdr + category + bytes([0xFA, 0x0B, 0xBC, 0x0D, counter & 0xFF]) + odid_pack(msgs)
+
+
+def ap_beacon(mac, ssid, channel):
+    hdr = bytes([0x80, 0x00, 0, 0]) + b'\xff' * 6 + mac + mac + b'\x00\x00'
+    fixed = struct.pack('<QHH', 0, 100, 0x0411)
+    rates = bytes([1, 8, 0x82, 0x84, 0x8b, 0x96, 0x0c, 0x12, 0x18, 0x24])
+    return hdr + fixed + bytes([0, len(ssid)]) + ssid + rates + bytes([3, 1, channel])
+
+
+def auth_pages(d, length=56):
+    """Authentication pages of a blob of length bytes, one per message."""
+    data = bytes((d * 16 + i) & 0xFF for i in range(length))
+    last_page = (max(length - 17, 0) + 22) // 23
+    # type 2, message set signature; the timestamp is seconds since 2019
+    pages = [bytes([0x22, 2 << 4, last_page, length]) + struct.pack('<I', 118000000 + d) + data[:17]]
+    for page in range(1, last_page + 1):
+        chunk = data[17 + (page - 1) * 23:17 + page * 23]
+        pages.append(bytes([0x22, (2 << 4) | page]) + chunk)
+    return pages
+
+
+def synth(drones, aps, seconds, nan=0, action=0, auth=0, system=False, stagger=0):
+    """Drones circling at 2 Hz among access points beaconing at 10 Hz, all on channel 6.
+
+    The first drones beacon; nan more publish over NAN service discovery and
+    action more send vendor specific action frames, public ones and category
+    127 ones in turn. The first auth drones also send an authentication blob
+    once, a page in each of their first messages: odd ones last page first,
+    and the last of them stops short of its last page, so that its
+    reassembly times out. With system, every drone also sends a System
+    message with its operator's position and the time, the capture
+    starting at 2022-09-28 16:00 UTC. With stagger, each drone turns up
+    that many seconds after the one before, and the access points beacon
+    until the last one is done.
+    """
+    events = []
+    senders = [(0, odid_beacon)] * drones
+    senders += [(1, odid_nan)] * nan
+    senders += [(2, lambda mac, n, msgs: odid_action(mac, n, msgs, n % 2 == 0))] * action
+    for d, (transport, frame) in enumerate(senders):
+        mac = bytes([0x60, 0x60, 0x1f, 0, transport, d + 1])
+        uas_id = f'1581F5FKD2294{d:07d}'.encode()
+        pages = auth_pages(d) if d < auth else []
+        if d % 2 == 1:
+            pages.reverse()
+        if d == auth - 1:
+            pages.pop()
+        for n in range(seconds * 2):
+            ts = n * 500 + d * 37 + d * stagger * 1000
+            lat = 423600000 + d * 20000 + n * 150
+            lon = -710940000 + d * 20000 - n * 90
+            alt = (1000 + 60 + n) * 2  # 0.5 m steps from -1000 m
+            basic = bytes([0x02, (1 << 4) | 2]) + uas_id
+            location = bytes([0x12, 2 << 4, 90, 40, 0]) + struct.pack(
+                '<iiHHHBBHB', lat, lon, alt, alt, 120, 0x4A, 0x43, (ts // 100) % 36000, 2)
+            msgs = [basic, location] + ([pages[n]] if n < len(pages) else [])
+            if system:
+                # live operator position, EU classification; seconds since 2019
+                msgs.insert(1, bytes([0x42, (1 << 2) | 1]) + struct.pack(
+                    '<iiHBHHBHI', lat - 2000, lon - 2000, 1, 0, 0, 0, 0, 2000, 118080000 + ts // 1000))
+            events.append((ts, -50 - 5 * d, frame(mac, n, msgs)))
+    for a in range(aps):
+        mac = bytes([0x00, 0x11, 0x22, 0x33, 0x44, a + 1])
+        frame = ap_beacon(mac, f'AP-{a}'.encode(), 6)
+        for n in range((seconds + (len(senders) - 1) * stagger) * 10):
+            events.append((n * 102 + a * 11, -70 - a, frame))
+    for ts, rssi, frame in sorted(events, key=lambda e: e[0]):
+        yield ts, rssi, 2437, frame
+
+
+def location_msg(lat, lon, alt_m, direction, speed_ms, vspeed_ms, ts_ms, h_acc, v_acc, s_acc):
+    """Location/Vector message, airborne, geodetic altitude also as pressure altitude."""
+    speed = round(speed_ms * 100)
+    flags = 2 << 4
+    if direction >= 180:
+        flags |= 0x02
+    if speed <= 6375:
+        speed_byte = min(round(speed / 25), 254)
+    else:
+        flags |= 0x01
+        speed_byte = min(round((speed - 6375) / 75), 254)
+    vspeed = max(-62, min(62, round(vspeed_ms * 2)))
+    alt = round((alt_m + 1000) * 2)
+    return bytes([0x12, flags, direction % 180, speed_byte, vspeed & 0xFF]) + struct.pack(
+        '<iiHHHBBHB', lat, lon, alt, alt, 0xFFFF, (v_acc << 4) | h_acc, (4 << 4) | s_acc,
+        (ts_ms // 100) % 36000, 2)
+
+
+def flight(drones, seconds, seed):
+    """Drones weaving at 6-14 m/s, turning and climbing, reporting at 1 Hz.
+
+    Positions carry GPS-like noise, horizontally 5 m, 1.5 m and 0.5 m (reported
+    as <10 m, <3 m and <1 m) for the drones in turn, vertically 1.5 m (reported
+    as <3 m), and speeds 0.25 m/s (reported as <1 m/s), so the reported
+    heading, speed and vertical speed agree with the track. For benchmarking
+    motion estimation.
+    """
+    # ASTM horizontal accuracy and the noise it stands for, m
+    fixes = [(10, 5.0), (11, 1.5), (12, 0.5)]
+    rng = random.Random(seed)
+    events = []
+    step = 0.1
+    m_per_e7 = 111319.5 / 1e7
+    for d in range(drones):
+        mac = bytes([0x60, 0x60, 0x1f, 0, 1, d + 1])
+        uas_id = f'1581F5FKD2295{d:07d}'.encode()
+        basic = bytes([0x02, (1 << 4) | 2]) + uas_id
+        north, east, up = 0.0, 0.0, 60.0 + 10 * d
+        heading = rng.uniform(0, 360)
+        cruise = rng.uniform(6, 14)
+        weave = rng.uniform(10, 25)   # peak turn rate, degrees/s
+        period = rng.uniform(15, 40)  # of the weave and of the speed changes, s
+        lat0 = 423600000 + d * 20000
+        lon0 = -710940000 + d * 20000
+        cos_lat = math.cos(math.radians(lat0 / 1e7))
+        h_acc, h_noise = fixes[d % len(fixes)]
+        t = 0.0
+        n = 0
+        while n < seconds:
+            speed = cruise * (1 + 0.3 * math.sin(2 * math.pi * t / period + d))
+            turn = weave * math.sin(2 * math.pi * t / period)
+            climb = 1.5 * math.sin(2 * math.pi * t / (period * 1.7))
+            if t >= n - 1e-9:
+                lat = lat0 + round((north + rng.gauss(0, h_noise)) / m_per_e7)
+                lon = lon0 + round((east + rng.gauss(0, h_noise)) / m_per_e7 / cos_lat)
+                alt = up + rng.gauss(0, 1.5)
+                ts = round(t * 1000) + d * 37
+                location = location_msg(lat, lon, alt, round(heading) % 360,
+                                        max(0.0, speed + rng.gauss(0, 0.25)),
+                                        climb + rng.gauss(0, 0.25), ts, h_acc, 5, 3)
+                events.append((ts, -50 - 5 * d, odid_beacon(mac, n, [basic, location])))
+                n += 1
+            heading = (heading + turn * step) % 360
+            north += speed * math.cos(math.radians(heading)) * step
+            east += speed * math.sin(math.radians(heading)) * step
+            up += climb * step
+            t += step
+    for ts, rssi, frame in sorted(events, key=lambda e: e[0]):
+        yield ts, rssi, 2437, frame
+
+
+def info(path):
+    count = 0
+    size = 0
+    end = 0
+    freqs = {}
+    for ts, _, freq, frame in read_capture(path):
+        count += 1
+        size += len(frame)
+        end = ts
+        freqs[freq] = freqs.get(freq, 0) + 1
+    print(f'{count} records, {size} frame bytes over {end / 1000:.1f} s')
+    for freq, n in sorted(freqs.items()):
+        print(f'  {freq} MHz: {n}')
+
+
+def to_pcap(src, dst, with_radiotap=False):
+    linktype = PCAP_LINKTYPE_RADIOTAP if with_radiotap else PCAP_LINKTYPE_IEEE802_11
+    with open(dst, 'wb') as pcap:
+        pcap.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, linktype))
+        for ts, rssi, freq, frame in read_capture(src):
+            if with_radiotap:
+                # channel (frequency, 2 GHz or 5 GHz flag) and antenna signal
+                flags = 0x0080 if freq < 3000 else 0x0100
+                frame = struct.pack('<BBHIHHb', 0, 0, 13, 0x28, freq, flags, rssi) + frame
+            pcap.write(struct.pack('<IIII', ts // 1000, (ts % 1000) * 1000, len(frame), len(frame)))
+            pcap.write(frame)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='cmd', required=True)
+    sub.add_parser('info', help='summarize a capture').add_argument('capture')
+    p = sub.add_parser('to-pcap', help='write the frames of a capture to a pcap file')
+    p.add_argument('capture')
+    p.add_argument('pcap')
+    p.add_argument('--radiotap', action='store_true', help='keep frequency and RSSI in radiotap headers')
+    p = sub.add_parser('from-pcap', help='convert an 802.11 or radiotap pcap file')
+    p.add_argument('pcap')
+    p.add_argument('capture')
+    p.add_argument('--rssi', type=int, default=-60, help='RSSI when the pcap has none')
+    p.add_argument('--frequency', type=int, default=2437, help='MHz, when the pcap has none')
+    p = sub.add_parser('from-records', help="convert the output sink's binary records")
+    p.add_argument('records')
+    p.add_argument('capture')
+    p = sub.add_parser('from-hex', help='convert a console log of "wifi rid capture dump"')
+    p.add_argument('log')
+    p.add_argument('capture')
+    p = sub.add_parser('synth', help='generate a synthetic capture of drones and access points')
+    p.add_argument('capture')
+    p.add_argument('--drones', type=int, default=3)
+    p.add_argument('--aps', type=int, default=2)
+    p.add_argument('--seconds', type=int, default=5)
+    p.add_argument('--nan', type=int, default=0, help='drones on NAN service discovery frames')
+    p.add_argument('--action', type=int, default=0, help='drones on vendor specific action frames')
+    p.add_argument('--auth', type=int, default=0, help='drones that also send authentication pages')
+    p.add_argument('--system', action='store_true', help='drones also send System messages')
+    p.add_argument('--stagger', type=int, default=0, help='seconds between one drone turning up and the next')
+    p = sub.add_parser('flight', help='generate a capture of drones flying curved paths')
+    p.add_argument('capture')
+    p.add_argument('--drones', type=int, default=3)
+    p.add_argument('--seconds', type=int, default=60)
+    p.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    if args.cmd == 'info':
+        info(args.capture)
+    elif args.cmd == 'to-pcap':
+        to_pcap(args.capture, args.pcap, args.radiotap)
+    elif args.cmd == 'from-pcap':
+        write_capture(args.capture, read_pcap(args.pcap, args.rssi, args.frequency))
+    elif args.cmd == 'from-records':
+        write_capture(args.capture, read_records(args.records))
+    elif args.cmd == 'from-hex':
+        write_capture(args.capture, read_hex(args.log))
+    elif args.cmd == 'synth':
+        write_capture(args.capture, synth(args.drones, args.aps, args.seconds, args.nan, args.action,
+                                                 args.auth, args.system, args.stagger))
+    elif args.cmd == 'flight':
+        write_capture(args.capture, flight(args.drones, args.seconds, args.seed))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Decode the binary frame records written by the scanner's output sink.
+
+The stream is a sequence of records, each a 12-byte little-endian header
+(see struct rid_record_hdr in src/rid_output.h) followed by the raw 802.11
+frame or, for geofence alerts, a struct rid_record_alert. Input can come from a file written by JLinkRTTLogger (RTT channel 1),
+from the J-Link RTT telnet port, or from a serial port.
+
+Examples:
+    JLinkRTTLogger -Device nRF5340_xxAA_APP -RTTChannel 1 rid.bin
+    scripts/rid_decode.py rid.bin
+    scripts/rid_decode.py --tcp localhost:19021
+    scripts/rid_decode.py --serial /dev/ttyACM1 --pcap out.pcap
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+SYNC = 0xA5
+RECORD_FRAME = 1
+RECORD_ALERT = 2
+HDR = struct.Struct('<BBHIbBH')
+ALERT = struct.Struct('<BBH6siii')
+ALERT_EVENTS = {1: 'ENTER', 2: 'EXIT', 3: 'BREACH'}
+ALERT_SUBJECTS = {0: 'UA', 1: 'operator'}
+
+PCAP_LINKTYPE_IEEE802_11 = 105
+
+
+def records(chunks):
+    """Yield (type, timestamp, rssi, channel, frequency, payload) tuples."""
+    buf = bytearray()
+    for chunk in chunks:
+        buf += chunk
+        while True:
+            start = buf.find(bytes([SYNC]))
+            if start < 0:
+                buf.clear()
+                break
+            if start:
+                del buf[:start]
+            if len(buf) < HDR.size:
+                break
+            sync, rtype, length, ts, rssi, chan, freq = HDR.unpack_from(buf)
+            if rtype not in (RECORD_FRAME, RECORD_ALERT) or length > 2304:
+                # not a record boundary; skip this sync byte and look for the next one
+                del buf[:1]
+                continue
+            if len(buf) < HDR.size + length:
+                break
+            payload = bytes(buf[HDR.size:HDR.size + length])
+            del buf[:HDR.size + length]
+            yield rtype, ts, rssi, chan, freq, payload
+
+
+def file_chunks(path):
+    f = sys.stdin.buffer if path == '-' else open(path, 'rb')
+    with f:
+        while chunk := f.read(65536):
+            yield chunk
+
+
+def tcp_chunks(target):
+    host, port = target.rsplit(':', 1)
+    with socket.create_connection((host, int(port))) as s:
+        while chunk := s.recv(65536):
+            yield chunk
+
+
+def serial_chunks(dev, baud):
+    import serial  # pyserial, only needed for --serial
+
+    with serial.Serial(dev, baud, timeout=0.1) as s:
+        while True:
+            chunk = s.read(65536)
+            if chunk:
+                yield chunk
+
+
+def mac(frame, offset):
+    return ':'.join('%02x' % b for b in frame[offset:offset + 6])
+
+
+def print_alert(ts, payload):
+    event, subject, zone, addr, lat, lon, alt = ALERT.unpack_from(payload)
+    print(f"{ts / 1000:10.3f}  {ALERT_EVENTS.get(event, event):<7} zone {zone}  "
+          f"{ALERT_SUBJECTS.get(subject, subject)} {mac(addr, 0)}  "
+          f"{lat / 1e7:.7f} {lon / 1e7:.7f}  {alt / 10:.1f} m")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    src = parser.add_mutually_exclusive_group(required=True)
+    src.add_argument('input', nargs='?', help="record file, or - for stdin")
+    src.add_argument('--tcp', metavar='HOST:PORT', help="read from a TCP stream (J-Link RTT telnet)")
+    src.add_argument('--serial', metavar='DEV', help="read from a serial port")
+    parser.add_argument('--baud', type=int, default=1000000)
+    parser.add_argument('--hex', action='store_true', help="also print each frame as hex")
+    parser.add_argument('--pcap', metavar='FILE', help="also write the frames to a pcap file")
+    args = parser.parse_args()
+
+    if args.tcp:
+        chunks = tcp_chunks(args.tcp)
+    elif args.serial:
+        chunks = serial_chunks(args.serial, args.baud)
+    else:
+        chunks = file_chunks(args.input)
+
+    pcap = None
+    if args.pcap:
+        pcap = open(args.pcap, 'wb')
+        pcap.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, PCAP_LINKTYPE_IEEE802_11))
+
+    count = 0
+    start = time.monotonic()
+    try:
+        for rtype, ts, rssi, chan, freq, frame in records(chunks):
+            if rtype == RECORD_ALERT:
+                print_alert(ts, frame)
+                continue
+            count += 1
+            src_mac = mac(frame, 10) if len(frame) >= 16 else '?'
+            print(f"{ts / 1000:10.3f}  ch {chan:<3} {freq} MHz  {rssi:4d} dBm  {src_mac}  {len(frame)} B")
+            if args.hex:
+                print('    ' + ' '.join('%02X' % b for b in frame))
+            if pcap:
+                pcap.write(struct.pack('<IIII', ts // 1000, (ts % 1000) * 1000, len(frame), len(frame)))
+                pcap.write(frame)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if pcap:
+            pcap.close()
+        elapsed = time.monotonic() - start
+        print(f"{count} records in {elapsed:.1f} s", file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
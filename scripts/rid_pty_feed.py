@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Stand in for a set of scanners on ptys, to run the host collector without hardware.
+
+Every pty plays one scanner writing the binary record stream of its output
+sink (see src/rid_output.h). All of them replay the same capture or record
+file in real time, each with its own boot time, RSSI offset and share of
+lost frames, as several scanners around one airfield would see it.
+
+Without a command, the pty paths are printed and the feed starts on Enter.
+With one, the pty paths are appended to it as name=path arguments and it is
+started before the feed:
+
+    scripts/rid_pty_feed.py captures/synthetic.ridc --sensors 4 --loss 0.2 -- \\
+        build/rid_collector/rid_collector
+"""
+
+import argparse
+import os
+import random
+import subprocess
+import sys
+import time
+import tty
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import rid_capture  # noqa: E402
+import rid_decode  # noqa: E402
+
+
+def channel_of(freq):
+    if freq == 2484:
+        return 14
+    if 2412 <= freq < 2484:
+        return (freq - 2407) // 5
+    if 5000 <= freq < 5900:
+        return (freq - 5000) // 5
+    return 0
+
+
+def load(path):
+    """Return (time_ms, type, rssi, channel, frequency, payload) for every record in a file."""
+    with open(path, 'rb') as f:
+        buf = f.read()
+    if buf[:4] == rid_capture.MAGIC:
+        return [(ts, rid_decode.RECORD_FRAME, rssi, channel_of(freq), freq, frame)
+                for ts, rssi, freq, frame in rid_capture.parse_capture(buf, path)]
+    return [(ts, rtype, rssi, chan, freq, payload)
+            for rtype, ts, rssi, chan, freq, payload in rid_decode.records([buf])]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('input', help='capture or record file')
+    parser.add_argument('--sensors', type=int, default=3)
+    parser.add_argument('--loss', type=float, default=0.1, help='share of frames each sensor misses')
+    parser.add_argument('--speed', type=float, default=1.0, help='replay speed, 0 for no pacing')
+    parser.add_argument('--seed', type=int, default=1)
+    argv = sys.argv[1:]
+    command = argv[argv.index('--') + 1:] if '--' in argv else []
+    args = parser.parse_args(argv[:len(argv) - len(command) - (1 if command else 0)])
+
+    rnd = random.Random(args.seed)
+    records = load(args.input)
+    if not records:
+        raise SystemExit(f'{args.input}: no records')
+
+    ptys = []
+    events = []
+    for n in range(args.sensors):
+        master, slave = os.openpty()
+        tty.setraw(slave)
+        ptys.append((f'dk{n + 1}', master, slave, os.ttyname(slave)))
+        boot = rnd.randrange(1000, 60000)
+        offset = -4 * n
+        for ts, rtype, rssi, chan, freq, payload in records:
+            if rtype == rid_decode.RECORD_FRAME and rnd.random() < args.loss:
+                continue
+            if rtype == rid_decode.RECORD_FRAME:
+                rssi = max(-127, min(0, rssi + offset + rnd.randint(-3, 3)))
+            hdr = rid_decode.HDR.pack(rid_decode.SYNC, rtype, len(payload),
+                                      (ts + boot) & 0xFFFFFFFF, rssi, chan, freq)
+            # up to 5 ms of transport delay on the way to the host
+            events.append((ts + rnd.uniform(0, 5), n, hdr + payload))
+    events.sort(key=lambda e: e[0])
+
+    proc = None
+    if command:
+        proc = subprocess.Popen(command + [f'{name}={path}' for name, _, _, path in ptys])
+        time.sleep(0.5)
+    else:
+        for name, _, _, path in ptys:
+            print(f'{name}={path}')
+        input('press Enter to start the feed')
+
+    start = time.monotonic()
+    first = events[0][0]
+    try:
+        for ts, n, data in events:
+            if args.speed > 0:
+                delay = (ts - first) / 1000 / args.speed - (time.monotonic() - start)
+                if delay > 0:
+                    time.sleep(delay)
+            os.write(ptys[n][1], data)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        time.sleep(0.2)
+        for _, master, slave, _ in ptys:
+            os.close(master)
+            os.close(slave)
+    print(f'{len(events)} records fed to {len(ptys)} ptys', file=sys.stderr)
+    if proc:
+        proc.wait()
+
+
+if __name__ == '__main__':
+    main()
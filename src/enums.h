@@ -1,3 +1,10 @@
+#include <zephyr/sys/util.h>
+
+// name of value in one of the tables below, or "UNKNOWN" for a value the table has no entry for;
+// most fields are 4-bit nibbles straight from the frame, so any value up to 15 can turn up
+#define ENUM_STRING(table, value) \
+	((size_t)(value) < ARRAY_SIZE(table) && (table)[value] != NULL ? (table)[value] : "UNKNOWN")
+
 enum ID_TYPE {
 	ID_NONE = 0, 
 	SERIAL_NUMBER_ANSI_CTA_2063_A = 1, 
@@ -93,6 +100,37 @@ static const char* const SPEED_MULTIPLIER_STRING[] = {
 	[X_0_75] = "0.75"
 };
 
+enum HORIZONTAL_ACCURACY {
+	HORIZONTAL_UNKNOWN_GREATER_THAN_18_52KM = 0,
+	HORIZONTAL_LESS_THAN_18_52KM = 1,
+	HORIZONTAL_LESS_THAN_7_408KM = 2,
+	HORIZONTAL_LESS_THAN_3_704KM = 3,
+	HORIZONTAL_LESS_THAN_1852M = 4,
+	HORIZONTAL_LESS_THAN_926M = 5,
+	HORIZONTAL_LESS_THAN_555_6M = 6,
+	HORIZONTAL_LESS_THAN_185_2M = 7,
+	HORIZONTAL_LESS_THAN_92_6M = 8,
+	HORIZONTAL_LESS_THAN_30M = 9,
+	HORIZONTAL_LESS_THAN_10M = 10,
+	HORIZONTAL_LESS_THAN_3M = 11,
+	HORIZONTAL_LESS_THAN_1M = 12
+};
+static const char* const HORIZONTAL_ACCURACY_STRING[] = {
+	[HORIZONTAL_UNKNOWN_GREATER_THAN_18_52KM] = "UNKNOWN OR >=18.52 km",
+	[HORIZONTAL_LESS_THAN_18_52KM] = "<18.52 km",
+	[HORIZONTAL_LESS_THAN_7_408KM] = "<7.408 km",
+	[HORIZONTAL_LESS_THAN_3_704KM] = "<3.704 km",
+	[HORIZONTAL_LESS_THAN_1852M] = "<1852 m",
+	[HORIZONTAL_LESS_THAN_926M] = "<926 m",
+	[HORIZONTAL_LESS_THAN_555_6M] = "<555.6 m",
+	[HORIZONTAL_LESS_THAN_185_2M] = "<185.2 m",
+	[HORIZONTAL_LESS_THAN_92_6M] = "<92.6 m",
+	[HORIZONTAL_LESS_THAN_30M] = "<30 m",
+	[HORIZONTAL_LESS_THAN_10M] = "<10 m",
+	[HORIZONTAL_LESS_THAN_3M] = "<3 m",
+	[HORIZONTAL_LESS_THAN_1M] = "<1 m"
+};
+
 enum VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY {
 	UNKNOWN_GREATER_THAN_150M = 0, 
 	LESS_THAN_150M = 1, 
@@ -127,6 +165,23 @@ static const char* const SPEED_ACCURACY_STRING[] = {
 	[LESS_THAN_0_3M_S] = "<0.3 m/s"
 };
 
+enum AUTH_TYPE {
+	AUTH_NONE = 0,
+	UAS_ID_SIGNATURE = 1,
+	OPERATOR_ID_SIGNATURE = 2,
+	MESSAGE_SET_SIGNATURE = 3,
+	NETWORK_REMOTE_ID = 4,
+	SPECIFIC_AUTHENTICATION = 5
+};
+static const char* const AUTH_TYPE_STRING[] = {
+	[AUTH_NONE] = "AUTH_NONE",
+	[UAS_ID_SIGNATURE] = "UAS_ID_SIGNATURE",
+	[OPERATOR_ID_SIGNATURE] = "OPERATOR_ID_SIGNATURE",
+	[MESSAGE_SET_SIGNATURE] = "MESSAGE_SET_SIGNATURE",
+	[NETWORK_REMOTE_ID] = "NETWORK_REMOTE_ID",
+	[SPECIFIC_AUTHENTICATION] = "SPECIFIC_AUTHENTICATION"
+};
+
 enum SELF_ID_TYPE {
 	TEXT_DESCRIPTION = 0, 
 	EMERGENCY_DESCRIPTION = 1, 
@@ -164,7 +219,7 @@ static const char* const UA_CATEGORY_STRING[] = {
 
 enum UA_CLASS {
 	UNDEFINED_CLASS = 0, 
-	CLASS0 = 0, 
+	CLASS0 = 1, 
 	CLASS1 = 2,
 	CLASS2 = 3,
 	CLASS3 = 4,
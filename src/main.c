@@ -12,10 +12,13 @@
 LOG_MODULE_REGISTER(scan, CONFIG_LOG_DEFAULT_LEVEL);
 
 
+#if defined(CONFIG_HAS_NRFX)
 #include <nrfx_clock.h>
+#endif
 #include <zephyr/kernel.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <zephyr/shell/shell.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/init.h>
@@ -26,7 +29,26 @@ LOG_MODULE_REGISTER(scan, CONFIG_LOG_DEFAULT_LEVEL);
 
 #include "net_private.h"
 
-#include "enums.h"
+#include "odid_decoder.h"
+#include "odid_locate.h"
+#include "odid_format.h"
+#include "rid_auth.h"
+#include "rid_clock.h"
+#include "rid_dedup.h"
+#include "rid_duty.h"
+#include "rid_filter.h"
+#include "rid_load.h"
+#include "rid_ring.h"
+#include "rid_output.h"
+#include "rid_sched.h"
+#include "rid_scan.h"
+#include "rid_stats.h"
+#include "rid_track.h"
+#include "rid_bench.h"
+#include "rid_capture.h"
+#include "rid_geofence.h"
+#include "rid_monitor.h"
+#include "rid_motion.h"
 
 #define WIFI_SHELL_MODULE "wifi"
 
@@ -36,75 +58,9 @@ LOG_MODULE_REGISTER(scan, CONFIG_LOG_DEFAULT_LEVEL);
 
 #define NRF_LOG_DEFERRED 0
 
-// decimal of FA 0B BC 0D
-static uint8_t identifier[] = {250, 11, 188, 13};
-
-// array of ASCII chars, where their index in the array corresponds to its decimal representation.
-// chars that aren't needed for our purposes are left as underscores
-static const char ASCII_DICTIONARY[] = {'0', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '_', '-', '.', '_', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '_', '_', '_', '_', '_', '_', '_', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z'};
-// array of hex chars, where their index in the array corresponds to its decimal representation
-static const char* const HEX_DICTIONARY[] = {"00", "01", "02", "03", "04", "05", "06", "07", "08", "09", "0A", "0B", "0C", "0D", "0E", "0F", "10", "11", "12", "13", "14", "15", "16", "17", "18", "19", "1A", "1B", "1C", "1D", "1E", "1F", "20", "21", "22", "23", "24", "25", "26", "27", "28", "29", "2A", "2B", "2C", "2D", "2E", "2F", "30", "31", "32", "33", "34", "35", "36", "37", "38", "39", "3A", "3B", "3C", "3D", "3E", "3F", "40", "41", "42", "43", "44", "45", "46", "47", "48", "49", "4A", "4B", "4C", "4D", "4E", "4F", "50", "51", "52", "53", "54", "55", "56", "57", "58", "59", "5A", "5B", "5C", "5D", "5E", "5F", "60", "61", "62", "63", "64", "65", "66", "67", "68", "69", "6A", "6B", "6C", "6D", "6E", "6F", "70", "71", "72", "73", "74", "75", "76", "77", "78", "79", "7A", "7B", "7C", "7D", "7E", "7F", "80", "81", "82", "83", "84", "85", "86", "87", "88", "89", "8A", "8B", "8C", "8D", "8E", "8F", "90", "91", "92", "93", "94", "95", "96", "97", "98", "99", "9A", "9B", "9C", "9D", "9E", "9F", "A0", "A1", "A2", "A3", "A4", "A5", "A6", "A7", "A8", "A9", "AA", "AB", "AC", "AD", "AE", "AF", "B0", "B1", "B2", "B3", "B4", "B5", "B6", "B7", "B8", "B9", "BA", "BB", "BC", "BD", "BE", "BF", "C0", "C1", "C2", "C3", "C4", "C5", "C6", "C7", "C8", "C9", "CA", "CB", "CC", "CD", "CE", "CF", "D0", "D1", "D2", "D3", "D4", "D5", "D6", "D7", "D8", "D9", "DA", "DB", "DC", "DD", "DE", "DF", "E0", "E1", "E2", "E3", "E4", "E5", "E6", "E7", "E8", "E9", "EA", "EB", "EC", "ED", "EE", "EF", "F0", "F1", "F2", "F3", "F4", "F5", "F6", "F7", "F8", "F9", "FA", "FB", "FC", "FD", "FE", "FF"};
-
-
-static uint32_t scan_finished;
-
 
 static struct net_mgmt_event_callback wifi_shell_mgmt_cb;
 
-static void log_hexdump(uint8_t* buf, uint16_t size) {
-	/*
-	 print the buffer (which should be a scanned wifi packet) as a string of hex chars.
-	 */
-	for (int i=0; i<size; i++) {
-		if (buf[i] < 16) {  // because printing "%x ", for single digit characters omits the first 0
-			printk("0");
-		}
-		printk("%X ", buf[i]);
-		k_sleep(K_SECONDS(0.001));  // delay between each character so messages aren't dropped
-	}
-	printk("\n");
-}
-
-static int contains(uint8_t big[], int size_b, uint8_t small[], int size_s) {
-	/*
-	 Checks if a small array is a sub-array of a big array. Returns -1 if it's not,
-	 Returns the index of the small array in the big array if it is.
-	 */
-    int contains, k;
-    for(int i = 0; i < size_b; i++){
-        // assume that the big array contains the small array
-        contains = 1;
-        // check if the element at index i in the big array is the same as the first element in the small array
-       if(big[i] == small[0]){
-           // if yes, then we start from k = 1, because we already know that the first element in the small array is the same as the element at index i in the big array
-           k = 1;
-           // we start to check if the next elements in the big array are the same as the elements in the small array
-           // (we start from i+1 position because we already know that the element at the position i is the same as the first element in the small array)
-           for(int j = i + 1; j < size_b; j++){
-               // range for k must be from 1 to size_s-1
-               if(k >= size_s - 1) {
-                   break;
-               }
-               // if the element at the position j in the big array is different
-               // from the element at the position k in the small array then we
-               // flag that we did not find the sequence we were looking for (contains=0)
-               if(big[j] != small[k]){
-                   contains = 0;
-                   break;
-               }
-               // increment k because we want the next element in the small array
-               k++;
-           }
-           // if contains flag is not 0 that means we found the sequence we were looking
-           // for and that sequence starts from index i in the big array
-           if(contains) {
-               return i;
-           }
-       }
-    }
-    return -1;  // if the sequence we were looking for was not found
-}
-
 static int wifi_freq_to_channel(int frequency)
 {
 	int channel = 0;
@@ -143,347 +99,526 @@ static enum wifi_frequency_bands wifi_freq_to_band(int frequency)
 	return band;
 }
 
-static void handle_wifi_raw_scan_result(struct net_mgmt_event_callback *cb)
+// age of the position in the frame being decoded when it was received, negative if unknown;
+// the track and geofence events raised while merging the frame go with it
+static int32_t frame_air_ms = -1;
+// how much the frame being decoded tells the host, raised by the events it causes
+static enum rid_output_prio frame_prio;
+
+static void frame_prio_raise(enum rid_output_prio prio)
+{
+	frame_prio = MAX(frame_prio, prio);
+}
+
+/* Age of the position in msgs on reception at rx_time, or -1 if there is none
+ * or the clock cannot tell. System timestamps set the clock on the way.
+ */
+static int32_t position_age(const struct odid_message *msgs, int num_msgs, uint32_t rx_time)
 {
-	struct wifi_raw_scan_result *raw =
-		(struct wifi_raw_scan_result *)cb->info;
-	int channel;
-	int band;
-	int rssi;
-	uint8_t mac_string_buf[sizeof("xx:xx:xx:xx:xx:xx")];
-
-	rssi = raw->rssi;
-	channel = wifi_freq_to_channel(raw->frequency);
-	band = wifi_freq_to_band(raw->frequency);
-
-	int odid_identifier_idx = contains(raw->data, sizeof(raw->data), identifier, sizeof(identifier));
-
-	if (odid_identifier_idx != -1) {
-		LOG_INF("%-4u (%-6s) | %-4d | %s |      %-4d        ",
-			channel,
-			wifi_band_txt(band),
-			rssi,
-			net_sprint_ll_addr_buf(raw->data + 10, WIFI_MAC_ADDR_LEN, mac_string_buf, sizeof(mac_string_buf)), raw->frame_length);
-
-		k_sleep(K_SECONDS(0.01));
-		log_hexdump(raw->data, sizeof(raw->data));
-		printf("\n\n\n");
-		
-		// flags to hold whether or not a certain message was received
-		int basic_id_flag = 0;
-		int location_vector_flag = 0;
-		int authentication_flag = 0;
-		int self_id_flag = 0;
-		int system_flag = 0;
-		int operator_id_flag = 0;
-
-		int num_msg_in_pack = raw->data[odid_identifier_idx+7];
-		for (int msg_num=0; msg_num<num_msg_in_pack; msg_num++) {
-			int msg_type = (raw->data[odid_identifier_idx + 8 + msg_num*25] - 2) / 16;  // either 0 (Basic ID), 1 (Location/Vector), 2 (Authentication), 3 (Self-ID), 4 (System), or 5 (Operator ID)
-			
-			switch(msg_type) {  // Decode the raw data into useful RID information
-				case 0:  // Basic ID Message
-					enum UA_TYPE ua_type = raw->data[odid_identifier_idx + 8 + msg_num*25 + 1] % 16;
-					enum ID_TYPE id_type = raw->data[odid_identifier_idx + 8 + msg_num*25 + 1] / 16;  // floor division
-					printf("ID TYPE: %s.  ", ID_TYPE_STRING[id_type]);
-					printf("UA TYPE: %s.  ", UA_TYPE_STRING[ua_type]);
-
-					switch(id_type) {
-						// Using curly bracs around each case to define each case as it's own frame to prevent redeclaration errors for id_buf
-						case 0:{  // None --> null ID
-							char id_buf[] = {'0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '\0'};
-							printf("NULL UAV ID: %s.\n\n", id_buf);
-							break;
-						}
-						case 1:  // Serial Number
-						case 2:{  // CAA Registration
-							// Loop through the Serial number in the raw decimal data and build a new string containing the serial number in ASCII
-							char id_buf[21];  // initalize char array to hold the serial number (which is at most 20 ASCII chars)
-							for (int i=0; i<20; i++) {
-								int decimal_val = raw->data[odid_identifier_idx + 8 + msg_num*25 + 2+i];
-								id_buf[i] = ASCII_DICTIONARY[decimal_val];
-							}
-							id_buf[20] = '\0';
-							printf("SERIAL NUMBER/CAA REGISTRATION NUMBER: %s.\n\n", id_buf);
-							break;
-						}
-						case 3:{  // UTM UUID (should be encoded as a 128-bit UUID (32-char hex string))
-							char id_buf[33];
-							for (int i=0; i<16; i++) {
-								int decimal_val = raw->data[odid_identifier_idx + 8 + msg_num*25 + 2+i];
-								id_buf[2*i] = HEX_DICTIONARY[decimal_val][0];  // 1st hex char in an array of 2 hex chars
-								id_buf[2*i+1] = HEX_DICTIONARY[decimal_val][1];  // 2nd hex char in an array of 2 hex chars
-							}
-							id_buf[32] = '\0';
-							printf("UTM UUID: %s.\n\n", id_buf);
-							break;
-						}							
-						case 4:{  // Specific Session ID (1st byte is an in betwen 0 and 255, and 19 remaining bytes are alphanumeric code, according to this: https://www.rfc-editor.org/rfc/rfc9153.pdf)
-							char id_buf[21];
-							id_buf[0] = raw->data[odid_identifier_idx + 8 + msg_num*25 + 2];
-							// sprintf(id_buf[0], "%d", raw->data[odid_identifier_idx + 8 + msg_num*25 + 2]);
-							// Loop through the Session ID in the raw decimal data and build a new string containing the serial number in ASCII
-							for (int i=1; i<20; i++) {
-								int decimal_val = raw->data[odid_identifier_idx + 8 + msg_num*25 + 2+i];
-								id_buf[i] = ASCII_DICTIONARY[decimal_val];
-							}
-							id_buf[20] = '\0';
-							printf("SPECIFIC SESSION ID: %s.\n\n", id_buf);
-							break;
-						}
-					}
-					basic_id_flag = 1;
-					break;
-				case 1:  // Location/Vector Message
-					enum OPERATIONAL_STATUS op_status = raw->data[odid_identifier_idx + 8 + msg_num*25 + 1] / 16;  // floor division
-					// funky modulos & floor division to get the value of each bit
-					enum HEIGHT_TYPE height_type_flag = (raw->data[odid_identifier_idx + 8 + msg_num*25 + 1] % 8) / 4;  // 0: Above Takeoff. 1: AGL
-					enum E_W_DIRECTION_SEGMENT direction_segment_flag = (raw->data[odid_identifier_idx + 8 + msg_num*25 + 1] % 4) / 2;  // 0: <180, 1: >=180
-					enum SPEED_MULTIPLIER speed_multiplier_flag = raw->data[odid_identifier_idx + 8 + msg_num*25 + 1] % 2;;  // 0: x0.25, 1: x0.75
-
-					uint8_t track_direction = raw->data[odid_identifier_idx + 8 + msg_num*25 + 2];  // direction measured clockwise from true north. Should be between 0-179
-					if (direction_segment_flag) {  // If E_W_DIRECTION_SEGMENT is true, add 180 to the track_direction, according to ASTM.
-						track_direction += 180;
-					}
-
-					uint8_t speed = raw->data[odid_identifier_idx + 8 + msg_num*25 + 3];  // ground speed in m/s
-					if (speed_multiplier_flag) {
-						speed = 0.75*speed + 255*0.25;  // as defined in ASTM
-					}
-					else {
-						speed *= 0.25;
-					}
-
-					uint8_t vertical_speed = raw->data[odid_identifier_idx + 8 + msg_num*25 + 4] * 0.5;  // vertical speed in m/s (positive = up, negatve = down); multiply by 0.5 as defined in ASTM
-
-					// lat and lon Little Endian encoded
-					int32_t lat_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 5];
-					int32_t lat_lsb1 = raw->data[odid_identifier_idx + 8 + msg_num*25 + 6] << 8;  // multiply by 2^8
-					int32_t lat_msb1 = raw->data[odid_identifier_idx + 8 + msg_num*25 + 7] << 16;  // multiply by 2^16
-					int32_t lat_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 8] << 24;  // multiply by 2^24
-					int32_t lat_int = lat_msb + lat_msb1 + lat_lsb1 + lat_lsb;
-					float lat = (float) lat_int / 10000000.0;  // divide by 10^7, according to ASTM
-
-					int32_t lon_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 9];
-					int32_t lon_lsb1 = raw->data[odid_identifier_idx + 8 + msg_num*25 + 10] << 8;  // multiply by 2^8
-					int32_t lon_msb1 = raw->data[odid_identifier_idx + 8 + msg_num*25 + 11] << 16;  // multiply by 2^16
-					int32_t lon_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 12] << 24;  // multiply by 2^24
-					int32_t lon_int = lon_msb + lon_msb1 + lon_lsb1 + lon_lsb;
-					float lon = (float) lon_int / 10000000.0;  // divide by 10^7, according to ASTM
-
-					// altitudes and height Little Endian encoded
-					uint16_t pressure_altitude_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 13];
-					uint16_t pressure_altitude_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 14] << 8;
-					uint16_t pressure_altitude = (pressure_altitude_msb + pressure_altitude_lsb) * 0.5 - 1000;
-
-					uint16_t geodetic_altitude_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 15];
-					uint16_t geodetic_altitude_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 16] << 8;
-					uint16_t geodetic_altitude = (geodetic_altitude_msb + geodetic_altitude_lsb) * 0.5 - 1000;
-
-					uint16_t height_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 17];
-					uint16_t height_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 18] << 8;
-					uint16_t height = (height_msb + height_lsb) * 0.5 - 1000;
-
-					enum VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY vertical_accuracy = raw->data[odid_identifier_idx + 8 + msg_num*25 + 19] / 16;  // floor division
-					enum VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY horizontal_accuracy = raw->data[odid_identifier_idx + 8 + msg_num*25 + 19] % 16;
-					
-					enum VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY baro_alt_accuracy = raw->data[odid_identifier_idx + 8 + msg_num*25 + 20] / 16;  // floor division
-					enum SPEED_ACCURACY speed_accuracy = raw->data[odid_identifier_idx + 8 + msg_num*25 + 20] % 16;
-
-					// 1/10ths of seconds since the last hour relatve to UTC time
-					uint16_t timestamp_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 21];
-					uint16_t timestamp_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 21] << 8;
-					uint16_t timestamp = timestamp_msb + timestamp_lsb;
-
-					uint8_t timestamp_accuracy_int = (raw->data[odid_identifier_idx + 8 + msg_num*25 + 22] % 15);  // modulo 15 to get rid of bits 7-4. Between 0.1 s and 1.5 s (0 s = unknown)
-					float timestamp_accuracy = timestamp_accuracy_int * 0.1;
-					
-					printf("OPERATIONAL STATUS: %s.  ", OPERATIONAL_STATUS_STRING[op_status]);
-					printf("HEIGHT TYPE: %s.  ", HEIGHT_TYPE_STRING[height_type_flag]);
-					printf("DIRECTION SEGMENT FLAG: %s.  ", E_W_DIRECTION_SEGMENT_STRING[direction_segment_flag]);
-					printf("SPEED MULTIPLIER FLAG: %s.  ", SPEED_MULTIPLIER_STRING[speed_multiplier_flag]);
-					printf("HEADING (deg): %d.  ", track_direction);
-					printf("SPEED (m/s): %d.  ", speed);
-					printf("VERTICAL SPEED (m/s): %d.  ", vertical_speed);
-					printf("LAT: %d.  ", lat_int);
-					printf("LON: %d.  ", lon_int);
-					printf("PRESSURE ALT: %d.  ", pressure_altitude);
-					printf("GEO ALT: %d.  ", geodetic_altitude);
-					printf("HEIGHT: %d.  ", height);
-					printf("HORIZONTAL ACCURACY: %s.  ", VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY_STRING[horizontal_accuracy]);
-					printf("VERTICAL ACCURACY: %s.  ", VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY_STRING[vertical_accuracy]);
-					printf("BARO ALT ACCURACY: %s.  ", VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY_STRING[baro_alt_accuracy]);
-					printf("SPEED ACCURACY: %s.  ", SPEED_ACCURACY_STRING[speed_accuracy]);
-					printf("TIMESTAMP: %d.  ", timestamp);
-					printf("TIMESTAMP_ACCURACY (btwn 0.1-1.5s): %f\n\n", timestamp_accuracy);
-
-					location_vector_flag = 1;
-					break;
-				case 3:  // Self ID Message
-					enum SELF_ID_TYPE self_id_type = raw->data[odid_identifier_idx + 8 + msg_num*25 + 1];
-					// Loop through the self id description in the raw decimal data and build a new string containing the self id description in ASCII
-					char self_id_description_buf[24];  // initalize char array to hold self id description
-					for (int i=0; i<23; i++) {
-						int decimal_val = raw->data[odid_identifier_idx + 8 + msg_num*25 + 2 + i];
-						self_id_description_buf[i] = ASCII_DICTIONARY[decimal_val];
-					}
-					self_id_description_buf[23] = '\0';
-					
-					printf("SELF ID TYPE: %s.  ", SELF_ID_TYPE_STRING[self_id_type]);
-					printf("SELF ID: %s.\n\n", self_id_description_buf);
-					self_id_flag = 1;
-					break;
-				case 4:  // System Message
-					enum OPERATOR_LOCATION_ALTITUDE_SOURCE_TYPE operator_location_type = raw->data[odid_identifier_idx + 8 + msg_num*25 + 1] % 3; // mod 3 so that we only consider bits 1 and 0
-					
-					// lat and lon Little Endian encoded
-					int32_t operator_lat_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 2];
-					int32_t operator_lat_lsb1 = raw->data[odid_identifier_idx + 8 + msg_num*25 + 3] << 8;  // multiply by 2^8
-					int32_t operator_lat_msb1 = raw->data[odid_identifier_idx + 8 + msg_num*25 + 4] << 16;  // multiply by 2^16
-					int32_t operator_lat_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 5] << 24;  // multiply by 2^24
-					int32_t operator_lat_int = operator_lat_msb + operator_lat_msb1 + operator_lat_lsb1 + operator_lat_lsb;
-					float operator_lat = (float) operator_lat_int / 10000000.0;
-
-					int32_t operator_lon_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 6];
-					int32_t operator_lon_lsb1 = raw->data[odid_identifier_idx + 8 + msg_num*25 + 7] << 8;  // multiply by 2^8
-					int32_t operator_lon_msb1 = raw->data[odid_identifier_idx + 8 + msg_num*25 + 8] << 16;  // multiply by 2^16
-					int32_t operator_lon_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 9] << 24;  // multiply by 2^24
-					int32_t operator_lon_int = operator_lon_msb + operator_lon_msb1 + operator_lon_lsb1 + operator_lon_lsb;
-					float operator_lon = (float) operator_lon_int / 10000000.0;
-
-					// number of aircraft in the area
-					uint16_t area_count_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 10];
-					uint16_t area_count_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 11] << 8;  // multiply by 2^8
-					uint16_t area_count = area_count_msb + area_count_lsb;
-
-					// radius of cylindrical area with the group of aircraft
-					uint16_t area_radius = raw->data[odid_identifier_idx + 8 + msg_num*25 + 12] * 10;
-
-					// floor and ceiling Little Endian encoded
-					uint16_t area_ceiling_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 13];
-					uint16_t area_ceiling_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 14] << 8;
-					uint16_t area_ceiling = (area_ceiling_msb + area_ceiling_lsb) * 0.5 - 1000;
-
-					uint16_t area_floor_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 15];
-					uint16_t area_floor_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 16] << 8;
-					uint16_t area_floor = (area_floor_msb + area_floor_lsb) * 0.5 - 1000;
-
-					enum UA_CATEGORY ua_category = raw->data[odid_identifier_idx + 8 + msg_num*25 + 17] / 16;  // floor division
-					enum UA_CLASS ua_classification = raw->data[odid_identifier_idx + 8 + msg_num*25 + 17] % 16;
-					
-
-					// operator altitude Little Endian encoded
-					uint16_t operator_altitude_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 18];
-					uint16_t operator_altitude_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 19] << 8;
-					uint16_t operator_altitude = (operator_altitude_msb + operator_altitude_lsb) * 0.5 - 1000;
-
-					// current time in seconds since 00:00:00 01/01/2019
-					uint32_t system_timestamp_lsb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 20];
-					uint32_t system_timestamp_lsb1 = raw->data[odid_identifier_idx + 8 + msg_num*25 + 21] << 8;
-					uint32_t system_timestamp_msb1 = raw->data[odid_identifier_idx + 8 + msg_num*25 + 22] << 16;
-					uint32_t system_timestamp_msb = raw->data[odid_identifier_idx + 8 + msg_num*25 + 23] << 24;
-					uint32_t system_timestamp = system_timestamp_msb + system_timestamp_msb1 + system_timestamp_lsb1 + system_timestamp_lsb;
-
-					printf("OPERATOR LOCATION SOURCE TYPE: %s.  ", OPERATOR_LOCATION_ALTITUDE_SOURCE_TYPE_STRING[operator_location_type]);
-					printf("OPERATOR LAT: %d.  ", operator_lat_int);
-					printf("OPERATOR LON: %d.  ", operator_lon_int);
-					printf("OPERATOR ALT: %d.  ", operator_altitude);
-					printf("AREA COUNT: %d.  ", area_count);
-					printf("AREA RADIUS: %d.  ", area_radius);
-					printf("AREA CEILING: %d.  ", area_ceiling);
-					printf("AREA FLOOR: %d.  ", area_floor);
-					printf("UA CATEGORY: %s.  ", UA_CATEGORY_STRING[ua_category]);
-					printf("UA CLASS: %s.  ", UA_CLASS_STRING[ua_classification]);
-					printf("TIMESTAMP (secs from 00:00:00 01/01/2019): %d.\n\n", system_timestamp);
-					
-					system_flag = 1;
-					break;
-				case 5:  // Operator ID Message
-					// Loop through the operator id in the raw decimal data and build a new string containing the operator id in ASCII
-					char operator_id_buf[21];  // initalize char array to hold the operator id string (which is at most 20 ASCII chars)
-					for (int i=0; i<20; i++) {
-						int decimal_val = raw->data[odid_identifier_idx + 8 + msg_num*25 + 2 + i];
-						operator_id_buf[i] = ASCII_DICTIONARY[decimal_val];
-					}
-					operator_id_buf[20] = '\0';
-					printf("OPERATOR ID (CAA-issued License): %s.\n\n", operator_id_buf);
-
-					operator_id_flag = 1;
-					break;
-			}
+	int32_t age = -1;
+
+	for (int i = 0; i < num_msgs; i++) {
+		if (msgs[i].type == ODID_MSG_SYSTEM) {
+			rid_clock_system(msgs[i].system.timestamp, rx_time);
+		} else if (msgs[i].type == ODID_MSG_LOCATION &&
+			   rid_clock_fix_age(msgs[i].location.timestamp, rx_time, &age)) {
+			rid_stats_record(RID_STAGE_AIR, age);
 		}
 	}
+
+	return age;
 }
 
-static void handle_wifi_scan_done(struct net_mgmt_event_callback *cb)
+static void decode_raw_scan_result(const struct rid_frame *frame)
 {
-	const struct wifi_status *status =
-		(const struct wifi_status *)cb->info;
+	const struct wifi_raw_scan_result *raw = &frame->raw;
+	size_t frame_len = MIN((size_t)MAX(raw->frame_length, 0), sizeof(raw->data));
+	size_t pack_len;
+	uint8_t counter;
+	enum odid_transport transport;
+	uint32_t start = rid_stats_start();
+
+	rid_stats_record(RID_STAGE_QUEUE, start - frame->cycles);
+
+	// beacons, NAN service discovery and action frames all lead to a pack in the frame
+	const uint8_t *pack = odid_locate_pack(raw->data, frame_len, &pack_len, &counter, &transport);
+
+	rid_stats_stop(RID_STAGE_LOCATE, start);
+	rid_capture_frame(frame, pack != NULL);
+	if (pack == NULL) {
+		return;  // not a Remote ID frame, which is most of them
+	}
 
-	if (status->status) {
-		LOG_ERR("Scan request failed (%d)", status->status);
-	} else {
-		scan_finished = 1;  // set global variable to indicate scanning is not longer in progress
-		// LOG_INF("Scan request done");
+	rid_sched_hit(raw->frequency);
+	rid_scan_hit(frame->radio);
+	if (rid_duty_hit(frame->timestamp)) {
+		rid_scan_kick();  // Remote ID is around: stop resting the radio
+	}
+
+	start = rid_stats_start();
+	bool wanted = rid_filter_frame(raw, pack, pack_len);
+
+	rid_stats_stop(RID_STAGE_FILTER, start);
+	if (!wanted) {
+		return;  // not what this site is looking for
+	}
+
+	start = rid_stats_start();
+	bool repeat = rid_dedup_repeat(raw, counter, pack, pack_len, frame->timestamp);
+
+	rid_stats_stop(RID_STAGE_DEDUP, start);
+	if (repeat) {
+		return;  // decoded and sent moments ago
+	}
+
+#if defined(CONFIG_RID_HEXDUMP)
+	LOG_HEXDUMP_DBG(raw->data, frame_len, "RID frame");
+#endif
+	struct odid_message msgs[ODID_PACK_MAX_MSGS];
+
+	start = rid_stats_start();
+	int num_msgs = odid_decode_pack(pack, pack_len, msgs, ARRAY_SIZE(msgs));
+
+	rid_stats_stop(RID_STAGE_DECODE, start);
+
+	// decoded first, so the record can carry the age of its position to the link
+	frame_air_ms = position_age(msgs, num_msgs, frame->timestamp);
+	frame_prio = RID_OUTPUT_PRIO_REPEAT;
+
+	if (num_msgs > 0) {
+		// the track table turns repeats into silence and reports only what changed
+		start = rid_stats_start();
+		rid_track_update(raw->data + 10, raw->rssi, raw->frequency, transport, msgs, num_msgs,
+				 frame->timestamp);
+		rid_stats_stop(RID_STAGE_TRACK, start);
+		rid_load_decoded(raw->data + 10, counter);
+	}
+
+	// pages are put together per aircraft; the complete data is verified on a work queue
+	for (int i = 0; i < num_msgs; i++) {
+		if (msgs[i].type == ODID_MSG_AUTH) {
+			rid_auth_page(raw->data + 10, &msgs[i].auth, frame->timestamp);
+		}
 	}
+
+	// tracked first, so the record goes out with what its events made of it
+	start = rid_stats_start();
+	rid_output_frame(frame, wifi_freq_to_channel(raw->frequency), frame_air_ms, frame_prio);
+	rid_stats_stop(RID_STAGE_OUTPUT, start);
 }
 
-static void wifi_mgmt_event_handler(struct net_mgmt_event_callback *cb,
-				     uint32_t mgmt_event, struct net_if *iface)
+/* Class of a frame that changed what is known about track. */
+static enum rid_output_prio changed_prio(const struct rid_track *track)
 {
-	switch (mgmt_event) {
-	case NET_EVENT_WIFI_RAW_SCAN_RESULT:
-		handle_wifi_raw_scan_result(cb);  // this func call is basically instantaneous
+#if defined(CONFIG_RID_GEOFENCE)
+	if (track->geofence[RID_GEOFENCE_UA].count > 0 || track->geofence[RID_GEOFENCE_OPERATOR].count > 0) {
+		return RID_OUTPUT_PRIO_URGENT;
+	}
+#endif
+#if defined(CONFIG_RID_OUTPUT_PRIORITY)
+	if (track->rssi >= CONFIG_RID_OUTPUT_NEAR_RSSI) {
+		return RID_OUTPUT_PRIO_NEAR;
+	}
+#endif
+
+	return RID_OUTPUT_PRIO_ROUTINE;
+}
+
+static void handle_track_event(enum rid_track_event event, const struct rid_track *track,
+			       const struct odid_message *msg)
+{
+	char mac_string_buf[sizeof("xx:xx:xx:xx:xx:xx")];
+	const char *mac = net_sprint_ll_addr_buf(track->mac, WIFI_MAC_ADDR_LEN,
+						 mac_string_buf, sizeof(mac_string_buf));
+
+	switch (event) {
+	case RID_TRACK_NEW:
+		frame_prio_raise(RID_OUTPUT_PRIO_URGENT);
+		rid_duty_detected(track->first_seen);
+		LOG_INF("NEW     %s | %-4u (%-6s) | %-4d",
+			mac,
+			wifi_freq_to_channel(track->frequency),
+			wifi_band_txt(wifi_freq_to_band(track->frequency)),
+			track->rssi);
 		break;
-	case NET_EVENT_WIFI_SCAN_DONE:
-		handle_wifi_scan_done(cb);  // this func call is basically instantaneous
+	case RID_TRACK_CHANGED:
+	case RID_TRACK_MOVED:
+		frame_prio_raise(changed_prio(track));
+#if defined(CONFIG_RID_TEXT)
+		printf("%s %s  ", event == RID_TRACK_MOVED ? "MOVED  " : "UPDATE ", mac);
+		if (msg->type == ODID_MSG_LOCATION && frame_air_ms >= 0) {
+			// from the position being taken to now, when it is shown;
+			// frame_air_ms is known not to be negative here
+			uint32_t age_ms = (uint32_t)frame_air_ms +
+					  (k_uptime_get_32() - track->last_seen);
+
+			printf("AGE (ms): %u.  ", age_ms);
+		}
+		odid_print_message(msg);
+#endif
 		break;
-	default:
+	case RID_TRACK_EXPIRED:
+		LOG_INF("EXPIRED %s | %u frames over %u s",
+			mac, track->frames, (track->last_seen - track->first_seen) / MSEC_PER_SEC);
 		break;
 	}
 }
 
-static int wifi_scan(void)
+#if defined(CONFIG_RID_GEOFENCE)
+static void handle_geofence_event(const struct rid_geofence_event *event)
 {
-	scan_finished = 0;  // set global variable to indicate scanning currently in progresss
-	
-	struct net_if *iface = net_if_get_default();
+	struct rid_record_alert alert = {
+		.event = event->type,
+		.subject = event->subject,
+		.zone = event->zone_id,
+		.latitude = event->latitude,
+		.longitude = event->longitude,
+		.altitude = event->altitude,
+	};
+	char mac_string_buf[sizeof("xx:xx:xx:xx:xx:xx")];
+
+	// the binary link first: it is what alerting on the host listens to
+	memcpy(alert.mac, event->mac, sizeof(alert.mac));
+	frame_prio_raise(RID_OUTPUT_PRIO_URGENT);
+	// only the position of the UA is stamped
+	int32_t air_ms = event->subject == RID_GEOFENCE_UA ? frame_air_ms : -1;
+
+	rid_output_alert(&alert, event->timestamp, air_ms);
+
+	LOG_WRN("%-7s %s | zone %u | %s at %d %d alt %d m | age %d ms",
+		rid_geofence_event_txt(event->type),
+		net_sprint_ll_addr_buf(event->mac, WIFI_MAC_ADDR_LEN, mac_string_buf, sizeof(mac_string_buf)),
+		event->zone_id, event->subject == RID_GEOFENCE_UA ? "UA" : "operator",
+		event->latitude, event->longitude, event->altitude / 10,
+		air_ms >= 0 ? air_ms + (int32_t)(k_uptime_get_32() - event->timestamp) : -1);
+}
+#endif
+
+static bool enqueue_radio_result(const struct wifi_raw_scan_result *raw, uint8_t radio)
+{
+	uint32_t start = rid_stats_start();
+	bool queued = rid_ring_push(raw, radio);
+
+	rid_stats_stop(RID_STAGE_ENQUEUE, start);
+
+	return queued;
+}
+
+#if defined(CONFIG_RID_REPLAY)
+// captures do not record the radio, so replayed frames all come from the first one
+static bool enqueue_raw_scan_result(const struct wifi_raw_scan_result *raw)
+{
+	return enqueue_radio_result(raw, 0);
+}
+#endif
+
+static void handle_wifi_raw_scan_result(struct net_mgmt_event_callback *cb, struct net_if *iface)
+{
+	/*
+	 runs in the net_mgmt event thread, so only queue the result; all decoding and
+	 printing happens in the decoder thread.
+	 */
+	enqueue_radio_result((const struct wifi_raw_scan_result *)cb->info, rid_scan_result(iface));
+}
+
+// a link that takes nothing for long, like an RTT channel with no host attached, is retried this often
+#define OUTPUT_RETRY_MAX_MS 1000
+
+/* Double the interval between flush retries while the output link stalls without taking a
+ * byte, and start over at 1 ms as soon as it takes something again.
+ */
+static uint32_t output_retry_ms(uint32_t retry_ms)
+{
+	static struct rid_output_stats last;
+	struct rid_output_stats out;
+	bool stuck;
+
+	rid_output_get_stats(&out);
+	stuck = out.stalls != last.stalls && out.bytes == last.bytes;
+	last = out;
+
+	return stuck ? MIN(retry_ms * 2, OUTPUT_RETRY_MAX_MS) : 1;
+}
+
+static void rid_decoder_thread(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	uint32_t retry_ms = 1;
 
-	if (net_mgmt(NET_REQUEST_WIFI_SCAN, iface, NULL, 0)) {
-		LOG_ERR("Scan request failed");
+	while (1) {
+		// while records are still waiting for room on the output link, wake up to retry the flush;
+		// otherwise wake up at least once per wheel tick to expire silent tracks
+		k_timeout_t timeout = K_MSEC(rid_output_pending() ? retry_ms : CONFIG_RID_TRACK_WHEEL_TICK_MS);
+		uint32_t batch = rid_ring_wait(CONFIG_RID_DECODER_BATCH, timeout);
 
-		return -ENOEXEC;
+		for (uint32_t i = 0; i < batch; i++) {
+			decode_raw_scan_result(rid_ring_peek(i));
+		}
+		rid_ring_release(batch);
+		rid_track_expire(k_uptime_get_32());
+		rid_auth_expire(k_uptime_get_32());
+		rid_output_flush();
+		retry_ms = output_retry_ms(retry_ms);
+		rid_capture_flush();
 	}
+}
 
-	// LOG_INF("Scan requested");
+K_THREAD_DEFINE(rid_decoder_tid, CONFIG_RID_DECODER_STACK_SIZE,
+		rid_decoder_thread, NULL, NULL, NULL,
+		CONFIG_RID_DECODER_PRIORITY, 0, 0);
 
-	return 0;
+static void log_ring_stats(void)
+{
+	struct rid_ring_stats stats;
+
+	struct rid_output_stats out;
+
+	rid_ring_get_stats(&stats);
+	LOG_INF("ring: pushed %u dropped %u high-water %u/%u depth %u",
+		stats.pushed, stats.dropped, stats.high_water,
+		CONFIG_RID_RING_SIZE, stats.depth);
+
+	rid_output_get_stats(&out);
+	LOG_INF("output: records %u dropped %u bytes %u stalls %u alerts %u dropped %u",
+		out.records, out.dropped, out.bytes, out.stalls, out.alerts, out.alerts_dropped);
+#if defined(CONFIG_RID_OUTPUT_PRIORITY)
+	LOG_INF("output shed: urgent %u near %u routine %u repeat %u, rate limited %u coalesced %u",
+		out.shed[RID_OUTPUT_PRIO_URGENT], out.shed[RID_OUTPUT_PRIO_NEAR],
+		out.shed[RID_OUTPUT_PRIO_ROUTINE], out.shed[RID_OUTPUT_PRIO_REPEAT],
+		out.rate_limited, out.coalesced);
+#endif
+
+#if defined(CONFIG_RID_FILTER)
+	struct rid_filter_stats filter;
+
+	rid_filter_get_stats(&filter);
+	LOG_INF("filter: rules %u frames %u dropped %u unmatched %u",
+		filter.rules, filter.frames, filter.dropped, filter.unmatched);
+#endif
+
+#if defined(CONFIG_RID_DEDUP)
+	struct rid_dedup_stats dedup;
+
+	rid_dedup_get_stats(&dedup);
+	LOG_INF("dedup: repeats %u new %u evicted %u, output bytes saved %u",
+		dedup.hits, dedup.misses, dedup.evictions, dedup.saved_bytes);
+#endif
+
+	struct rid_track_stats tracks;
+
+	rid_track_get_stats(&tracks);
+	LOG_INF("tracks: active %u created %u expired %u evicted %u events %u repeats suppressed %u",
+		tracks.active, tracks.created, tracks.expired, tracks.evicted,
+		tracks.events, tracks.suppressed);
+	LOG_INF("transports: beacon frames %u aircraft %u, NAN frames %u aircraft %u, "
+		"action frames %u aircraft %u",
+		tracks.frames_over[ODID_TRANSPORT_BEACON], tracks.aircraft_over[ODID_TRANSPORT_BEACON],
+		tracks.frames_over[ODID_TRANSPORT_NAN], tracks.aircraft_over[ODID_TRANSPORT_NAN],
+		tracks.frames_over[ODID_TRANSPORT_ACTION], tracks.aircraft_over[ODID_TRANSPORT_ACTION]);
+
+#if defined(CONFIG_RID_AUTH)
+	struct rid_auth_stats auth;
+
+	rid_auth_get_stats(&auth);
+	LOG_INF("auth: pages %u repeats %u invalid %u no room %u, slabs %u/%u high-water %u",
+		auth.pages, auth.repeats, auth.invalid, auth.no_room, auth.slabs_used,
+		CONFIG_RID_AUTH_SLOTS, auth.slabs_high_water);
+	LOG_INF("auth: blobs %u verified %u rejected %u unchecked %u, timed out %u superseded %u, "
+		"latency avg %u max %u ms",
+		auth.completed, auth.verified, auth.rejected, auth.unchecked, auth.timed_out,
+		auth.superseded, auth.latency_avg_ms, auth.latency_max_ms);
+#endif
+
+#if defined(CONFIG_RID_GEOFENCE)
+	struct rid_geofence_stats fence;
+
+	rid_geofence_get_stats(&fence);
+	LOG_INF("geofence: zones %u checks %u candidates %u enters %u exits %u breaches %u",
+		fence.zones, fence.checks, fence.candidates, fence.enters, fence.exits, fence.breaches);
+#endif
+
+#if defined(CONFIG_RID_CLOCK)
+	struct rid_clock_stats clock;
+
+	rid_clock_get_stats(&clock);
+	LOG_INF("clock: %s, steps %u (last %d ms) rejected %u positions ahead %u",
+		rid_clock_source_txt(clock.source), clock.steps, clock.last_step_ms,
+		clock.rejected, clock.ahead);
+#endif
+
+#if defined(CONFIG_RID_MOTION)
+	struct rid_motion_stats motion;
+
+	rid_motion_get_stats(&motion);
+	LOG_INF("motion: updates %u skipped %u held out %u, error avg %u max %u cm, "
+		"last fix avg %u max %u cm, position sigma avg %u cm",
+		motion.updates, motion.skipped, motion.held_out, motion.error_avg_cm,
+		motion.error_max_cm, motion.stale_avg_cm, motion.stale_max_cm, motion.sigma_avg_cm);
+#endif
+
+#if defined(CONFIG_RID_MONITOR)
+	struct rid_monitor_stats monitor;
+
+	rid_monitor_get_stats(&monitor);
+	LOG_INF("monitor: frames %u bytes %u dropped %u truncated %u errors %u over %u ms",
+		monitor.frames, monitor.bytes, monitor.dropped, monitor.truncated,
+		monitor.errors, monitor.elapsed_ms);
+#endif
+
+	for (int i = 0; i < rid_scan_radio_count(); i++) {
+		struct rid_scan_stats scan;
+
+		rid_scan_get_stats(i, &scan);
+		LOG_INF("scan %d (if %d): %s, done %u (%u.%02u/s) failed %u timed out %u backoff %u ms "
+			"gap avg %u max %u us, results %u hits %u",
+			i, scan.ifindex, rid_scan_state_txt(scan.state), scan.scans,
+			scan.scans_per_100s / 100, scan.scans_per_100s % 100, scan.failures,
+			scan.timeouts, scan.backoff_ms, scan.gap_avg_us, scan.gap_max_us,
+			scan.results, scan.hits);
+	}
+
+	struct rid_duty_stats duty;
+
+	rid_duty_get_stats(&duty);
+	LOG_INF("duty: %s, active %u decay %u sentinel %u s, radio on %u/%u s, avg %u uA",
+		rid_duty_mode_txt(duty.mode), duty.mode_ms[RID_DUTY_ACTIVE] / MSEC_PER_SEC,
+		duty.mode_ms[RID_DUTY_DECAY] / MSEC_PER_SEC,
+		duty.mode_ms[RID_DUTY_SENTINEL] / MSEC_PER_SEC,
+		duty.radio_ms / MSEC_PER_SEC, duty.elapsed_ms / MSEC_PER_SEC, duty.avg_current_ua);
+	LOG_INF("detect: %u aircraft, %u mJ each, latency avg %u max %u ms, escalations %u",
+		duty.detections, duty.energy_per_detection_mj, duty.latency_avg_ms,
+		duty.latency_max_ms, duty.escalations);
+
+	for (int i = 0; i < rid_sched_channel_count(); i++) {
+		struct rid_sched_stats ch;
+
+		rid_sched_get_stats(i, &ch);
+		LOG_INF("ch %-3u: radio %u weight %u/%u scans %u hits %u (%u.%02u/scan) revisit avg %u max %u ms",
+			ch.channel, ch.radio, ch.weight, ch.base_weight, ch.scans, ch.hits,
+			ch.hits_per_100 / 100, ch.hits_per_100 % 100,
+			ch.revisit_avg_ms, ch.revisit_max_ms);
+	}
+
+#if defined(CONFIG_RID_STATS)
+	// the stages this run went through, as "wifi rid stats" shows them
+	for (int stage = 0; stage < RID_STAGE_COUNT; stage++) {
+		struct rid_stage_summary s;
+
+		rid_stats_summary(stage, &s);
+		if (s.count > 0) {
+			LOG_INF("stage %s: %u, p50 %u%s p99 %u%s max %u%s",
+				s.name, s.count, s.p50, s.unit, s.p99, s.unit, s.max, s.unit);
+		}
+	}
+#endif
+}
+
+#if defined(CONFIG_RID_REPLAY) || defined(RID_MONITOR_HAVE_PCAP) || defined(CONFIG_RID_LOAD)
+/* Let the decoder drain the ring before reporting. */
+static void drain_and_log_stats(void)
+{
+	struct rid_ring_stats ring;
+
+	do {
+		k_sleep(K_MSEC(10));
+		rid_ring_get_stats(&ring);
+	} while (ring.depth > 0 || rid_output_pending() > 0);
+	log_ring_stats();
+}
+#endif
+
+static void handle_wifi_scan_done(struct net_mgmt_event_callback *cb, struct net_if *iface)
+{
+	const struct wifi_status *status =
+		(const struct wifi_status *)cb->info;
+
+	rid_scan_done(iface, status->status);  // kicks the next request (or a backoff retry) on the scan work queue
+}
+
+static void wifi_mgmt_event_handler(struct net_mgmt_event_callback *cb,
+				     uint32_t mgmt_event, struct net_if *iface)
+{
+	switch (mgmt_event) {
+	case NET_EVENT_WIFI_RAW_SCAN_RESULT:
+		handle_wifi_raw_scan_result(cb, iface);  // this func call is basically instantaneous
+		break;
+	case NET_EVENT_WIFI_SCAN_DONE:
+		handle_wifi_scan_done(cb, iface);  // this func call is basically instantaneous
+		break;
+	default:
+		break;
+	}
 }
 
 int main(void)
 {
 	LOG_INF("==================================PROGRAM STARTING==================================");
 
+	rid_stats_init();
+	rid_track_init(handle_track_event);
+	rid_filter_init();
+	rid_auth_init();
+	rid_capture_init();
+#if defined(CONFIG_RID_GEOFENCE)
+	rid_geofence_init(handle_geofence_event);
+#endif
+
 	net_mgmt_init_event_callback(&wifi_shell_mgmt_cb,
 				     wifi_mgmt_event_handler,
 				     WIFI_SHELL_MGMT_EVENTS);
 
 	net_mgmt_add_event_callback(&wifi_shell_mgmt_cb);
 
+#if defined(CONFIG_HAS_NRFX)
 #ifdef CLOCK_FEATURE_HFCLK_DIVIDE_PRESENT
 	/* For now hardcode to 128MHz */
 	nrfx_clock_divider_set(NRF_CLOCK_DOMAIN_HFCLK,
 			       NRF_CLOCK_HFCLK_DIV_1);
 #endif
 	LOG_INF("Starting %s with CPU frequency: %d MHz", CONFIG_BOARD, SystemCoreClock / MHZ(1));  // should be nrf7002dk_nrf5340_cpuapp with 128 MHz
+#endif
 
-	scan_finished = 1;
+#if defined(CONFIG_RID_OUTPUT_BENCH)
+	rid_output_bench();
+	return 0;
+#elif defined(CONFIG_RID_DECODE_BENCH)
+	rid_decode_bench();
+	return 0;
+#elif defined(CONFIG_RID_REPLAY)
+	// captured traffic instead of the radio, through the same queue and decoder
+	rid_replay_run(enqueue_raw_scan_result);
+	drain_and_log_stats();
+	return 0;
+#elif defined(RID_MONITOR_HAVE_PCAP)
+	rid_monitor_pcap_run(enqueue_radio_result);
+	drain_and_log_stats();
+	return 0;
+#elif defined(CONFIG_RID_LOAD)
+	// synthetic traffic through the net_mgmt event queue and the handler registered above
+	rid_load_run();
+	drain_and_log_stats();
+	return 0;
+#endif
+
+#if defined(CONFIG_RID_MONITOR)
+	if (rid_monitor_start(enqueue_radio_result)) {
+		return 0;
+	}
+#else
+	rid_scan_start();
+#endif
 
+	// scanning runs off the net_mgmt events from here on; main only reports
 	while(1) {
-		if (scan_finished == 1) {  // only perform a scan if not another scan is currently in progress
-			wifi_scan();
+		if (CONFIG_RID_RING_STATS_INTERVAL > 0) {
+			k_sleep(K_SECONDS(CONFIG_RID_RING_STATS_INTERVAL));
+			log_ring_stats();
+		} else {
+			k_sleep(K_FOREVER);
 		}
-		k_sleep(K_SECONDS(0.01));
 	}
 
 	LOG_INF("EXITED LOOP");
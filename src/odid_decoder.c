@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "odid_decoder.h"
+
+typedef void (*odid_decode_fn)(const uint8_t *msg, struct odid_message *out);
+
+#if ODID_DECODE_BASIC_ID
+static void decode_basic_id(const uint8_t *msg, struct odid_message *out)
+{
+	struct odid_basic_id *m = &out->basic_id;
+
+	m->id_type = msg[1] >> 4;
+	m->ua_type = msg[1] & 0x0F;
+	m->uas_id = &msg[2];
+}
+#endif
+
+#if ODID_DECODE_LOCATION
+static void decode_location(const uint8_t *msg, struct odid_message *out)
+{
+	struct odid_location *m = &out->location;
+	uint8_t flags = msg[1];
+
+	m->status = flags >> 4;
+	m->height_type = (flags >> 2) & 0x01;
+
+	// bit 1 says the encoded direction is in the 180-359 degree half
+	m->direction = msg[2] + ((flags & 0x02) ? 180 : 0);
+
+	// bit 0 selects the 0.75 m/s step that starts above the range of the 0.25 m/s step
+	m->speed = (flags & 0x01) ? msg[3] * 75 + 6375 : msg[3] * 25;
+	m->vertical_speed = (int8_t)msg[4] * 50;
+
+	m->latitude = (int32_t)odid_le32(&msg[5]);
+	m->longitude = (int32_t)odid_le32(&msg[9]);
+	m->pressure_altitude = odid_altitude_dm(&msg[13]);
+	m->geodetic_altitude = odid_altitude_dm(&msg[15]);
+	m->height = odid_altitude_dm(&msg[17]);
+
+	m->vertical_accuracy = msg[19] >> 4;
+	m->horizontal_accuracy = msg[19] & 0x0F;
+	m->baro_accuracy = msg[20] >> 4;
+	m->speed_accuracy = msg[20] & 0x0F;
+
+	m->timestamp = odid_le16(&msg[21]);
+	m->timestamp_accuracy = msg[23] & 0x0F;
+}
+#endif
+
+#if ODID_DECODE_AUTH
+static void decode_auth(const uint8_t *msg, struct odid_message *out)
+{
+	struct odid_auth *m = &out->auth;
+
+	m->auth_type = msg[1] >> 4;
+	m->page = msg[1] & 0x0F;
+	if (m->page == 0) {
+		m->last_page = msg[2];
+		m->length = msg[3];
+		m->timestamp = odid_le32(&msg[4]);
+		m->data = &msg[8];
+	} else {
+		m->last_page = 0;
+		m->length = 0;
+		m->timestamp = 0;
+		m->data = &msg[2];
+	}
+}
+#endif
+
+#if ODID_DECODE_SELF_ID
+static void decode_self_id(const uint8_t *msg, struct odid_message *out)
+{
+	struct odid_self_id *m = &out->self_id;
+
+	m->description_type = msg[1];
+	m->description = &msg[2];
+}
+#endif
+
+#if ODID_DECODE_SYSTEM
+static void decode_system(const uint8_t *msg, struct odid_message *out)
+{
+	struct odid_system *m = &out->system;
+
+	m->operator_location_type = msg[1] & 0x03;
+	m->classification_type = (msg[1] >> 2) & 0x07;
+	m->operator_latitude = (int32_t)odid_le32(&msg[2]);
+	m->operator_longitude = (int32_t)odid_le32(&msg[6]);
+	m->area_count = odid_le16(&msg[10]);
+	m->area_radius = msg[12] * 10;
+	m->area_ceiling = odid_altitude_dm(&msg[13]);
+	m->area_floor = odid_altitude_dm(&msg[15]);
+	m->ua_category = msg[17] >> 4;
+	m->ua_class = msg[17] & 0x0F;
+	m->operator_altitude = odid_altitude_dm(&msg[18]);
+	m->timestamp = odid_le32(&msg[20]);
+}
+#endif
+
+#if ODID_DECODE_OPERATOR_ID
+static void decode_operator_id(const uint8_t *msg, struct odid_message *out)
+{
+	struct odid_operator_id *m = &out->operator_id;
+
+	m->id_type = msg[1];
+	m->operator_id = &msg[2];
+}
+#endif
+
+static const odid_decode_fn decoders[ODID_MSG_TYPE_COUNT] = {
+#if ODID_DECODE_BASIC_ID
+	[ODID_MSG_BASIC_ID] = decode_basic_id,
+#endif
+#if ODID_DECODE_LOCATION
+	[ODID_MSG_LOCATION] = decode_location,
+#endif
+#if ODID_DECODE_AUTH
+	[ODID_MSG_AUTH] = decode_auth,
+#endif
+#if ODID_DECODE_SELF_ID
+	[ODID_MSG_SELF_ID] = decode_self_id,
+#endif
+#if ODID_DECODE_SYSTEM
+	[ODID_MSG_SYSTEM] = decode_system,
+#endif
+#if ODID_DECODE_OPERATOR_ID
+	[ODID_MSG_OPERATOR_ID] = decode_operator_id,
+#endif
+};
+
+int odid_decode_message(const uint8_t *msg, struct odid_message *out)
+{
+	uint8_t type = odid_msg_type_of(msg);
+
+	out->type = type;
+	// the mask is a build-time constant and has a bit for exactly the decoders in the table
+	if (!(ODID_DECODE_MASK & (1U << type))) {
+		return -1;
+	}
+	decoders[type](msg, out);
+
+	return type;
+}
+
+int odid_decode_pack(const uint8_t *pack, size_t len, struct odid_message *out, size_t max)
+{
+	if (len < ODID_PACK_HDR_SIZE || odid_msg_type_of(pack) != ODID_MSG_PACK ||
+	    pack[1] != ODID_MSG_SIZE || pack[2] > ODID_PACK_MAX_MSGS) {
+		return -1;
+	}
+
+	size_t count = pack[2];
+	const uint8_t *msg = &pack[ODID_PACK_HDR_SIZE];
+
+	if (len < ODID_PACK_HDR_SIZE + count * ODID_MSG_SIZE) {
+		return -1;
+	}
+
+	size_t n = 0;
+
+	for (size_t i = 0; i < count && n < max; i++, msg += ODID_MSG_SIZE) {
+		if (odid_decode_message(msg, &out[n]) >= 0) {
+			n++;
+		}
+	}
+
+	return (int)n;
+}
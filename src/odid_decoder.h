@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Open Drone ID (ASTM F3411) message decoder
+ *
+ * Decodes the 25-byte messages of a message pack straight out of the received
+ * frame into typed structs. Nothing is copied or allocated: text fields point
+ * back into the frame and are not NUL-terminated. Physical values are kept as
+ * scaled integers (units are given per field); turning them into text is left
+ * to odid_format.h.
+ *
+ * Depends only on the C library so it can be built and benchmarked on a host.
+ */
+
+#ifndef ODID_DECODER_H_
+#define ODID_DECODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ODID_MSG_SIZE        25
+#define ODID_ID_SIZE         20
+#define ODID_STR_SIZE        23
+#define ODID_PACK_HDR_SIZE   3
+#define ODID_PACK_MAX_MSGS   9
+
+/* Authentication data is split over pages: page 0 carries the length and a
+ * timestamp ahead of its share, the later pages carry nothing else.
+ */
+#define ODID_AUTH_MAX_PAGES    16
+#define ODID_AUTH_PAGE0_DATA   17
+#define ODID_AUTH_PAGE_DATA    23
+
+/* Message types, from the upper nibble of the first byte of every message. */
+enum odid_msg_type {
+	ODID_MSG_BASIC_ID = 0,
+	ODID_MSG_LOCATION = 1,
+	ODID_MSG_AUTH = 2,
+	ODID_MSG_SELF_ID = 3,
+	ODID_MSG_SYSTEM = 4,
+	ODID_MSG_OPERATOR_ID = 5,
+	ODID_MSG_PACK = 15,
+	ODID_MSG_TYPE_COUNT = 16,
+};
+
+/* Message types that get a decoder; the others are skipped like unknown
+ * types. Zephyr builds choose them with the CONFIG_RID_DECODE_* options; host
+ * builds have no Kconfig and decode every type.
+ */
+#if !defined(__ZEPHYR__) || defined(CONFIG_RID_DECODE_BASIC_ID)
+#define ODID_DECODE_BASIC_ID 1
+#else
+#define ODID_DECODE_BASIC_ID 0
+#endif
+#if !defined(__ZEPHYR__) || defined(CONFIG_RID_DECODE_LOCATION)
+#define ODID_DECODE_LOCATION 1
+#else
+#define ODID_DECODE_LOCATION 0
+#endif
+#if !defined(__ZEPHYR__) || defined(CONFIG_RID_DECODE_AUTH)
+#define ODID_DECODE_AUTH 1
+#else
+#define ODID_DECODE_AUTH 0
+#endif
+#if !defined(__ZEPHYR__) || defined(CONFIG_RID_DECODE_SELF_ID)
+#define ODID_DECODE_SELF_ID 1
+#else
+#define ODID_DECODE_SELF_ID 0
+#endif
+#if !defined(__ZEPHYR__) || defined(CONFIG_RID_DECODE_SYSTEM)
+#define ODID_DECODE_SYSTEM 1
+#else
+#define ODID_DECODE_SYSTEM 0
+#endif
+#if !defined(__ZEPHYR__) || defined(CONFIG_RID_DECODE_OPERATOR_ID)
+#define ODID_DECODE_OPERATOR_ID 1
+#else
+#define ODID_DECODE_OPERATOR_ID 0
+#endif
+
+#define ODID_DECODE_MASK ((ODID_DECODE_BASIC_ID << ODID_MSG_BASIC_ID) |	\
+			  (ODID_DECODE_LOCATION << ODID_MSG_LOCATION) |	\
+			  (ODID_DECODE_AUTH << ODID_MSG_AUTH) |		\
+			  (ODID_DECODE_SELF_ID << ODID_MSG_SELF_ID) |	\
+			  (ODID_DECODE_SYSTEM << ODID_MSG_SYSTEM) |	\
+			  (ODID_DECODE_OPERATOR_ID << ODID_MSG_OPERATOR_ID))
+
+#define ODID_PACKED __attribute__((packed))
+
+struct odid_basic_id {
+	uint8_t id_type;               // enum ID_TYPE
+	uint8_t ua_type;               // enum UA_TYPE
+	const uint8_t *uas_id;         // ODID_ID_SIZE bytes in the frame
+} ODID_PACKED;
+
+struct odid_location {
+	uint8_t status;                // enum OPERATIONAL_STATUS
+	uint8_t height_type;           // enum HEIGHT_TYPE
+	uint16_t direction;            // degrees clockwise from true north
+	uint16_t speed;                // ground speed, cm/s
+	int16_t vertical_speed;        // cm/s, positive up
+	int32_t latitude;              // 1e-7 degrees
+	int32_t longitude;             // 1e-7 degrees
+	int32_t pressure_altitude;     // decimetres
+	int32_t geodetic_altitude;     // decimetres
+	int32_t height;                // decimetres
+	uint8_t horizontal_accuracy;   // enum HORIZONTAL_ACCURACY
+	uint8_t vertical_accuracy;     // enum VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY
+	uint8_t baro_accuracy;         // enum VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY
+	uint8_t speed_accuracy;        // enum SPEED_ACCURACY
+	uint16_t timestamp;            // tenths of a second since the full hour (UTC)
+	uint8_t timestamp_accuracy;    // tenths of a second, 0 = unknown
+} ODID_PACKED;
+
+struct odid_auth {
+	uint8_t auth_type;             // enum AUTH_TYPE
+	uint8_t page;                  // 0 to ODID_AUTH_MAX_PAGES - 1
+	uint8_t last_page;             // page 0 only
+	uint8_t length;                // bytes of authentication data over all pages; page 0 only
+	uint32_t timestamp;            // seconds since 2019-01-01 00:00:00 UTC; page 0 only
+	const uint8_t *data;           // ODID_AUTH_PAGE0_DATA bytes in the frame on page 0, else ODID_AUTH_PAGE_DATA
+} ODID_PACKED;
+
+struct odid_self_id {
+	uint8_t description_type;      // enum SELF_ID_TYPE
+	const uint8_t *description;    // ODID_STR_SIZE bytes in the frame
+} ODID_PACKED;
+
+struct odid_system {
+	uint8_t operator_location_type;  // enum OPERATOR_LOCATION_ALTITUDE_SOURCE_TYPE
+	uint8_t classification_type;
+	int32_t operator_latitude;       // 1e-7 degrees
+	int32_t operator_longitude;      // 1e-7 degrees
+	uint16_t area_count;
+	uint16_t area_radius;            // metres
+	int32_t area_ceiling;            // decimetres
+	int32_t area_floor;              // decimetres
+	uint8_t ua_category;             // enum UA_CATEGORY
+	uint8_t ua_class;                // enum UA_CLASS
+	int32_t operator_altitude;       // decimetres
+	uint32_t timestamp;              // seconds since 2019-01-01 00:00:00 UTC
+} ODID_PACKED;
+
+struct odid_operator_id {
+	uint8_t id_type;
+	const uint8_t *operator_id;    // ODID_ID_SIZE bytes in the frame
+} ODID_PACKED;
+
+struct odid_message {
+	uint8_t type;                  // enum odid_msg_type
+	union {
+		struct odid_basic_id basic_id;
+		struct odid_location location;
+		struct odid_auth auth;
+		struct odid_self_id self_id;
+		struct odid_system system;
+		struct odid_operator_id operator_id;
+	};
+} ODID_PACKED;
+
+/* Little-endian field extractors; the frame gives no alignment guarantees. */
+static inline uint16_t odid_le16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t odid_le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* ODID altitudes are 0.5 m steps offset by -1000 m. */
+static inline int32_t odid_altitude_dm(const uint8_t *p)
+{
+	return (int32_t)odid_le16(p) * 5 - 10000;
+}
+
+static inline uint8_t odid_msg_type_of(const uint8_t *msg)
+{
+	return msg[0] >> 4;
+}
+
+/* Decode a single 25-byte message. Returns its enum odid_msg_type, or -1 if
+ * the type has no decoder or its decoder is not built (out is then left
+ * untouched apart from type).
+ */
+int odid_decode_message(const uint8_t *msg, struct odid_message *out);
+
+/* Decode a message pack: pack header (type/version, message size, count)
+ * followed by the messages. len is the number of bytes available from pack.
+ * Returns the number of messages written to out (at most max, messages of
+ * undecoded types are skipped), or -1 if the pack header is malformed or
+ * runs past len.
+ */
+int odid_decode_pack(const uint8_t *pack, size_t len, struct odid_message *out, size_t max);
+
+#endif /* ODID_DECODER_H_ */
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "odid_format.h"
+#include "enums.h"
+
+// ID and description bytes as printable characters: letters, digits, ' ', '-' and '.' pass through,
+// NUL padding ends the string and every other byte value prints as '_'
+static const char ascii_map[256] = {
+	[0] = '\0',
+	[1 ... ' ' - 1] = '_',
+	[' '] = ' ',
+	['!' ... '-' - 1] = '_',
+	['-'] = '-', '.', '_',
+	['0'] = '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+	['9' + 1 ... 'A' - 1] = '_',
+	['A'] = 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M',
+		'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
+	['Z' + 1 ... 'a' - 1] = '_',
+	['a'] = 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm',
+		'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
+	['z' + 1 ... 255] = '_',
+};
+
+static const char hex_digits[16] = "0123456789ABCDEF";
+
+void odid_format_ascii(char *dst, const uint8_t *src, size_t len)
+{
+	size_t i = 0;
+
+	// a word in and a word out; each byte lane maps in place, so this is endian-neutral
+	for (; i + sizeof(uint32_t) <= len; i += sizeof(uint32_t)) {
+		uint32_t w;
+
+		memcpy(&w, &src[i], sizeof(w));
+		w = (uint32_t)(uint8_t)ascii_map[w & 0xFF] |
+		    (uint32_t)(uint8_t)ascii_map[(w >> 8) & 0xFF] << 8 |
+		    (uint32_t)(uint8_t)ascii_map[(w >> 16) & 0xFF] << 16 |
+		    (uint32_t)(uint8_t)ascii_map[w >> 24] << 24;
+		memcpy(&dst[i], &w, sizeof(w));
+	}
+	for (; i < len; i++) {
+		dst[i] = ascii_map[src[i]];
+	}
+	dst[len] = '\0';
+}
+
+void odid_format_hex(char *dst, const uint8_t *src, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		dst[2 * i] = hex_digits[src[i] >> 4];
+		dst[2 * i + 1] = hex_digits[src[i] & 0x0F];
+	}
+	dst[2 * len] = '\0';
+}
+
+#if defined(CONFIG_RID_TEXT)
+static void print_basic_id(const struct odid_basic_id *m)
+{
+	char id_buf[2 * ODID_ID_SIZE + 1];
+
+	printf("ID TYPE: %s.  ", ENUM_STRING(ID_TYPE_STRING, m->id_type));
+	printf("UA TYPE: %s.  ", ENUM_STRING(UA_TYPE_STRING, m->ua_type));
+
+	switch (m->id_type) {
+	case ID_NONE:
+		printf("NULL UAV ID: 00000000000000000000.\n\n");
+		break;
+	case SERIAL_NUMBER_ANSI_CTA_2063_A:
+	case CAA_ASSIGNED_REGISTRATION_ID:
+		odid_format_ascii(id_buf, m->uas_id, ODID_ID_SIZE);
+		printf("SERIAL NUMBER/CAA REGISTRATION NUMBER: %s.\n\n", id_buf);
+		break;
+	case UTM_ASSIGNED_UUID:  // 128-bit UUID, printed as 32 hex chars
+		odid_format_hex(id_buf, m->uas_id, 16);
+		printf("UTM UUID: %s.\n\n", id_buf);
+		break;
+	case SPECIFIC_SESSION_ID:  // 1st byte is a number between 0 and 255, the remaining 19 bytes are alphanumeric (RFC 9153)
+		// the type byte is printed as two hex digits, as it is not a character
+		odid_format_hex(id_buf, m->uas_id, 1);
+		odid_format_ascii(&id_buf[2], &m->uas_id[1], ODID_ID_SIZE - 1);
+		printf("SPECIFIC SESSION ID: %s.\n\n", id_buf);
+		break;
+	default:
+		printf("\n\n");
+		break;
+	}
+}
+
+static void print_location(const struct odid_location *m)
+{
+	printf("OPERATIONAL STATUS: %s.  ", ENUM_STRING(OPERATIONAL_STATUS_STRING, m->status));
+	printf("HEIGHT TYPE: %s.  ", ENUM_STRING(HEIGHT_TYPE_STRING, m->height_type));
+	printf("HEADING (deg): %d.  ", m->direction);
+	printf("SPEED (m/s): %d.%02d.  ", m->speed / 100, m->speed % 100);
+	printf("VERTICAL SPEED (m/s): %s%d.%02d.  ", m->vertical_speed < 0 ? "-" : "",
+	       abs(m->vertical_speed) / 100, abs(m->vertical_speed) % 100);
+	printf("LAT: %d.  ", m->latitude);
+	printf("LON: %d.  ", m->longitude);
+	printf("PRESSURE ALT: %d.  ", m->pressure_altitude / 10);
+	printf("GEO ALT: %d.  ", m->geodetic_altitude / 10);
+	printf("HEIGHT: %d.  ", m->height / 10);
+	printf("HORIZONTAL ACCURACY: %s.  ", ENUM_STRING(HORIZONTAL_ACCURACY_STRING, m->horizontal_accuracy));
+	printf("VERTICAL ACCURACY: %s.  ", ENUM_STRING(VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY_STRING, m->vertical_accuracy));
+	printf("BARO ALT ACCURACY: %s.  ", ENUM_STRING(VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY_STRING, m->baro_accuracy));
+	printf("SPEED ACCURACY: %s.  ", ENUM_STRING(SPEED_ACCURACY_STRING, m->speed_accuracy));
+	if (m->timestamp < 36000) {
+		printf("TIMESTAMP (mm:ss past the hour): %02u:%02u.%u.  ", m->timestamp / 600,
+		       m->timestamp / 10 % 60, m->timestamp % 10);
+	} else {
+		printf("TIMESTAMP: unknown.  ");
+	}
+	printf("TIMESTAMP_ACCURACY (btwn 0.1-1.5s): %d.%d\n\n",
+	       m->timestamp_accuracy / 10, m->timestamp_accuracy % 10);
+}
+
+static void print_auth(const struct odid_auth *m)
+{
+	char data_buf[2 * ODID_AUTH_PAGE_DATA + 1];
+
+	printf("AUTH TYPE: %s.  ", ENUM_STRING(AUTH_TYPE_STRING, m->auth_type));
+	printf("PAGE: %u.  ", m->page);
+	if (m->page == 0) {
+		printf("LAST PAGE: %u.  ", m->last_page);
+		printf("LENGTH: %u.  ", m->length);
+		printf("TIMESTAMP (secs from 00:00:00 01/01/2019): %u.  ", m->timestamp);
+	}
+	odid_format_hex(data_buf, m->data, m->page == 0 ? ODID_AUTH_PAGE0_DATA : ODID_AUTH_PAGE_DATA);
+	printf("AUTH DATA: %s.\n\n", data_buf);
+}
+
+static void print_self_id(const struct odid_self_id *m)
+{
+	char description_buf[ODID_STR_SIZE + 1];
+
+	odid_format_ascii(description_buf, m->description, ODID_STR_SIZE);
+	printf("SELF ID TYPE: %s.  ", ENUM_STRING(SELF_ID_TYPE_STRING, m->description_type));
+	printf("SELF ID: %s.\n\n", description_buf);
+}
+
+static void print_system(const struct odid_system *m)
+{
+	printf("OPERATOR LOCATION SOURCE TYPE: %s.  ", ENUM_STRING(OPERATOR_LOCATION_ALTITUDE_SOURCE_TYPE_STRING, m->operator_location_type));
+	printf("OPERATOR LAT: %d.  ", m->operator_latitude);
+	printf("OPERATOR LON: %d.  ", m->operator_longitude);
+	printf("OPERATOR ALT: %d.  ", m->operator_altitude / 10);
+	printf("AREA COUNT: %d.  ", m->area_count);
+	printf("AREA RADIUS: %d.  ", m->area_radius);
+	printf("AREA CEILING: %d.  ", m->area_ceiling / 10);
+	printf("AREA FLOOR: %d.  ", m->area_floor / 10);
+	printf("UA CATEGORY: %s.  ", ENUM_STRING(UA_CATEGORY_STRING, m->ua_category));
+	printf("UA CLASS: %s.  ", ENUM_STRING(UA_CLASS_STRING, m->ua_class));
+	printf("TIMESTAMP (secs from 00:00:00 01/01/2019): %u.\n\n", m->timestamp);
+}
+
+static void print_operator_id(const struct odid_operator_id *m)
+{
+	char operator_id_buf[ODID_ID_SIZE + 1];
+
+	odid_format_ascii(operator_id_buf, m->operator_id, ODID_ID_SIZE);
+	printf("OPERATOR ID (CAA-issued License): %s.\n\n", operator_id_buf);
+}
+
+void odid_print_message(const struct odid_message *msg)
+{
+	// printers of message types that are not decoded are dropped along with their name tables
+	switch (msg->type) {
+	case ODID_MSG_BASIC_ID:
+		if (ODID_DECODE_BASIC_ID) {
+			print_basic_id(&msg->basic_id);
+		}
+		break;
+	case ODID_MSG_LOCATION:
+		if (ODID_DECODE_LOCATION) {
+			print_location(&msg->location);
+		}
+		break;
+	case ODID_MSG_AUTH:
+		if (ODID_DECODE_AUTH) {
+			print_auth(&msg->auth);
+		}
+		break;
+	case ODID_MSG_SELF_ID:
+		if (ODID_DECODE_SELF_ID) {
+			print_self_id(&msg->self_id);
+		}
+		break;
+	case ODID_MSG_SYSTEM:
+		if (ODID_DECODE_SYSTEM) {
+			print_system(&msg->system);
+		}
+		break;
+	case ODID_MSG_OPERATOR_ID:
+		if (ODID_DECODE_OPERATOR_ID) {
+			print_operator_id(&msg->operator_id);
+		}
+		break;
+	default:
+		break;
+	}
+}
+#endif /* CONFIG_RID_TEXT */
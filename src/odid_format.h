@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Human-readable printing of decoded ODID messages
+ */
+
+#ifndef ODID_FORMAT_H_
+#define ODID_FORMAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "odid_decoder.h"
+
+/* Write len ID or description bytes to dst as printable characters, NUL
+ * terminated; dst holds len + 1 bytes.
+ */
+void odid_format_ascii(char *dst, const uint8_t *src, size_t len);
+
+/* Write len bytes to dst as upper case hex, NUL terminated; dst holds 2 * len + 1 bytes. */
+void odid_format_hex(char *dst, const uint8_t *src, size_t len);
+
+/* Print one decoded message to stdout, one line per message. Only built with CONFIG_RID_TEXT. */
+void odid_print_message(const struct odid_message *msg);
+
+#endif /* ODID_FORMAT_H_ */
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+
+#include "odid_decoder.h"
+#include "odid_locate.h"
+
+// FA 0B BC 0D (ASD-STAN OUI and the ODID OUI type) read as one little-endian word
+#define ODID_OUI_TYPE_LE 0x0DBC0BFAU
+
+#define WLAN_FC_TYPE_MASK        0xFC
+#define WLAN_FC_BEACON           0x80
+#define WLAN_FC_PROBE_RESP       0x50
+#define WLAN_FC_ACTION           0xD0
+#define WLAN_FC_ACTION_NO_ACK    0xE0
+
+#define WLAN_EID_VENDOR_SPECIFIC 221
+
+#define WLAN_ACTION_PUBLIC          4
+#define WLAN_ACTION_VENDOR_SPECIFIC 127
+#define WLAN_PA_VENDOR_SPECIFIC     9
+
+// 50 6F 9A 13 (Wi-Fi Alliance OUI and the NAN OUI type) read as one little-endian word
+#define NAN_OUI_TYPE_LE          0x139A6F50U
+#define NAN_ATTR_SERVICE_DESC    0x03
+#define NAN_ATTR_HDR_SIZE        3
+
+// service control bits announcing the optional fields of a service descriptor
+#define NAN_SC_MATCHING_FILTER   0x04
+#define NAN_SC_RESPONSE_FILTER   0x08
+#define NAN_SC_SERVICE_INFO      0x10
+#define NAN_SC_BINDING_BITMAP    0x40
+
+// 24-byte management header, then timestamp (8), beacon interval (2) and capabilities (2)
+#define BEACON_IES_OFFSET        36
+#define ACTION_BODY_OFFSET       24
+
+// OUI + OUI type, message counter and the message pack header
+#define ODID_VENDOR_MIN_LEN      (4 + 1 + ODID_PACK_HDR_SIZE)
+
+// service ID, instance ID, requestor instance ID and service control
+#define NAN_SERVICE_DESC_MIN_LEN (6 + 1 + 1 + 1)
+
+/* The first 6 bytes of the SHA-256 hash of "org.opendroneid.remoteid" */
+static const uint8_t odid_service_id[6] = {0x88, 0x69, 0x19, 0x9D, 0x92, 0x09};
+
+static const uint8_t *locate_in_elements(const uint8_t *frame, size_t frame_len,
+					 size_t *pack_len, uint8_t *counter)
+{
+	if (frame_len < BEACON_IES_OFFSET + 2 + ODID_VENDOR_MIN_LEN) {
+		return NULL;
+	}
+
+	const uint8_t *ie = frame + BEACON_IES_OFFSET;
+	const uint8_t *end = frame + frame_len;
+
+	// hop from element to element; only vendor specific ones are looked into
+	while (end - ie >= 2) {
+		uint8_t id = ie[0];
+		uint8_t len = ie[1];
+		const uint8_t *body = ie + 2;
+
+		if (len > end - body) {
+			return NULL;  // truncated element, nothing after it can be trusted
+		}
+		if (id == WLAN_EID_VENDOR_SPECIFIC && len >= ODID_VENDOR_MIN_LEN &&
+		    odid_le32(body) == ODID_OUI_TYPE_LE) {
+			*counter = body[4];
+			*pack_len = len - 5;
+			return body + 5;
+		}
+		ie = body + len;
+	}
+
+	return NULL;
+}
+
+/* The service info of an ODID service descriptor attribute: the message
+ * counter, then the pack. Fields announced by the service control are
+ * skipped on the way to it.
+ */
+static const uint8_t *locate_in_service_desc(const uint8_t *attr, size_t len, size_t *pack_len,
+					     uint8_t *counter)
+{
+	if (len < NAN_SERVICE_DESC_MIN_LEN ||
+	    memcmp(attr, odid_service_id, sizeof(odid_service_id)) != 0) {
+		return NULL;
+	}
+
+	uint8_t control = attr[8];
+	size_t off = NAN_SERVICE_DESC_MIN_LEN;
+
+	if (!(control & NAN_SC_SERVICE_INFO)) {
+		return NULL;
+	}
+	if (control & NAN_SC_BINDING_BITMAP) {
+		off += 2;
+	}
+	if ((control & NAN_SC_MATCHING_FILTER) && off < len) {
+		off += 1 + attr[off];
+	}
+	if ((control & NAN_SC_RESPONSE_FILTER) && off < len) {
+		off += 1 + attr[off];
+	}
+	// the service info length, then the service info itself
+	if (off >= len || attr[off] > len - off - 1 || attr[off] < 1 + ODID_PACK_HDR_SIZE) {
+		return NULL;
+	}
+
+	const uint8_t *p = attr + off;
+
+	*counter = p[1];
+	*pack_len = p[0] - 1;
+	return p + 2;
+}
+
+static const uint8_t *locate_in_nan(const uint8_t *frame, size_t frame_len, size_t *pack_len,
+				    uint8_t *counter)
+{
+	const uint8_t *attr = frame + ACTION_BODY_OFFSET + 6;
+	const uint8_t *end = frame + frame_len;
+
+	// hop from attribute to attribute; a frame may publish several services
+	while (end - attr >= NAN_ATTR_HDR_SIZE) {
+		uint8_t id = attr[0];
+		uint16_t len = odid_le16(&attr[1]);
+		const uint8_t *body = attr + NAN_ATTR_HDR_SIZE;
+
+		if (len > end - body) {
+			return NULL;  // truncated attribute
+		}
+		if (id == NAN_ATTR_SERVICE_DESC) {
+			const uint8_t *pack = locate_in_service_desc(body, len, pack_len, counter);
+
+			if (pack != NULL) {
+				return pack;
+			}
+		}
+		attr = body + len;
+	}
+
+	return NULL;
+}
+
+static const uint8_t *locate_in_action(const uint8_t *frame, size_t frame_len, size_t *pack_len,
+				       uint8_t *counter, enum odid_transport *transport)
+{
+	const uint8_t *body = frame + ACTION_BODY_OFFSET;
+	size_t body_len;
+	size_t skip;
+
+	if (frame_len < ACTION_BODY_OFFSET + 2 + ODID_VENDOR_MIN_LEN) {
+		return NULL;
+	}
+	body_len = frame_len - ACTION_BODY_OFFSET;
+
+	if (body[0] == WLAN_ACTION_PUBLIC && body[1] == WLAN_PA_VENDOR_SPECIFIC) {
+		if (odid_le32(&body[2]) == NAN_OUI_TYPE_LE) {
+			*transport = ODID_TRANSPORT_NAN;
+			return locate_in_nan(frame, frame_len, pack_len, counter);
+		}
+		skip = 2;  // category and public action
+	} else if (body[0] == WLAN_ACTION_VENDOR_SPECIFIC) {
+		skip = 1;  // category
+	} else {
+		return NULL;
+	}
+
+	// the rest of the frame after the OUI, type and counter is the pack
+	if (odid_le32(&body[skip]) != ODID_OUI_TYPE_LE) {
+		return NULL;
+	}
+	*transport = ODID_TRANSPORT_ACTION;
+	*counter = body[skip + 4];
+	*pack_len = body_len - skip - 5;
+	return body + skip + 5;
+}
+
+const uint8_t *odid_locate_pack(const uint8_t *frame, size_t frame_len, size_t *pack_len,
+				uint8_t *counter, enum odid_transport *transport)
+{
+	enum odid_transport found = ODID_TRANSPORT_BEACON;
+	const uint8_t *pack;
+	uint8_t count;
+
+	if (frame_len < 1) {
+		return NULL;
+	}
+
+	switch (frame[0] & WLAN_FC_TYPE_MASK) {
+	case WLAN_FC_BEACON:
+	case WLAN_FC_PROBE_RESP:
+		pack = locate_in_elements(frame, frame_len, pack_len, &count);
+		break;
+	case WLAN_FC_ACTION:
+	case WLAN_FC_ACTION_NO_ACK:
+		pack = locate_in_action(frame, frame_len, pack_len, &count, &found);
+		break;
+	default:
+		return NULL;  // no other frame carries Remote ID
+	}
+
+	if (pack != NULL) {
+		if (counter != NULL) {
+			*counter = count;
+		}
+		if (transport != NULL) {
+			*transport = found;
+		}
+	}
+
+	return pack;
+}
+
+const char *odid_transport_txt(enum odid_transport transport)
+{
+	switch (transport) {
+	case ODID_TRANSPORT_BEACON:
+		return "beacon";
+	case ODID_TRANSPORT_NAN:
+		return "NAN";
+	case ODID_TRANSPORT_ACTION:
+		return "action";
+	default:
+		return "unknown";
+	}
+}
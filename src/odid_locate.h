@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Locating the ODID message pack in a raw 802.11 frame
+ *
+ * Remote ID reaches Wi-Fi in three kinds of management frame: the vendor
+ * specific element of a beacon (or probe response), the service info of a
+ * NAN service discovery frame published under the ODID service ID, and a
+ * vendor specific action frame. The frame control field picks the parser,
+ * and all of them hand back a pointer into the frame itself.
+ */
+
+#ifndef ODID_LOCATE_H_
+#define ODID_LOCATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum odid_transport {
+	ODID_TRANSPORT_BEACON,   // vendor specific element (OUI FA 0B BC, type 0D)
+	ODID_TRANSPORT_NAN,      // NAN service discovery frame, ODID service ID
+	ODID_TRANSPORT_ACTION,   // vendor specific action frame, ODID OUI and type
+	ODID_TRANSPORT_COUNT,
+};
+
+/* Find the ODID message pack in frame. Returns a pointer to it and stores
+ * the pack length (bounded by the element, attribute or frame holding it)
+ * in pack_len, and the message counter and the transport it came over in
+ * counter and transport (if not NULL). Returns NULL for any other frame,
+ * including truncated or malformed ones.
+ */
+const uint8_t *odid_locate_pack(const uint8_t *frame, size_t frame_len, size_t *pack_len,
+				uint8_t *counter, enum odid_transport *transport);
+
+const char *odid_transport_txt(enum odid_transport transport);
+
+#endif /* ODID_LOCATE_H_ */
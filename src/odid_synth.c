@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+
+#include "odid_synth.h"
+
+#define ODID_PROTOCOL_VERSION 2
+
+// 802.11 beacon: 24-byte MAC header plus timestamp, beacon interval and capabilities
+#define BEACON_HDR_SIZE 36
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+	p[0] = v & 0xFF;
+	p[1] = v >> 8;
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+	put_le16(p, v & 0xFFFF);
+	put_le16(p + 2, v >> 16);
+}
+
+static void put_altitude(uint8_t *p, int32_t dm)
+{
+	int32_t raw = (dm + 10000) / 5;
+
+	put_le16(p, raw < 0 ? 0 : raw > 0xFFFF ? 0xFFFF : raw);
+}
+
+static void start_message(uint8_t msg[ODID_MSG_SIZE], enum odid_msg_type type)
+{
+	memset(msg, 0, ODID_MSG_SIZE);
+	msg[0] = (type << 4) | ODID_PROTOCOL_VERSION;
+}
+
+void odid_encode_basic_id(uint8_t msg[ODID_MSG_SIZE], const struct odid_basic_id *m)
+{
+	start_message(msg, ODID_MSG_BASIC_ID);
+	msg[1] = (m->id_type << 4) | (m->ua_type & 0x0F);
+	memcpy(&msg[2], m->uas_id, ODID_ID_SIZE);
+}
+
+void odid_encode_location(uint8_t msg[ODID_MSG_SIZE], const struct odid_location *m)
+{
+	uint16_t direction = m->direction % 360;
+	uint8_t flags = (m->status << 4) | ((m->height_type & 0x01) << 2);
+	int32_t vspeed = m->vertical_speed / 50;
+
+	start_message(msg, ODID_MSG_LOCATION);
+
+	if (direction >= 180) {
+		flags |= 0x02;
+		direction -= 180;
+	}
+	msg[2] = direction;
+
+	if (m->speed <= 255 * 25) {
+		msg[3] = m->speed / 25;
+	} else {
+		flags |= 0x01;
+		msg[3] = (m->speed - 6375) / 75 > 254 ? 254 : (m->speed - 6375) / 75;
+	}
+	msg[1] = flags;
+	msg[4] = (uint8_t)(int8_t)(vspeed < -127 ? -127 : vspeed > 127 ? 127 : vspeed);
+
+	put_le32(&msg[5], (uint32_t)m->latitude);
+	put_le32(&msg[9], (uint32_t)m->longitude);
+	put_altitude(&msg[13], m->pressure_altitude);
+	put_altitude(&msg[15], m->geodetic_altitude);
+	put_altitude(&msg[17], m->height);
+	msg[19] = (m->vertical_accuracy << 4) | (m->horizontal_accuracy & 0x0F);
+	msg[20] = (m->baro_accuracy << 4) | (m->speed_accuracy & 0x0F);
+	put_le16(&msg[21], m->timestamp);
+	msg[23] = m->timestamp_accuracy & 0x0F;
+}
+
+void odid_encode_auth(uint8_t msg[ODID_MSG_SIZE], const struct odid_auth *m)
+{
+	start_message(msg, ODID_MSG_AUTH);
+	msg[1] = (m->auth_type << 4) | (m->page & 0x0F);
+	if (m->page == 0) {
+		msg[2] = m->last_page;
+		msg[3] = m->length;
+		put_le32(&msg[4], m->timestamp);
+		memcpy(&msg[8], m->data, ODID_AUTH_PAGE0_DATA);
+	} else {
+		memcpy(&msg[2], m->data, ODID_AUTH_PAGE_DATA);
+	}
+}
+
+void odid_encode_self_id(uint8_t msg[ODID_MSG_SIZE], const struct odid_self_id *m)
+{
+	start_message(msg, ODID_MSG_SELF_ID);
+	msg[1] = m->description_type;
+	memcpy(&msg[2], m->description, ODID_STR_SIZE);
+}
+
+void odid_encode_system(uint8_t msg[ODID_MSG_SIZE], const struct odid_system *m)
+{
+	start_message(msg, ODID_MSG_SYSTEM);
+	msg[1] = ((m->classification_type & 0x07) << 2) | (m->operator_location_type & 0x03);
+	put_le32(&msg[2], (uint32_t)m->operator_latitude);
+	put_le32(&msg[6], (uint32_t)m->operator_longitude);
+	put_le16(&msg[10], m->area_count);
+	msg[12] = m->area_radius / 10;
+	put_altitude(&msg[13], m->area_ceiling);
+	put_altitude(&msg[15], m->area_floor);
+	msg[17] = (m->ua_category << 4) | (m->ua_class & 0x0F);
+	put_altitude(&msg[18], m->operator_altitude);
+	put_le32(&msg[20], m->timestamp);
+}
+
+void odid_encode_operator_id(uint8_t msg[ODID_MSG_SIZE], const struct odid_operator_id *m)
+{
+	start_message(msg, ODID_MSG_OPERATOR_ID);
+	msg[1] = m->id_type;
+	memcpy(&msg[2], m->operator_id, ODID_ID_SIZE);
+}
+
+static size_t put_beacon_header(uint8_t *buf, const uint8_t mac[6])
+{
+	static const uint8_t broadcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+	memset(buf, 0, BEACON_HDR_SIZE);
+	buf[0] = 0x80;                  // management frame, beacon subtype
+	memcpy(&buf[4], broadcast, 6);  // destination
+	memcpy(&buf[10], mac, 6);       // source
+	memcpy(&buf[16], mac, 6);       // BSSID
+	put_le16(&buf[32], 100);        // beacon interval, TUs
+	put_le16(&buf[34], 0x0421);     // capabilities: ESS, short preamble, short slot
+
+	return BEACON_HDR_SIZE;
+}
+
+static size_t put_ie(uint8_t *buf, uint8_t id, const void *data, uint8_t len)
+{
+	buf[0] = id;
+	buf[1] = len;
+	memcpy(&buf[2], data, len);
+
+	return 2 + len;
+}
+
+size_t odid_synth_beacon(uint8_t *buf, size_t size, const uint8_t mac[6], uint8_t counter,
+			 const uint8_t *msgs, size_t count)
+{
+	static const uint8_t odid_oui_type[4] = {0xFA, 0x0B, 0xBC, 0x0D};
+	static const uint8_t rates[] = {0x82, 0x84, 0x8B, 0x96};
+	size_t vendor_len = sizeof(odid_oui_type) + 1 + ODID_PACK_HDR_SIZE + count * ODID_MSG_SIZE;
+	size_t len;
+
+	if (count > ODID_PACK_MAX_MSGS || size < BEACON_HDR_SIZE + 2 + sizeof(rates) + 2 + vendor_len) {
+		return 0;
+	}
+
+	len = put_beacon_header(buf, mac);
+	len += put_ie(&buf[len], 0, "", 0);  // hidden SSID
+	len += put_ie(&buf[len], 1, rates, sizeof(rates));
+
+	buf[len++] = 221;
+	buf[len++] = vendor_len;
+	memcpy(&buf[len], odid_oui_type, sizeof(odid_oui_type));
+	len += sizeof(odid_oui_type);
+	buf[len++] = counter;
+	buf[len++] = (ODID_MSG_PACK << 4) | ODID_PROTOCOL_VERSION;
+	buf[len++] = ODID_MSG_SIZE;
+	buf[len++] = count;
+	memcpy(&buf[len], msgs, count * ODID_MSG_SIZE);
+	len += count * ODID_MSG_SIZE;
+
+	return len;
+}
+
+size_t odid_synth_ap_beacon(uint8_t *buf, size_t size, const uint8_t mac[6], const char *ssid,
+			    uint8_t channel)
+{
+	static const uint8_t rates[] = {0x82, 0x84, 0x8B, 0x96, 0x0C, 0x12, 0x18, 0x24};
+	static const uint8_t tim[] = {0x00, 0x01, 0x00, 0x00};
+	static const uint8_t rsn[] = {0x01, 0x00, 0x00, 0x0F, 0xAC, 0x04, 0x01, 0x00, 0x00, 0x0F,
+				      0xAC, 0x04, 0x01, 0x00, 0x00, 0x0F, 0xAC, 0x02, 0x0C, 0x00};
+	// WMM parameter element (Microsoft OUI), present in nearly every AP beacon
+	static const uint8_t wmm[] = {0x00, 0x50, 0xF2, 0x02, 0x01, 0x01, 0x80, 0x00, 0x03, 0xA4,
+				      0x00, 0x00, 0x27, 0xA4, 0x00, 0x00, 0x42, 0x43, 0x5E, 0x00,
+				      0x62, 0x32, 0x2F, 0x00};
+	size_t ssid_len = strnlen(ssid, 32);
+	size_t len;
+
+	if (size < BEACON_HDR_SIZE + 2 + ssid_len + 2 + sizeof(rates) + 3 + 2 + sizeof(tim) +
+		   2 + sizeof(rsn) + 2 + sizeof(wmm)) {
+		return 0;
+	}
+
+	len = put_beacon_header(buf, mac);
+	len += put_ie(&buf[len], 0, ssid, ssid_len);
+	len += put_ie(&buf[len], 1, rates, sizeof(rates));
+	len += put_ie(&buf[len], 3, &channel, 1);
+	len += put_ie(&buf[len], 5, tim, sizeof(tim));
+	len += put_ie(&buf[len], 48, rsn, sizeof(rsn));
+	len += put_ie(&buf[len], 221, wmm, sizeof(wmm));
+
+	return len;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Synthesis of ODID messages and beacon frames
+ *
+ * The inverse of odid_decoder.h: encodes decoded message structs back into
+ * 25-byte messages and wraps message packs in 802.11 beacons, for benchmarks
+ * and load generation without a radio.
+ */
+
+#ifndef ODID_SYNTH_H_
+#define ODID_SYNTH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "odid_decoder.h"
+
+void odid_encode_basic_id(uint8_t msg[ODID_MSG_SIZE], const struct odid_basic_id *m);
+void odid_encode_location(uint8_t msg[ODID_MSG_SIZE], const struct odid_location *m);
+void odid_encode_auth(uint8_t msg[ODID_MSG_SIZE], const struct odid_auth *m);
+void odid_encode_self_id(uint8_t msg[ODID_MSG_SIZE], const struct odid_self_id *m);
+void odid_encode_system(uint8_t msg[ODID_MSG_SIZE], const struct odid_system *m);
+void odid_encode_operator_id(uint8_t msg[ODID_MSG_SIZE], const struct odid_operator_id *m);
+
+/* Build a beacon from mac carrying count messages (ODID_MSG_SIZE bytes each,
+ * back to back in msgs) in the ODID vendor specific element. Returns the
+ * frame length, or 0 if it does not fit in size.
+ */
+size_t odid_synth_beacon(uint8_t *buf, size_t size, const uint8_t mac[6], uint8_t counter,
+			 const uint8_t *msgs, size_t count);
+
+/* Build an ordinary access point beacon (SSID, rates, DS, TIM, RSN and a
+ * non-ODID vendor element), the kind of frame that makes up most of a scan.
+ */
+size_t odid_synth_ap_beacon(uint8_t *buf, size_t size, const uint8_t mac[6], const char *ssid,
+			    uint8_t channel);
+
+#endif /* ODID_SYNTH_H_ */
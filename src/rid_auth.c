@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "rid_auth.h"
+#include "rid_stats.h"
+
+LOG_MODULE_REGISTER(rid_auth, CONFIG_LOG_DEFAULT_LEVEL);
+
+BUILD_ASSERT(CONFIG_RID_AUTH_SLOTS <= CONFIG_RID_AUTH_AIRCRAFT,
+	     "CONFIG_RID_AUTH_AIRCRAFT must be at least CONFIG_RID_AUTH_SLOTS");
+
+enum entry_state {
+	ENTRY_FREE,
+	ENTRY_COLLECTING,
+	ENTRY_DONE,
+};
+
+struct reassembly {
+	void *fifo_reserved;       // first word, for the verifier queue
+	struct rid_auth_blob blob;
+	uint16_t pages;            // bit per page received
+	uint8_t last_page;         // from page 0
+	bool have_page0;
+};
+
+struct auth_entry {
+	uint8_t mac[6];
+	uint8_t state;             // enum entry_state
+	uint32_t since;            // ms since boot: first page while collecting, completion once done
+	uint32_t timestamp;        // of the completed blob
+	struct reassembly *r;      // while collecting
+};
+
+K_MEM_SLAB_DEFINE_STATIC(auth_slab, sizeof(struct reassembly), CONFIG_RID_AUTH_SLOTS,
+			 __alignof__(struct reassembly));
+static K_FIFO_DEFINE(verify_fifo);
+static K_THREAD_STACK_DEFINE(auth_workq_stack, CONFIG_RID_AUTH_WORKQ_STACK_SIZE);
+static struct k_work_q auth_workq;
+static struct k_work verify_work;
+
+// only ever touched by the decoder thread
+static struct auth_entry entries[CONFIG_RID_AUTH_AIRCRAFT];
+static uint32_t busy_entries;
+
+// shared with the work queue
+static rid_auth_verifier_t verifier;
+static struct rid_auth_stats stats;
+static uint64_t latency_sum_ms;
+static K_MUTEX_DEFINE(auth_lock);
+
+/* Whether length bytes of data take pages 0 to last_page, no more and no fewer. */
+static bool length_fits(uint8_t last_page, uint8_t length)
+{
+	int capacity = ODID_AUTH_PAGE0_DATA + last_page * ODID_AUTH_PAGE_DATA;
+
+	return last_page < RID_AUTH_MAX_PAGES && length > 0 && length <= capacity &&
+	       length + ODID_AUTH_PAGE_DATA > capacity;
+}
+
+static struct auth_entry *find(const uint8_t mac[6])
+{
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		if (entries[i].state != ENTRY_FREE && memcmp(entries[i].mac, mac, 6) == 0) {
+			return &entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* A free entry, else the one whose blob was completed longest ago. Reassemblies
+ * in progress are never taken over; they only time out.
+ */
+static struct auth_entry *claim(void)
+{
+	struct auth_entry *oldest = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		struct auth_entry *e = &entries[i];
+
+		if (e->state == ENTRY_FREE) {
+			return e;
+		}
+		if (e->state == ENTRY_DONE && (oldest == NULL || (int32_t)(e->since - oldest->since) < 0)) {
+			oldest = e;
+		}
+	}
+	if (oldest != NULL) {
+		oldest->state = ENTRY_FREE;
+		busy_entries--;
+	}
+
+	return oldest;
+}
+
+static void release(struct auth_entry *e)
+{
+	if (e->state == ENTRY_COLLECTING) {
+		k_mem_slab_free(&auth_slab, e->r);
+		e->r = NULL;
+		stats.slabs_used = k_mem_slab_num_used_get(&auth_slab);
+	}
+	e->state = ENTRY_FREE;
+	busy_entries--;
+}
+
+static bool begin(struct auth_entry *e, const uint8_t mac[6], uint8_t auth_type, uint32_t now)
+{
+	struct reassembly *r;
+
+	if (k_mem_slab_alloc(&auth_slab, (void **)&r, K_NO_WAIT) != 0) {
+		return false;  // every slab is collecting or waiting for the verifier
+	}
+
+	r->pages = 0;
+	r->last_page = 0;
+	r->have_page0 = false;
+	memcpy(r->blob.mac, mac, sizeof(r->blob.mac));
+	r->blob.auth_type = auth_type;
+
+	memcpy(e->mac, mac, sizeof(e->mac));
+	e->state = ENTRY_COLLECTING;
+	e->since = now;
+	e->r = r;
+	busy_entries++;
+
+	stats.started++;
+	stats.slabs_used = k_mem_slab_num_used_get(&auth_slab);
+	stats.slabs_high_water = MAX(stats.slabs_high_water, stats.slabs_used);
+
+	return true;
+}
+
+/* Whether page belongs to other data than the reassembly so far. */
+static bool conflicts(const struct reassembly *r, const struct odid_auth *page)
+{
+	if (page->auth_type != r->blob.auth_type) {
+		return true;
+	}
+
+	return page->page == 0 && r->have_page0 &&
+	       (page->timestamp != r->blob.timestamp || page->length != r->blob.length ||
+		page->last_page != r->last_page);
+}
+
+static void complete(struct auth_entry *e, uint32_t now)
+{
+	struct reassembly *r = e->r;
+	uint32_t latency = now - e->since;
+
+	rid_stats_record(RID_STAGE_AUTH, latency);
+	stats.completed++;
+	latency_sum_ms += latency;
+	stats.latency_avg_ms = latency_sum_ms / stats.completed;
+	stats.latency_max_ms = MAX(stats.latency_max_ms, latency);
+
+	r->blob.completed = now;
+	e->state = ENTRY_DONE;
+	e->since = now;
+	e->timestamp = r->blob.timestamp;
+	e->r = NULL;
+
+	// the slab goes with the blob and comes back to the pool once it is verified
+	k_fifo_put(&verify_fifo, r);
+	k_work_submit_to_queue(&auth_workq, &verify_work);
+}
+
+static void collect(struct auth_entry *e, const struct odid_auth *page, uint32_t now)
+{
+	struct reassembly *r = e->r;
+
+	if (page->page == 0) {
+		r->have_page0 = true;
+		r->last_page = page->last_page;
+		r->blob.length = page->length;
+		r->blob.timestamp = page->timestamp;
+		memcpy(r->blob.data, page->data, ODID_AUTH_PAGE0_DATA);
+	} else {
+		memcpy(&r->blob.data[ODID_AUTH_PAGE0_DATA + (page->page - 1) * ODID_AUTH_PAGE_DATA],
+		       page->data, ODID_AUTH_PAGE_DATA);
+	}
+	r->pages |= BIT(page->page);
+
+	uint16_t all = BIT_MASK(r->last_page + 1);
+
+	if (r->have_page0 && (r->pages & all) == all) {
+		complete(e, now);
+	}
+}
+
+void rid_auth_page(const uint8_t mac[6], const struct odid_auth *page, uint32_t now)
+{
+	k_mutex_lock(&auth_lock, K_FOREVER);
+
+	stats.pages++;
+	if (page->page >= RID_AUTH_MAX_PAGES ||
+	    (page->page == 0 && !length_fits(page->last_page, page->length))) {
+		stats.invalid++;
+		goto out;
+	}
+
+	struct auth_entry *e = find(mac);
+
+	if (e != NULL && e->state == ENTRY_DONE) {
+		// the same data again, until it is due to be checked again or page 0 says it changed
+		if (now - e->since < CONFIG_RID_AUTH_TIMEOUT_MS &&
+		    (page->page != 0 || page->timestamp == e->timestamp)) {
+			stats.repeats++;
+			goto out;
+		}
+		release(e);
+	} else if (e != NULL && now - e->since >= CONFIG_RID_AUTH_TIMEOUT_MS) {
+		stats.timed_out++;
+		release(e);
+	} else if (e != NULL && conflicts(e->r, page)) {
+		stats.superseded++;
+		release(e);
+	} else if (e != NULL && e->r->have_page0 && page->page > e->r->last_page) {
+		stats.invalid++;
+		goto out;
+	}
+
+	if (e == NULL || e->state == ENTRY_FREE) {
+		e = e != NULL ? e : claim();
+		if (e == NULL || !begin(e, mac, page->auth_type, now)) {
+			stats.no_room++;
+			goto out;
+		}
+	}
+	collect(e, page, now);
+
+out:
+	k_mutex_unlock(&auth_lock);
+}
+
+void rid_auth_expire(uint32_t now)
+{
+	if (busy_entries == 0) {
+		return;
+	}
+
+	k_mutex_lock(&auth_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		struct auth_entry *e = &entries[i];
+
+		if (e->state == ENTRY_FREE || now - e->since < CONFIG_RID_AUTH_TIMEOUT_MS) {
+			continue;
+		}
+		if (e->state == ENTRY_COLLECTING) {
+			stats.timed_out++;
+		}
+		release(e);
+	}
+
+	k_mutex_unlock(&auth_lock);
+}
+
+static void verify_handler(struct k_work *work)
+{
+	struct reassembly *r;
+
+	while ((r = k_fifo_get(&verify_fifo, K_NO_WAIT)) != NULL) {
+		const struct rid_auth_blob *blob = &r->blob;
+
+		k_mutex_lock(&auth_lock, K_FOREVER);
+		rid_auth_verifier_t verify = verifier;
+		k_mutex_unlock(&auth_lock);
+
+		uint32_t start = rid_stats_start();
+		int err = verify != NULL ? verify(blob) : -ENOTSUP;
+
+		rid_stats_stop(RID_STAGE_VERIFY, start);
+
+		if (err == -EBADMSG) {
+			LOG_WRN("%02x:%02x:%02x:%02x:%02x:%02x | authentication type %u, %u bytes, failed",
+				blob->mac[0], blob->mac[1], blob->mac[2], blob->mac[3], blob->mac[4],
+				blob->mac[5], blob->auth_type, blob->length);
+		}
+
+		k_mutex_lock(&auth_lock, K_FOREVER);
+		if (err == 0) {
+			stats.verified++;
+		} else if (err == -EBADMSG) {
+			stats.rejected++;
+		} else {
+			stats.unchecked++;
+		}
+		k_mem_slab_free(&auth_slab, r);
+		stats.slabs_used = k_mem_slab_num_used_get(&auth_slab);
+		k_mutex_unlock(&auth_lock);
+	}
+}
+
+void rid_auth_init(void)
+{
+	k_work_init(&verify_work, verify_handler);
+	k_work_queue_start(&auth_workq, auth_workq_stack, K_THREAD_STACK_SIZEOF(auth_workq_stack),
+			   CONFIG_RID_AUTH_WORKQ_PRIORITY, NULL);
+	k_thread_name_set(&auth_workq.thread, "rid_auth");
+}
+
+void rid_auth_set_verifier(rid_auth_verifier_t fn)
+{
+	k_mutex_lock(&auth_lock, K_FOREVER);
+
+	verifier = fn;
+
+	k_mutex_unlock(&auth_lock);
+}
+
+void rid_auth_get_stats(struct rid_auth_stats *out)
+{
+	k_mutex_lock(&auth_lock, K_FOREVER);
+
+	*out = stats;
+
+	k_mutex_unlock(&auth_lock);
+}
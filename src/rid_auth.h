@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Authentication message reassembly and verification
+ *
+ * Aircraft spread their authentication data (a signature, typically) over up
+ * to 16 Authentication message pages, sent across several beacons. The pages
+ * of every aircraft are collected in a slab taken from a fixed pool of
+ * CONFIG_RID_AUTH_SLOTS; a reassembly that is not complete within
+ * CONFIG_RID_AUTH_TIMEOUT_MS of its first page is discarded, and a page that
+ * finds no free slab is dropped rather than waited for. Page 0 gives the
+ * length of the data, which has to need exactly the pages it announces.
+ *
+ * A complete blob is queued to a work queue of its own, where the verifier
+ * set with rid_auth_set_verifier() checks it and the slab is returned to the
+ * pool, so signature checks never hold up the decoder thread. Once an
+ * aircraft's blob is complete, its pages are ignored as repeats for
+ * CONFIG_RID_AUTH_TIMEOUT_MS unless page 0 brings a new timestamp.
+ */
+
+#ifndef RID_AUTH_H_
+#define RID_AUTH_H_
+
+#include <stdint.h>
+
+#include "odid_decoder.h"
+
+#define RID_AUTH_MAX_LENGTH  255  // the length on page 0 is a byte
+#define RID_AUTH_MAX_PAGES   12   // pages data of that length takes
+
+struct rid_auth_blob {
+	uint8_t mac[6];
+	uint8_t auth_type;       // enum AUTH_TYPE
+	uint8_t length;          // bytes of data
+	uint32_t timestamp;      // seconds since 2019-01-01 00:00:00 UTC
+	uint32_t completed;      // ms since boot
+	uint8_t data[ODID_AUTH_PAGE0_DATA + (RID_AUTH_MAX_PAGES - 1) * ODID_AUTH_PAGE_DATA];
+};
+
+/* Check blob on the authentication work queue. Returns 0 if it is authentic,
+ * -EBADMSG if it is not, or another negative errno if it cannot tell (an
+ * authentication type or key it does not know).
+ */
+typedef int (*rid_auth_verifier_t)(const struct rid_auth_blob *blob);
+
+struct rid_auth_stats {
+	uint32_t pages;           // Authentication pages received
+	uint32_t repeats;         // pages of a blob completed moments ago
+	uint32_t invalid;         // pages that fail the length checks
+	uint32_t no_room;         // pages dropped for want of a slab
+	uint32_t started;         // reassemblies
+	uint32_t completed;       // blobs handed to the verifier
+	uint32_t timed_out;
+	uint32_t superseded;      // abandoned for data of another type or timestamp
+	uint32_t verified;
+	uint32_t rejected;
+	uint32_t unchecked;       // no verifier, or one that could not tell
+	uint32_t slabs_used;
+	uint32_t slabs_high_water;
+	uint32_t latency_avg_ms;  // first page to the blob complete
+	uint32_t latency_max_ms;
+};
+
+#if defined(CONFIG_RID_AUTH)
+
+/* Start the verifier work queue. */
+void rid_auth_init(void);
+
+/* Replace the verifier; NULL leaves blobs unchecked. */
+void rid_auth_set_verifier(rid_auth_verifier_t verifier);
+
+/* An Authentication page from mac, received at now (ms since boot). Decoder thread only. */
+void rid_auth_page(const uint8_t mac[6], const struct odid_auth *page, uint32_t now);
+
+/* Discard reassemblies that ran out of time. Decoder thread only. */
+void rid_auth_expire(uint32_t now);
+
+void rid_auth_get_stats(struct rid_auth_stats *stats);
+
+#else
+
+static inline void rid_auth_init(void) {}
+static inline void rid_auth_page(const uint8_t mac[6], const struct odid_auth *page, uint32_t now) {}
+static inline void rid_auth_expire(uint32_t now) {}
+
+#endif /* CONFIG_RID_AUTH */
+
+#endif /* RID_AUTH_H_ */
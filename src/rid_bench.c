@@ -0,0 +1,532 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
+
+#include "odid_decoder.h"
+#include "odid_format.h"
+#include "odid_locate.h"
+#include "odid_synth.h"
+#include "rid_bench.h"
+#include "rid_cycles.h"
+#include "rid_dedup.h"
+#include "rid_filter.h"
+#include "rid_output.h"
+#include "rid_ring.h"
+
+#if defined(RID_BENCH_HAVE_CORPUS)
+// record stream captured from the output sink, embedded at build time from CONFIG_RID_BENCH_CORPUS_FILE
+static const uint8_t captured_corpus[] = {
+#include "rid_bench_corpus.inc"
+};
+#endif
+
+#define BENCH_DRONES 8
+
+static const char *const msg_type_names[ODID_MSG_TYPE_COUNT] = {
+	[ODID_MSG_BASIC_ID] = "basic_id",
+	[ODID_MSG_LOCATION] = "location",
+	[ODID_MSG_AUTH] = "auth",
+	[ODID_MSG_SELF_ID] = "self_id",
+	[ODID_MSG_SYSTEM] = "system",
+	[ODID_MSG_OPERATOR_ID] = "operator_id",
+};
+
+struct bench_corpus {
+	const char *name;
+	uint32_t count;
+	struct wifi_raw_scan_result frames[CONFIG_RID_BENCH_MAX_FRAMES];
+};
+
+static struct bench_corpus corpus;
+static uint8_t type_msgs[ODID_MSG_TYPE_COUNT][ODID_MSG_SIZE];
+
+static uint32_t rand_state = 0x2545F491;
+
+static uint32_t bench_rand(void)
+{
+	// xorshift32, deterministic so runs are comparable
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+	return rand_state;
+}
+
+static void build_type_msgs(uint32_t drone)
+{
+	static const uint8_t uas_id[ODID_ID_SIZE] = "1581F5FKD229400AB123";
+	static const uint8_t description[ODID_STR_SIZE] = "SURVEY FLIGHT";
+	static const uint8_t operator_id[ODID_ID_SIZE] = "FIN87ASTRDGE12K8";
+	static const uint8_t signature[ODID_AUTH_PAGE0_DATA] = {
+		0x30, 0x45, 0x02, 0x21, 0x00, 0xB5, 0x3C, 0x7E, 0x19,
+		0x6A, 0xD2, 0x48, 0x91, 0x0F, 0xE3, 0x57, 0x2C,
+	};
+
+	struct odid_basic_id basic_id = {.id_type = 1, .ua_type = 2, .uas_id = uas_id};
+	struct odid_location location = {
+		.status = 2,
+		.direction = bench_rand() % 360,
+		.speed = bench_rand() % 2000,
+		.vertical_speed = (int16_t)(bench_rand() % 600) - 300,
+		.latitude = 423600000 + (int32_t)(bench_rand() % 100000) + (int32_t)drone,
+		.longitude = -710940000 - (int32_t)(bench_rand() % 100000),
+		.pressure_altitude = 1000 + bench_rand() % 1000,
+		.geodetic_altitude = 1100 + bench_rand() % 1000,
+		.height = bench_rand() % 1200,
+		.horizontal_accuracy = 10,
+		.vertical_accuracy = 4,
+		.baro_accuracy = 4,
+		.speed_accuracy = 3,
+		.timestamp = bench_rand() % 36000,
+		.timestamp_accuracy = 2,
+	};
+	struct odid_self_id self_id = {.description_type = 0, .description = description};
+	struct odid_system system = {
+		.operator_location_type = 1,
+		.classification_type = 1,
+		.operator_latitude = 423600000,
+		.operator_longitude = -710940000,
+		.area_count = 1,
+		.ua_category = 1,
+		.ua_class = 2,
+		.operator_altitude = 200,
+		.timestamp = 150000000 + drone,
+	};
+	struct odid_operator_id op_id = {.id_type = 0, .operator_id = operator_id};
+	struct odid_auth auth = {
+		.auth_type = 1,
+		.page = 0,
+		.last_page = 2,
+		.length = 63,
+		.timestamp = 150000000 + drone,
+		.data = signature,
+	};
+
+	odid_encode_basic_id(type_msgs[ODID_MSG_BASIC_ID], &basic_id);
+	odid_encode_location(type_msgs[ODID_MSG_LOCATION], &location);
+	odid_encode_auth(type_msgs[ODID_MSG_AUTH], &auth);
+	odid_encode_self_id(type_msgs[ODID_MSG_SELF_ID], &self_id);
+	odid_encode_system(type_msgs[ODID_MSG_SYSTEM], &system);
+	odid_encode_operator_id(type_msgs[ODID_MSG_OPERATOR_ID], &op_id);
+}
+
+static void add_frame(const uint8_t *data, size_t len, int8_t rssi, uint16_t frequency)
+{
+	struct wifi_raw_scan_result *raw;
+
+	if (corpus.count >= CONFIG_RID_BENCH_MAX_FRAMES || len == 0) {
+		return;
+	}
+
+	raw = &corpus.frames[corpus.count++];
+	memset(raw, 0, sizeof(*raw));
+	raw->rssi = rssi;
+	raw->frequency = frequency;
+	raw->frame_length = MIN(len, sizeof(raw->data));
+	memcpy(raw->data, data, raw->frame_length);
+}
+
+/* Ordinary AP beacons with one RID beacon every CONFIG_RID_BENCH_AP_RATIO frames, like a scan in a busy area. */
+static void build_synthetic_corpus(void)
+{
+	uint8_t buf[CONFIG_WIFI_MGMT_RAW_SCAN_RESULT_LENGTH];
+	uint8_t pack[5 * ODID_MSG_SIZE];
+	uint8_t mac[6] = {0x60, 0x60, 0x1F, 0x00, 0x00, 0x00};
+	static const uint8_t pack_types[] = {ODID_MSG_BASIC_ID, ODID_MSG_LOCATION, ODID_MSG_SELF_ID,
+					     ODID_MSG_SYSTEM, ODID_MSG_OPERATOR_ID};
+	size_t len;
+
+	corpus.name = "synthetic";
+	corpus.count = 0;
+
+	for (uint32_t i = 0; i < CONFIG_RID_BENCH_MAX_FRAMES; i++) {
+		mac[5] = i % BENCH_DRONES;
+		if (i % CONFIG_RID_BENCH_AP_RATIO == 0) {
+			build_type_msgs(mac[5]);
+			for (size_t t = 0; t < ARRAY_SIZE(pack_types); t++) {
+				memcpy(&pack[t * ODID_MSG_SIZE], type_msgs[pack_types[t]], ODID_MSG_SIZE);
+			}
+			len = odid_synth_beacon(buf, sizeof(buf), mac, i, pack, ARRAY_SIZE(pack_types));
+		} else {
+			mac[3] = i;
+			len = odid_synth_ap_beacon(buf, sizeof(buf), mac, "HomeNetwork-5G", 6);
+		}
+		add_frame(buf, len, -40 - (int8_t)(bench_rand() % 50), 2437);
+	}
+}
+
+#if defined(RID_BENCH_HAVE_CORPUS)
+static void build_captured_corpus(void)
+{
+	size_t off = 0;
+
+	corpus.name = "captured";
+	corpus.count = 0;
+
+	while (off + sizeof(struct rid_record_hdr) <= sizeof(captured_corpus)) {
+		const struct rid_record_hdr *hdr = (const void *)&captured_corpus[off];
+		uint16_t len = sys_le16_to_cpu(hdr->len);
+
+		if (hdr->sync != RID_RECORD_SYNC || off + sizeof(*hdr) + len > sizeof(captured_corpus)) {
+			off++;  // resynchronise on the next sync byte
+			continue;
+		}
+		add_frame(&captured_corpus[off + sizeof(*hdr)], len, hdr->rssi,
+			  sys_le16_to_cpu(hdr->frequency));
+		off += sizeof(*hdr) + len;
+	}
+}
+#endif
+
+static void report_rate(const char *stage, uint32_t frames, uint64_t elapsed_us)
+{
+	uint64_t ns_per_frame = elapsed_us * NSEC_PER_USEC / MAX(frames, 1);
+	uint64_t fps = elapsed_us ? (uint64_t)frames * USEC_PER_SEC / elapsed_us : 0;
+
+	printk("bench %s %s: %u ns/frame, %u frames/s\n", corpus.name, stage,
+	       (uint32_t)ns_per_frame, (uint32_t)fps);
+}
+
+static void bench_locate(void)
+{
+	volatile int found = 0;
+	uint64_t start = rid_wall_time_us();
+
+	for (uint32_t r = 0; r < CONFIG_RID_BENCH_ROUNDS; r++) {
+		for (uint32_t i = 0; i < corpus.count; i++) {
+			const struct wifi_raw_scan_result *raw = &corpus.frames[i];
+
+			size_t pack_len;
+
+			found += odid_locate_pack(raw->data, raw->frame_length, &pack_len, NULL,
+						  NULL) != NULL;
+		}
+	}
+
+	report_rate("locate", CONFIG_RID_BENCH_ROUNDS * corpus.count, rid_wall_time_us() - start);
+}
+
+static int decode_frame(const struct wifi_raw_scan_result *raw, struct odid_message *msgs)
+{
+	size_t pack_len;
+	const uint8_t *pack = odid_locate_pack(raw->data, raw->frame_length, &pack_len, NULL, NULL);
+
+	if (pack == NULL) {
+		return 0;
+	}
+
+	return MAX(odid_decode_pack(pack, pack_len, msgs, ODID_PACK_MAX_MSGS), 0);
+}
+
+static void bench_pack(void)
+{
+	struct odid_message msgs[ODID_PACK_MAX_MSGS];
+	volatile int decoded = 0;
+	uint64_t start = rid_wall_time_us();
+
+	for (uint32_t r = 0; r < CONFIG_RID_BENCH_ROUNDS; r++) {
+		for (uint32_t i = 0; i < corpus.count; i++) {
+			decoded += decode_frame(&corpus.frames[i], msgs);
+		}
+	}
+
+	report_rate("pack", CONFIG_RID_BENCH_ROUNDS * corpus.count, rid_wall_time_us() - start);
+}
+
+#if defined(CONFIG_RID_DEDUP)
+/* Locating and looking up every frame again, as the repeats of a busy scan would be. */
+static void bench_dedup(void)
+{
+	struct rid_dedup_stats stats;
+	uint64_t start;
+
+	rid_dedup_reset();
+	start = rid_wall_time_us();
+
+	for (uint32_t r = 0; r < CONFIG_RID_BENCH_ROUNDS; r++) {
+		for (uint32_t i = 0; i < corpus.count; i++) {
+			const struct wifi_raw_scan_result *raw = &corpus.frames[i];
+			size_t pack_len;
+			uint8_t counter;
+			const uint8_t *pack = odid_locate_pack(raw->data, raw->frame_length, &pack_len,
+							       &counter, NULL);
+
+			if (pack != NULL) {
+				rid_dedup_repeat(raw, counter, pack, pack_len, 0);
+			}
+		}
+	}
+
+	report_rate("dedup", CONFIG_RID_BENCH_ROUNDS * corpus.count, rid_wall_time_us() - start);
+	rid_dedup_get_stats(&stats);
+	printk("bench %s dedup: %u repeats, %u new, %u evicted\n", corpus.name,
+	       stats.hits, stats.misses, stats.evictions);
+	rid_dedup_reset();
+}
+#endif
+
+#if defined(CONFIG_RID_FILTER)
+/* A site's worth of rules, run over the Remote ID frames of the corpus, located beforehand. */
+static void bench_filter(void)
+{
+	// two of the drones by address, the rest walk their packs for a UAS ID and are dropped
+	static const char rules[] = "drop rssi<-80; accept mac=60:60:1f:00:00:00/47 band=2; "
+				    "accept uas=1581F6*; drop";
+	static const uint8_t *packs[CONFIG_RID_BENCH_MAX_FRAMES];
+	static size_t pack_lens[CONFIG_RID_BENCH_MAX_FRAMES];
+	static const struct wifi_raw_scan_result *raws[CONFIG_RID_BENCH_MAX_FRAMES];
+	struct rid_filter_stats stats;
+	uint32_t count = 0;
+	volatile int passed = 0;
+	uint64_t start;
+
+	for (uint32_t i = 0; i < corpus.count; i++) {
+		const struct wifi_raw_scan_result *raw = &corpus.frames[i];
+
+		packs[count] = odid_locate_pack(raw->data, raw->frame_length, &pack_lens[count],
+						NULL, NULL);
+		if (packs[count] != NULL) {
+			raws[count++] = raw;
+		}
+	}
+
+	rid_filter_clear();
+	rid_filter_load(rules, sizeof(rules) - 1);
+	start = rid_wall_time_us();
+
+	for (uint32_t r = 0; r < CONFIG_RID_BENCH_ROUNDS; r++) {
+		for (uint32_t i = 0; i < count; i++) {
+			passed += rid_filter_frame(raws[i], packs[i], pack_lens[i]);
+		}
+	}
+
+	report_rate("filter", CONFIG_RID_BENCH_ROUNDS * count, rid_wall_time_us() - start);
+	rid_filter_get_stats(&stats);
+	printk("bench %s filter: %u rules %u predicates, %u of %u frames dropped\n", corpus.name,
+	       stats.rules, stats.predicates, stats.dropped, stats.frames);
+	rid_filter_init();
+}
+#endif
+
+#if defined(CONFIG_RID_TEXT)
+static void bench_format(void)
+{
+	struct odid_message msgs[ODID_PACK_MAX_MSGS];
+	uint64_t start = rid_wall_time_us();
+
+	for (uint32_t r = 0; r < CONFIG_RID_BENCH_FORMAT_ROUNDS; r++) {
+		for (uint32_t i = 0; i < corpus.count; i++) {
+			int n = decode_frame(&corpus.frames[i], msgs);
+
+			for (int m = 0; m < n; m++) {
+				odid_print_message(&msgs[m]);
+			}
+		}
+	}
+
+	report_rate("format", CONFIG_RID_BENCH_FORMAT_ROUNDS * corpus.count, rid_wall_time_us() - start);
+}
+#endif
+
+static void bench_message_types(void)
+{
+	struct odid_message msg;
+	uint32_t decode_cycles[ODID_MSG_TYPE_COUNT] = {0};
+	uint32_t format_cycles[ODID_MSG_TYPE_COUNT] = {0};
+
+	build_type_msgs(0);
+
+	for (int type = 0; type < ODID_MSG_TYPE_COUNT; type++) {
+		if (msg_type_names[type] == NULL || type_msgs[type][0] == 0 ||
+		    !(ODID_DECODE_MASK & BIT(type))) {
+			continue;
+		}
+
+		uint32_t start = rid_cycles_get();
+
+		for (uint32_t r = 0; r < CONFIG_RID_BENCH_ROUNDS * 100; r++) {
+			odid_decode_message(type_msgs[type], &msg);
+			__asm__ volatile("" : : "m"(msg) : "memory");
+		}
+		decode_cycles[type] = (rid_cycles_get() - start) / (CONFIG_RID_BENCH_ROUNDS * 100);
+
+#if defined(CONFIG_RID_TEXT)
+		start = rid_cycles_get();
+		for (uint32_t r = 0; r < CONFIG_RID_BENCH_FORMAT_ROUNDS; r++) {
+			odid_print_message(&msg);
+		}
+		format_cycles[type] = (rid_cycles_get() - start) / CONFIG_RID_BENCH_FORMAT_ROUNDS;
+#endif
+	}
+
+	for (int type = 0; type < ODID_MSG_TYPE_COUNT; type++) {
+		if (decode_cycles[type] || format_cycles[type]) {
+#if defined(CONFIG_RID_TEXT)
+			printk("bench %s: decode %u cycles/msg, format %u cycles/msg\n",
+			       msg_type_names[type], decode_cycles[type], format_cycles[type]);
+#else
+			printk("bench %s: decode %u cycles/msg\n", msg_type_names[type], decode_cycles[type]);
+#endif
+		}
+	}
+}
+
+/* ID and UUID to text, the per-byte work behind Basic ID, Self ID and Operator ID output. */
+static void bench_convert(void)
+{
+	static const uint8_t id_chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ-.";
+	uint8_t id[ODID_STR_SIZE];
+	char buf[2 * ODID_STR_SIZE + 1];
+	uint32_t rounds = CONFIG_RID_BENCH_ROUNDS * 100;
+
+	for (int i = 0; i < ODID_STR_SIZE; i++) {
+		// mostly ID characters with the odd byte that has to be replaced
+		id[i] = bench_rand() % 8 ? id_chars[bench_rand() % (sizeof(id_chars) - 1)] : (uint8_t)bench_rand();
+	}
+
+	uint32_t start = rid_cycles_get();
+
+	for (uint32_t r = 0; r < rounds; r++) {
+		odid_format_ascii(buf, id, ODID_ID_SIZE);
+		__asm__ volatile("" : : "m"(buf) : "memory");
+	}
+	uint32_t ascii_cycles = (rid_cycles_get() - start) / rounds;
+
+	start = rid_cycles_get();
+	for (uint32_t r = 0; r < rounds; r++) {
+		odid_format_hex(buf, id, 16);
+		__asm__ volatile("" : : "m"(buf) : "memory");
+	}
+	uint32_t hex_cycles = (rid_cycles_get() - start) / rounds;
+
+	printk("bench convert: ascii %u cycles/id, hex %u cycles/uuid\n", ascii_cycles, hex_cycles);
+}
+
+/* Which decoders and printers this build has, so results of different builds can be told apart. */
+static void report_build(void)
+{
+	printk("bench build: decoders");
+	for (int type = 0; type < ODID_MSG_TYPE_COUNT; type++) {
+		if (ODID_DECODE_MASK & BIT(type)) {
+			printk(" %s", msg_type_names[type]);
+		}
+	}
+	printk(", text %s\n", IS_ENABLED(CONFIG_RID_TEXT) ? "on" : "off");
+}
+
+static void bench_corpus(void)
+{
+	bench_locate();
+	bench_pack();
+#if defined(CONFIG_RID_DEDUP)
+	bench_dedup();
+#endif
+#if defined(CONFIG_RID_FILTER)
+	bench_filter();
+#endif
+#if defined(CONFIG_RID_TEXT)
+	bench_format();
+#endif
+}
+
+void rid_decode_bench(void)
+{
+	rid_cycles_init();
+	report_build();
+
+	build_synthetic_corpus();
+	bench_corpus();
+
+#if defined(RID_BENCH_HAVE_CORPUS)
+	build_captured_corpus();
+	bench_corpus();
+#endif
+
+	bench_message_types();
+	bench_convert();
+	printk("bench done\n");
+}
+
+#if defined(CONFIG_RID_OUTPUT_BENCH)
+// aircraft taking turns in the output benchmark, so that no decoder batch holds two frames of one
+#define OUTPUT_BENCH_DRONES 16
+
+BUILD_ASSERT(CONFIG_RID_DECODER_BATCH <= OUTPUT_BENCH_DRONES,
+	     "a decoder batch would coalesce frames of the same aircraft");
+// past one message counter lap of every aircraft, a run would repeat its own frames
+BUILD_ASSERT(CONFIG_RID_OUTPUT_BENCH_FRAMES <= OUTPUT_BENCH_DRONES * 256,
+	     "output bench frames would repeat within a run");
+
+static struct wifi_raw_scan_result output_frame;
+static uint32_t output_seq;
+
+/* Push count copies of raw, each from the next aircraft in turn and with its
+ * message counter moved on, so that none of them is a repeat to dedup and
+ * every one of them reaches the sink.
+ */
+static uint32_t run_frames(const struct wifi_raw_scan_result *raw, uint32_t count)
+{
+	struct rid_ring_stats stats;
+	size_t pack_len;
+	uint64_t start;
+
+#if defined(CONFIG_RID_DEDUP)
+	// the frames of the previous run are still within the window
+	rid_dedup_reset();
+#endif
+
+	output_frame = *raw;
+	uint8_t *pack = (uint8_t *)odid_locate_pack(output_frame.data, output_frame.frame_length,
+						    &pack_len, NULL, NULL);
+
+	start = rid_wall_time_us();
+
+	for (uint32_t i = 0; i < count; i++, output_seq++) {
+		output_frame.data[10 + 5] = output_seq % OUTPUT_BENCH_DRONES;
+		pack[-1] = output_seq / OUTPUT_BENCH_DRONES;  // the counter precedes the pack
+
+		// the ring is the only backpressure the real event callback sees, so retry instead of dropping here
+		while (!rid_ring_push(&output_frame, 0)) {
+			k_sleep(K_MSEC(1));
+		}
+	}
+
+	do {
+		k_sleep(K_MSEC(1));
+		rid_ring_get_stats(&stats);
+	} while (stats.depth > 0);
+
+	uint64_t elapsed_us = rid_wall_time_us() - start;
+
+	return elapsed_us ? (uint32_t)(((uint64_t)count * USEC_PER_SEC) / elapsed_us) : 0;
+}
+
+void rid_output_bench(void)
+{
+	uint32_t detached;
+	uint32_t attached;
+	struct rid_output_stats out;
+
+	// the first frame of the synthetic corpus is a RID beacon
+	build_synthetic_corpus();
+	const struct wifi_raw_scan_result *raw = &corpus.frames[0];
+
+	rid_output_set_backend(NULL);
+	detached = run_frames(raw, CONFIG_RID_OUTPUT_BENCH_FRAMES);
+
+	rid_output_set_backend(&rid_output_backend_null);
+	attached = run_frames(raw, CONFIG_RID_OUTPUT_BENCH_FRAMES);
+	rid_output_get_stats(&out);
+
+	printk("output bench: detached %u frames/s\n", detached);
+	printk("output bench: attached %u frames/s (%u records of %u frames, %u dropped, %u bytes)\n",
+	       attached, out.records, CONFIG_RID_OUTPUT_BENCH_FRAMES, out.dropped, out.bytes);
+}
+#endif
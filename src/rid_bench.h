@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Throughput benchmarks run instead of scanning (native_sim or hardware)
+ */
+
+#ifndef RID_BENCH_H_
+#define RID_BENCH_H_
+
+/* Push canned ODID beacons through the ring, decoder and output sink, once
+ * with the sink detached and once attached to the null backend, and print
+ * frames/sec for both.
+ */
+void rid_output_bench(void);
+
+/* Time ODID element lookup, pack decoding and formatting over the synthetic
+ * and (if configured) captured corpora, then decode and format cost per
+ * message type, and print the results.
+ */
+void rid_decode_bench(void);
+
+#endif /* RID_BENCH_H_ */
@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#if defined(CONFIG_RID_CAPTURE_BACKEND_FS) || \
+	(defined(CONFIG_RID_REPLAY) && !defined(RID_REPLAY_HAVE_FILE))
+#if !defined(CONFIG_FILE_SYSTEM)
+#error "Replay without CONFIG_RID_REPLAY_FILE reads CONFIG_RID_CAPTURE_PATH and needs CONFIG_FILE_SYSTEM"
+#endif
+#include <zephyr/fs/fs.h>
+#endif
+
+#include "rid_capture.h"
+
+LOG_MODULE_REGISTER(rid_capture, CONFIG_LOG_DEFAULT_LEVEL);
+
+static const struct rid_capture_file_hdr file_hdr = {
+	.magic = RID_CAPTURE_MAGIC,
+	.version = RID_CAPTURE_VERSION,
+};
+
+static size_t put_varint(uint8_t *buf, uint32_t value)
+{
+	size_t n = 0;
+
+	while (value >= 0x80) {
+		buf[n++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	buf[n++] = value;
+
+	return n;
+}
+
+/* Returns the varint length, 0 if it runs past len, -EINVAL if it is too long. */
+static int get_varint(const uint8_t *buf, size_t len, uint32_t *value)
+{
+	*value = 0;
+	for (size_t n = 0; n < 5; n++) {
+		if (n >= len) {
+			return 0;
+		}
+		*value |= (uint32_t)(buf[n] & 0x7F) << (7 * n);
+		if (!(buf[n] & 0x80)) {
+			return n + 1;
+		}
+	}
+
+	return -EINVAL;
+}
+
+size_t rid_capture_encode(uint8_t *buf, uint32_t delta_ms, const struct wifi_raw_scan_result *raw)
+{
+	size_t frame_len = MIN((size_t)MAX(raw->frame_length, 0), sizeof(raw->data));
+	size_t n = put_varint(buf, delta_ms);
+
+	buf[n++] = (uint8_t)raw->rssi;
+	sys_put_le16(raw->frequency, &buf[n]);
+	n += 2;
+	n += put_varint(&buf[n], frame_len);
+	memcpy(&buf[n], raw->data, frame_len);
+
+	return n + frame_len;
+}
+
+int rid_capture_decode(const uint8_t *buf, size_t len, uint32_t *delta_ms,
+		       struct wifi_raw_scan_result *raw)
+{
+	uint32_t frame_len;
+	size_t n;
+	int ret;
+
+	ret = get_varint(buf, len, delta_ms);
+	if (ret <= 0) {
+		return ret;
+	}
+	n = ret;
+	if (len < n + 3) {
+		return 0;
+	}
+	raw->rssi = (int8_t)buf[n];
+	raw->frequency = sys_get_le16(&buf[n + 1]);
+	n += 3;
+
+	ret = get_varint(&buf[n], len - n, &frame_len);
+	if (ret <= 0) {
+		return ret;
+	}
+	n += ret;
+	if (frame_len > RID_CAPTURE_RECORD_MAX) {
+		return -EINVAL;
+	}
+	if (len < n + frame_len) {
+		return 0;
+	}
+
+	// a capture from a build with longer raw results is cut to what fits here
+	raw->frame_length = MIN(frame_len, sizeof(raw->data));
+	memcpy(raw->data, &buf[n], raw->frame_length);
+
+	return n + frame_len;
+}
+
+#if defined(CONFIG_RID_CAPTURE)
+
+static K_MUTEX_DEFINE(capture_lock);
+static struct rid_capture_stats stats;
+static bool capture_enabled = true;
+static bool have_last;
+static uint32_t last_timestamp;
+
+#if defined(CONFIG_RID_CAPTURE_BACKEND_RAM)
+
+BUILD_ASSERT((CONFIG_RID_CAPTURE_RAM_SIZE & (CONFIG_RID_CAPTURE_RAM_SIZE - 1)) == 0,
+	     "CONFIG_RID_CAPTURE_RAM_SIZE must be a power of two");
+BUILD_ASSERT(CONFIG_RID_CAPTURE_RAM_SIZE >= 2 * RID_CAPTURE_RECORD_MAX,
+	     "CONFIG_RID_CAPTURE_RAM_SIZE must hold at least two records");
+
+#define RAM_MASK (CONFIG_RID_CAPTURE_RAM_SIZE - 1)
+
+// free-running byte indices, wrapped with RAM_MASK on access; tail is always a record start
+static uint8_t ram[CONFIG_RID_CAPTURE_RAM_SIZE];
+static uint32_t ram_head;
+static uint32_t ram_tail;
+
+static void ram_copy_out(uint32_t from, uint8_t *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		buf[i] = ram[(from + i) & RAM_MASK];
+	}
+}
+
+/* Length of the record at the tail, read through the wrap. */
+static size_t ram_tail_record_len(void)
+{
+	uint8_t hdr[5 + 3 + 5];
+	uint32_t delta_ms;
+	uint32_t frame_len;
+	int n, m;
+
+	ram_copy_out(ram_tail, hdr, MIN(sizeof(hdr), ram_head - ram_tail));
+	n = get_varint(hdr, sizeof(hdr), &delta_ms);
+	m = get_varint(&hdr[n + 3], sizeof(hdr) - n - 3, &frame_len);
+
+	return n + 3 + m + frame_len;
+}
+
+static int storage_store(const uint8_t *rec, size_t len)
+{
+	// drop whole records from the old end until the new one fits
+	while (CONFIG_RID_CAPTURE_RAM_SIZE - (ram_head - ram_tail) < len) {
+		ram_tail += ram_tail_record_len();
+		stats.overwritten++;
+	}
+	for (size_t i = 0; i < len; i++) {
+		ram[(ram_head + i) & RAM_MASK] = rec[i];
+	}
+	ram_head += len;
+	stats.bytes = ram_head - ram_tail;
+
+	return 0;
+}
+
+size_t rid_capture_read(size_t offset, uint8_t *buf, size_t len)
+{
+	size_t n = 0;
+
+	k_mutex_lock(&capture_lock, K_FOREVER);
+
+	if (offset < sizeof(file_hdr)) {
+		n = MIN(len, sizeof(file_hdr) - offset);
+		memcpy(buf, (const uint8_t *)&file_hdr + offset, n);
+		offset += n;
+	}
+	offset -= sizeof(file_hdr);
+	if (offset < ram_head - ram_tail) {
+		size_t m = MIN(len - n, ram_head - ram_tail - offset);
+
+		ram_copy_out(ram_tail + offset, &buf[n], m);
+		n += m;
+	}
+
+	k_mutex_unlock(&capture_lock);
+
+	return n;
+}
+
+static void storage_clear(void)
+{
+	ram_head = 0;
+	ram_tail = 0;
+	stats.bytes = 0;
+}
+
+static int storage_init(void)
+{
+	return 0;
+}
+
+static void storage_flush(void)
+{
+}
+
+#elif defined(CONFIG_RID_CAPTURE_BACKEND_FS)
+
+static struct fs_file_t capture_file;
+static bool file_open;
+static uint32_t last_sync;
+
+static int storage_init(void)
+{
+	struct fs_dirent entry;
+	int ret;
+
+	fs_file_t_init(&capture_file);
+	ret = fs_open(&capture_file, CONFIG_RID_CAPTURE_PATH, FS_O_CREATE | FS_O_APPEND | FS_O_WRITE);
+	if (ret) {
+		LOG_ERR("Cannot open %s (%d)", CONFIG_RID_CAPTURE_PATH, ret);
+		return ret;
+	}
+	file_open = true;
+
+	// a new file gets the header, an existing one is appended to
+	if (fs_stat(CONFIG_RID_CAPTURE_PATH, &entry) == 0 && entry.size == 0) {
+		fs_write(&capture_file, &file_hdr, sizeof(file_hdr));
+	}
+	last_sync = k_uptime_get_32();
+
+	return 0;
+}
+
+static int storage_store(const uint8_t *rec, size_t len)
+{
+	if (!file_open) {
+		return -EBADF;
+	}
+
+	ssize_t ret = fs_write(&capture_file, rec, len);
+
+	if (ret != (ssize_t)len) {
+		stats.errors++;
+		return ret < 0 ? ret : -ENOSPC;
+	}
+	stats.bytes += len;
+
+	return 0;
+}
+
+static void storage_flush(void)
+{
+	// syncing wears the flash, so only once a second
+	if (file_open && k_uptime_get_32() - last_sync >= MSEC_PER_SEC) {
+		fs_sync(&capture_file);
+		last_sync = k_uptime_get_32();
+	}
+}
+
+size_t rid_capture_read(size_t offset, uint8_t *buf, size_t len)
+{
+	return 0;
+}
+
+static void storage_clear(void)
+{
+	if (file_open) {
+		fs_truncate(&capture_file, 0);
+		fs_write(&capture_file, &file_hdr, sizeof(file_hdr));
+	}
+	stats.bytes = 0;
+}
+
+#endif /* CONFIG_RID_CAPTURE_BACKEND_RAM */
+
+int rid_capture_init(void)
+{
+	return storage_init();
+}
+
+void rid_capture_frame(const struct rid_frame *frame, bool is_rid)
+{
+	static uint8_t rec[RID_CAPTURE_RECORD_MAX];  // too big for the decoder stack; used under the lock
+
+	if (!capture_enabled || (IS_ENABLED(CONFIG_RID_CAPTURE_RID_ONLY) && !is_rid)) {
+		return;
+	}
+
+	k_mutex_lock(&capture_lock, K_FOREVER);
+
+	size_t len = rid_capture_encode(rec, have_last ? frame->timestamp - last_timestamp : 0,
+					&frame->raw);
+
+	if (storage_store(rec, len) == 0) {
+		stats.records++;
+		last_timestamp = frame->timestamp;
+		have_last = true;
+	}
+
+	k_mutex_unlock(&capture_lock);
+}
+
+void rid_capture_flush(void)
+{
+	k_mutex_lock(&capture_lock, K_FOREVER);
+	storage_flush();
+	k_mutex_unlock(&capture_lock);
+}
+
+void rid_capture_set_enabled(bool enabled)
+{
+	capture_enabled = enabled;
+}
+
+void rid_capture_clear(void)
+{
+	k_mutex_lock(&capture_lock, K_FOREVER);
+	storage_clear();
+	have_last = false;
+	k_mutex_unlock(&capture_lock);
+}
+
+void rid_capture_get_stats(struct rid_capture_stats *out)
+{
+	k_mutex_lock(&capture_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&capture_lock);
+}
+
+#endif /* CONFIG_RID_CAPTURE */
+
+#if defined(CONFIG_RID_REPLAY)
+
+#if defined(RID_REPLAY_HAVE_FILE)
+// capture embedded at build time from CONFIG_RID_REPLAY_FILE
+static const uint8_t replay_data[] = {
+#include "rid_replay_capture.inc"
+};
+#endif
+
+struct replay_state {
+	rid_replay_sink sink;
+	int64_t due;            // uptime the next record is due at, recorded speed only
+	uint32_t records;
+	uint32_t retries;
+};
+
+static void replay_one(struct replay_state *state, uint32_t delta_ms,
+		       const struct wifi_raw_scan_result *raw)
+{
+#if CONFIG_RID_REPLAY_SPEED > 0
+	state->due += (int64_t)delta_ms * 100 / CONFIG_RID_REPLAY_SPEED;
+	k_sleep(K_TIMEOUT_ABS_MS(state->due));
+	state->sink(raw);  // at recorded speed a full ring drops, as it would live
+#else
+	// as fast as the decoder keeps up, without losing anything
+	while (!state->sink(raw)) {
+		state->retries++;
+		k_sleep(K_MSEC(1));
+	}
+#endif
+	state->records++;
+}
+
+/* Replay the records in buf; returns the bytes consumed, or -EINVAL. */
+static int replay_buffer(struct replay_state *state, const uint8_t *buf, size_t len)
+{
+	static struct wifi_raw_scan_result raw;
+	size_t off = 0;
+
+	while (off < len) {
+		uint32_t delta_ms;
+		int n = rid_capture_decode(&buf[off], len - off, &delta_ms, &raw);
+
+		if (n < 0) {
+			LOG_ERR("Malformed capture record at offset %zu", off);
+			return n;
+		}
+		if (n == 0) {
+			break;
+		}
+		replay_one(state, delta_ms, &raw);
+		off += n;
+	}
+
+	return off;
+}
+
+static bool valid_header(const uint8_t *buf, size_t len)
+{
+	const struct rid_capture_file_hdr *hdr = (const void *)buf;
+
+	return len >= sizeof(*hdr) && memcmp(hdr->magic, RID_CAPTURE_MAGIC, 4) == 0 &&
+	       hdr->version == RID_CAPTURE_VERSION;
+}
+
+#if defined(RID_REPLAY_HAVE_FILE)
+static int replay_pass(struct replay_state *state)
+{
+	if (!valid_header(replay_data, sizeof(replay_data))) {
+		LOG_ERR("%s is not a capture", CONFIG_RID_REPLAY_FILE);
+		return -EINVAL;
+	}
+
+	int ret = replay_buffer(state, replay_data + sizeof(struct rid_capture_file_hdr),
+				sizeof(replay_data) - sizeof(struct rid_capture_file_hdr));
+
+	return ret < 0 ? ret : 0;
+}
+#else
+static int replay_pass(struct replay_state *state)
+{
+	static uint8_t buf[2 * RID_CAPTURE_RECORD_MAX];
+	struct fs_file_t file;
+	size_t fill = 0;
+	ssize_t got;
+	int ret = 0;
+
+	fs_file_t_init(&file);
+	ret = fs_open(&file, CONFIG_RID_CAPTURE_PATH, FS_O_READ);
+	if (ret) {
+		LOG_ERR("Cannot open %s (%d)", CONFIG_RID_CAPTURE_PATH, ret);
+		return ret;
+	}
+
+	got = fs_read(&file, buf, sizeof(struct rid_capture_file_hdr));
+	if (got < 0 || !valid_header(buf, got)) {
+		LOG_ERR("%s is not a capture", CONFIG_RID_CAPTURE_PATH);
+		fs_close(&file);
+		return -EINVAL;
+	}
+
+	// stream the file through buf, carrying a partial record over to the next read
+	while ((got = fs_read(&file, &buf[fill], sizeof(buf) - fill)) > 0) {
+		fill += got;
+		ret = replay_buffer(state, buf, fill);
+		if (ret < 0) {
+			break;
+		}
+		fill -= ret;
+		memmove(buf, &buf[ret], fill);
+		ret = 0;
+	}
+
+	fs_close(&file);
+
+	return ret;
+}
+#endif /* RID_REPLAY_HAVE_FILE */
+
+int rid_replay_run(rid_replay_sink sink)
+{
+	struct replay_state state = {
+		.sink = sink,
+		.due = k_uptime_get(),
+	};
+
+	for (int loop = 0; CONFIG_RID_REPLAY_LOOPS == 0 || loop < CONFIG_RID_REPLAY_LOOPS; loop++) {
+		uint32_t before = state.records;
+
+		if (replay_pass(&state) < 0 || state.records == before) {
+			break;
+		}
+	}
+
+	LOG_INF("replay done: %u records, %u retries", state.records, state.retries);
+
+	return state.records;
+}
+
+#endif /* CONFIG_RID_REPLAY */
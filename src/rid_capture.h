@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Capture and replay of raw scan results
+ *
+ * A capture is an 8-byte file header followed by one record per raw scan
+ * result:
+ *
+ *   varint  ms since the previous record (0 for the first)
+ *   int8    RSSI
+ *   le16    frequency (MHz)
+ *   varint  frame length
+ *   bytes   frame
+ *
+ * Varints are unsigned LEB128. Records are self-delimiting, so a capture can
+ * be cut at any record boundary and still replays. Captures go to a RAM ring
+ * that keeps the most recent traffic, or are appended to a file; replay
+ * feeds them back through the same path as live scan results.
+ * scripts/rid_capture.py converts captures to and from pcap.
+ */
+
+#ifndef RID_CAPTURE_H_
+#define RID_CAPTURE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/net/wifi_mgmt.h>
+
+#include "rid_ring.h"
+
+#define RID_CAPTURE_MAGIC   "RIDC"
+#define RID_CAPTURE_VERSION 1
+
+struct rid_capture_file_hdr {
+	uint8_t magic[4];       // RID_CAPTURE_MAGIC
+	uint8_t version;        // RID_CAPTURE_VERSION
+	uint8_t reserved[3];
+} __packed;
+
+// delta timestamp and frame length varints, RSSI, frequency and the frame
+#define RID_CAPTURE_RECORD_MAX (5 + 1 + 2 + 3 + CONFIG_WIFI_MGMT_RAW_SCAN_RESULT_LENGTH)
+
+struct rid_capture_stats {
+	uint32_t records;       // records captured
+	uint32_t bytes;         // bytes currently held (RAM) or written (file)
+	uint32_t overwritten;   // oldest records dropped to make room (RAM)
+	uint32_t errors;        // file writes that failed
+};
+
+/* Receives one replayed raw scan result. Returns false if it could not be
+ * taken, in which case a replay at full speed retries it.
+ */
+typedef bool (*rid_replay_sink)(const struct wifi_raw_scan_result *raw);
+
+/* Encode one record into buf (at least RID_CAPTURE_RECORD_MAX bytes). Returns its length. */
+size_t rid_capture_encode(uint8_t *buf, uint32_t delta_ms, const struct wifi_raw_scan_result *raw);
+
+/* Decode the record at buf. Returns its length, 0 if len does not hold a whole
+ * record yet, or -EINVAL if it is malformed.
+ */
+int rid_capture_decode(const uint8_t *buf, size_t len, uint32_t *delta_ms,
+		       struct wifi_raw_scan_result *raw);
+
+#if defined(CONFIG_RID_CAPTURE)
+
+int rid_capture_init(void);
+
+/* Capture a raw result taken from the ring. is_rid tells whether it carries
+ * Remote ID, for CONFIG_RID_CAPTURE_RID_ONLY. Decoder thread only.
+ */
+void rid_capture_frame(const struct rid_frame *frame, bool is_rid);
+
+/* Push captured data to storage; cheap when there is nothing to do. */
+void rid_capture_flush(void);
+
+void rid_capture_set_enabled(bool enabled);
+
+/* Copy out the capture, starting with the file header, from offset on.
+ * Returns the number of bytes copied, 0 at the end. RAM backend only.
+ */
+size_t rid_capture_read(size_t offset, uint8_t *buf, size_t len);
+
+void rid_capture_clear(void);
+
+void rid_capture_get_stats(struct rid_capture_stats *stats);
+
+#else
+
+static inline int rid_capture_init(void) { return 0; }
+static inline void rid_capture_frame(const struct rid_frame *frame, bool is_rid) {}
+static inline void rid_capture_flush(void) {}
+
+#endif /* CONFIG_RID_CAPTURE */
+
+#if defined(CONFIG_RID_REPLAY)
+
+/* Replay the capture configured by CONFIG_RID_REPLAY_FILE (built in) or
+ * CONFIG_RID_CAPTURE_PATH (file system) into sink,
+ * CONFIG_RID_REPLAY_LOOPS times. Returns the number of records replayed.
+ */
+int rid_replay_run(rid_replay_sink sink);
+
+#endif /* CONFIG_RID_REPLAY */
+
+#endif /* RID_CAPTURE_H_ */
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+
+#include "rid_clock.h"
+
+#define MS_PER_HOUR      3600000
+#define TENTHS_PER_HOUR  36000
+
+// UTC at sync_time; moved to the latest use, so the 32-bit uptime never wraps in between
+static uint64_t sync_unix_ms;
+static uint32_t sync_time;
+static struct rid_clock_stats stats;
+static K_MUTEX_DEFINE(clock_lock);
+
+static uint64_t unix_ms_at(uint32_t now)
+{
+	uint64_t unix_ms = sync_unix_ms + (uint32_t)(now - sync_time);
+
+	sync_unix_ms = unix_ms;
+	sync_time = now;
+
+	return unix_ms;
+}
+
+/* Something stamped unix_ms by an aircraft was received at now. */
+static bool bound(uint64_t unix_ms, uint32_t now)
+{
+	if (stats.source == RID_CLOCK_NONE) {
+		sync_unix_ms = unix_ms;
+		sync_time = now;
+		stats.source = RID_CLOCK_AIRCRAFT;
+		return true;
+	}
+
+	uint64_t clock = unix_ms_at(now);
+
+	if (unix_ms <= clock) {
+		return true;
+	}
+	if (stats.source == RID_CLOCK_HOST) {
+		stats.ahead++;
+		return false;
+	}
+	if (unix_ms - clock > CONFIG_RID_CLOCK_MAX_STEP_MS) {
+		stats.rejected++;  // an aircraft with its clock way off
+		return false;
+	}
+
+	sync_unix_ms = unix_ms;
+	stats.steps++;
+	stats.last_step_ms = unix_ms - clock;
+
+	return true;
+}
+
+void rid_clock_set(uint64_t unix_ms, uint32_t now)
+{
+	k_mutex_lock(&clock_lock, K_FOREVER);
+
+	sync_unix_ms = unix_ms;
+	sync_time = now;
+	stats.source = RID_CLOCK_HOST;
+
+	k_mutex_unlock(&clock_lock);
+}
+
+void rid_clock_system(uint32_t timestamp, uint32_t now)
+{
+	if (timestamp == 0) {
+		return;  // not set by the aircraft
+	}
+
+	k_mutex_lock(&clock_lock, K_FOREVER);
+
+	if (stats.source != RID_CLOCK_HOST) {
+		bound((RID_CLOCK_ODID_EPOCH + (uint64_t)timestamp) * MSEC_PER_SEC, now);
+	}
+
+	k_mutex_unlock(&clock_lock);
+}
+
+bool rid_clock_get(uint32_t now, uint64_t *unix_ms)
+{
+	k_mutex_lock(&clock_lock, K_FOREVER);
+	bool set = stats.source != RID_CLOCK_NONE;
+
+	if (set) {
+		*unix_ms = unix_ms_at(now);
+	}
+
+	k_mutex_unlock(&clock_lock);
+
+	return set;
+}
+
+bool rid_clock_fix_age(uint16_t timestamp, uint32_t now, int32_t *age_ms)
+{
+	if (timestamp >= TENTHS_PER_HOUR) {
+		return false;  // 0xFFFF: unknown
+	}
+
+	k_mutex_lock(&clock_lock, K_FOREVER);
+
+	if (stats.source == RID_CLOCK_NONE) {
+		k_mutex_unlock(&clock_lock);
+		return false;
+	}
+
+	// the fix was taken in whichever hour puts it closest to now
+	uint64_t clock = unix_ms_at(now);
+	int32_t age = ((int32_t)(clock % MS_PER_HOUR) - timestamp * 100 + MS_PER_HOUR) % MS_PER_HOUR;
+
+	if (age > MS_PER_HOUR / 2) {
+		age -= MS_PER_HOUR;
+	}
+
+	bool known = age >= 0 || bound(clock - age, now);
+
+	k_mutex_unlock(&clock_lock);
+
+	if (known) {
+		*age_ms = MAX(age, 0);
+	}
+
+	return known;
+}
+
+void rid_clock_get_stats(struct rid_clock_stats *out)
+{
+	k_mutex_lock(&clock_lock, K_FOREVER);
+
+	*out = stats;
+
+	k_mutex_unlock(&clock_lock);
+}
+
+const char *rid_clock_source_txt(enum rid_clock_source source)
+{
+	switch (source) {
+	case RID_CLOCK_NONE:
+		return "not set";
+	case RID_CLOCK_AIRCRAFT:
+		return "aircraft";
+	case RID_CLOCK_HOST:
+		return "host";
+	}
+
+	return "unknown";
+}
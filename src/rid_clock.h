@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief UTC clock for the age of Remote ID positions
+ *
+ * A Location/Vector message is stamped with the tenths of a second past the
+ * full UTC hour at which its position was taken. Turning that into the age
+ * of the position on reception needs the UTC time here, which comes from
+ * the host ("wifi rid clock <unix time>") or, failing that, from the System
+ * messages of the aircraft around.
+ *
+ * Aircraft only give lower bounds: nothing is received before it was
+ * stamped. The clock starts at the first System timestamp (whole seconds)
+ * and is stepped forward by any later System or Location timestamp that
+ * would otherwise lie in the future, by at most CONFIG_RID_CLOCK_MAX_STEP_MS
+ * at a time. Ages are then measured against the earliest any aircraft
+ * could have sent its position, so they are lower bounds too. A host time
+ * is taken as it is and overrides the aircraft.
+ */
+
+#ifndef RID_CLOCK_H_
+#define RID_CLOCK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// the epoch of ODID System timestamps, 2019-01-01 00:00:00 UTC, in Unix seconds
+#define RID_CLOCK_ODID_EPOCH 1546300800U
+
+enum rid_clock_source {
+	RID_CLOCK_NONE,
+	RID_CLOCK_AIRCRAFT,     // System and Location timestamps
+	RID_CLOCK_HOST,
+};
+
+struct rid_clock_stats {
+	enum rid_clock_source source;
+	uint32_t steps;         // times an aircraft timestamp moved the clock forward
+	int32_t last_step_ms;
+	uint32_t rejected;      // timestamps further ahead than CONFIG_RID_CLOCK_MAX_STEP_MS
+	uint32_t ahead;         // positions stamped after they were received, by the host clock
+};
+
+#if defined(CONFIG_RID_CLOCK)
+
+/* Set the clock to unix_ms (ms since 1970-01-01 UTC) at now (ms since boot). */
+void rid_clock_set(uint64_t unix_ms, uint32_t now);
+
+/* A System message stamped timestamp (seconds since 2019) was received at now. */
+void rid_clock_system(uint32_t timestamp, uint32_t now);
+
+/* UTC at now in ms since 1970. Returns false while the clock is not set. */
+bool rid_clock_get(uint32_t now, uint64_t *unix_ms);
+
+/* Age at now of a position stamped timestamp (tenths of a second past the
+ * hour) in ms. Returns false if the clock is not set or the timestamp is
+ * unknown or inconsistent with the clock.
+ */
+bool rid_clock_fix_age(uint16_t timestamp, uint32_t now, int32_t *age_ms);
+
+void rid_clock_get_stats(struct rid_clock_stats *stats);
+
+const char *rid_clock_source_txt(enum rid_clock_source source);
+
+#else
+
+static inline void rid_clock_system(uint32_t timestamp, uint32_t now) {}
+static inline bool rid_clock_fix_age(uint16_t timestamp, uint32_t now, int32_t *age_ms)
+{
+	return false;
+}
+
+#endif /* CONFIG_RID_CLOCK */
+
+#endif /* RID_CLOCK_H_ */
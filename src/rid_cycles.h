@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief CPU cycle and wall-clock timestamps for benchmarks and instrumentation
+ *
+ * On Cortex-M the DWT cycle counter is used, because the kernel cycle counter
+ * on nRF runs from the 32 kHz RTC. On native_sim simulated time does not
+ * advance while code runs, so the host TSC and host clock are used instead.
+ */
+
+#ifndef RID_CYCLES_H_
+#define RID_CYCLES_H_
+
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#if defined(CONFIG_ARCH_POSIX)
+#include "native_rtc.h"
+#elif defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+#include <cmsis_core.h>
+#endif
+
+static inline void rid_cycles_init(void)
+{
+#if !defined(CONFIG_ARCH_POSIX) && defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+static inline uint32_t rid_cycles_get(void)
+{
+#if defined(CONFIG_ARCH_POSIX) && (defined(__x86_64__) || defined(__i386__))
+	return (uint32_t)__builtin_ia32_rdtsc();
+#elif defined(CONFIG_ARCH_POSIX)
+	return (uint32_t)(native_rtc_gettime_us(RTC_CLOCK_REALTIME) * 1000U);
+#elif defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+	return DWT->CYCCNT;
+#else
+	return k_cycle_get_32();
+#endif
+}
+
+/* Wall-clock time in microseconds, for throughput over long runs. */
+static inline uint64_t rid_wall_time_us(void)
+{
+#if defined(CONFIG_ARCH_POSIX)
+	return native_rtc_gettime_us(RTC_CLOCK_REALTIME);
+#else
+	return k_ticks_to_us_floor64(k_uptime_ticks());
+#endif
+}
+
+#endif /* RID_CYCLES_H_ */
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "rid_dedup.h"
+
+#define WAYS 4
+#define SETS (CONFIG_RID_DEDUP_ENTRIES / WAYS)
+
+BUILD_ASSERT(SETS > 0 && (SETS & (SETS - 1)) == 0,
+	     "CONFIG_RID_DEDUP_ENTRIES must be four times a power of two");
+
+struct dedup_entry {
+	uint8_t mac[6];
+	uint8_t counter;
+	uint8_t valid;
+	uint32_t hash;      // of the message pack
+	uint32_t seen;      // ms since boot
+};
+
+struct dedup_set {
+	struct dedup_entry way[WAYS];
+} __aligned(64);
+
+BUILD_ASSERT(sizeof(struct dedup_set) == 64);
+
+// only ever touched by the decoder thread
+static struct dedup_set sets[SETS];
+static struct rid_dedup_stats stats;
+
+/* A word at a time: packs are a few dozen bytes and this runs for every Remote ID frame. */
+static uint32_t pack_hash(const uint8_t *pack, size_t len)
+{
+	uint32_t h = 0x811C9DC5 ^ len;
+	size_t i = 0;
+
+	for (; i + 4 <= len; i += 4) {
+		h = (h ^ sys_get_le32(&pack[i])) * 0x01000193;
+		h ^= h >> 15;
+	}
+	for (; i < len; i++) {
+		h = (h ^ pack[i]) * 0x01000193;
+	}
+
+	return h;
+}
+
+bool rid_dedup_repeat(const struct wifi_raw_scan_result *raw, uint8_t counter,
+		      const uint8_t *pack, size_t pack_len, uint32_t now)
+{
+	const uint8_t *mac = raw->data + 10;
+	uint32_t hash = pack_hash(pack, pack_len);
+	// the MAC and counter pick the set, so the copies of one frame always meet
+	uint32_t key = (sys_get_le32(&mac[2]) ^ counter) * 0x9E3779B1;
+	struct dedup_set *set = &sets[(key >> 16) & (SETS - 1)];
+	struct dedup_entry *victim = &set->way[0];
+
+	for (int w = 0; w < WAYS; w++) {
+		struct dedup_entry *e = &set->way[w];
+		bool live = e->valid && now - e->seen < CONFIG_RID_DEDUP_WINDOW_MS;
+
+		if (live && e->hash == hash && e->counter == counter &&
+		    memcmp(e->mac, mac, sizeof(e->mac)) == 0) {
+			stats.hits++;
+			stats.saved_bytes += raw->frame_length;
+			return true;
+		}
+		// a free or stale way if there is one, else the oldest
+		if (!live) {
+			victim = e;
+			victim->valid = false;
+		} else if (victim->valid && (int32_t)(e->seen - victim->seen) < 0) {
+			victim = e;
+		}
+	}
+
+	stats.misses++;
+	if (victim->valid) {
+		stats.evictions++;
+	}
+	memcpy(victim->mac, mac, sizeof(victim->mac));
+	victim->counter = counter;
+	victim->hash = hash;
+	victim->seen = now;
+	victim->valid = true;
+
+	return false;
+}
+
+void rid_dedup_get_stats(struct rid_dedup_stats *out)
+{
+	*out = stats;
+}
+
+void rid_dedup_reset(void)
+{
+	memset(sets, 0, sizeof(sets));
+	memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Repeated frame cache
+ *
+ * A scan reports the same beacon more than once, and consecutive scans of a
+ * channel report it again. Before a Remote ID frame is decoded, its
+ * transmitter MAC, message counter and a hash of its message pack are looked
+ * up in a small set-associative cache; a frame seen within
+ * CONFIG_RID_DEDUP_WINDOW_MS is a repeat and is neither decoded nor sent to
+ * the output link. Each set of four entries fills one 64-byte cache line.
+ */
+
+#ifndef RID_DEDUP_H_
+#define RID_DEDUP_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/net/wifi_mgmt.h>
+
+struct rid_dedup_stats {
+	uint32_t hits;          // repeats, i.e. pack decodes and output records saved
+	uint32_t misses;
+	uint32_t evictions;     // entries replaced within the window
+	uint32_t saved_bytes;   // frame bytes kept off the output link
+};
+
+#if defined(CONFIG_RID_DEDUP)
+
+/* Whether raw, carrying pack with message counter, repeats a frame seen
+ * within the window before now (ms). If not, it is remembered.
+ */
+bool rid_dedup_repeat(const struct wifi_raw_scan_result *raw, uint8_t counter,
+		      const uint8_t *pack, size_t pack_len, uint32_t now);
+
+void rid_dedup_get_stats(struct rid_dedup_stats *stats);
+
+/* Forget every frame and clear the counters. */
+void rid_dedup_reset(void);
+
+#else
+
+static inline bool rid_dedup_repeat(const struct wifi_raw_scan_result *raw, uint8_t counter,
+				    const uint8_t *pack, size_t pack_len, uint32_t now)
+{
+	return false;
+}
+
+#endif /* CONFIG_RID_DEDUP */
+
+#endif /* RID_DEDUP_H_ */
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "rid_duty.h"
+#include "rid_stats.h"
+
+LOG_MODULE_REGISTER(rid_duty, CONFIG_LOG_DEFAULT_LEVEL);
+
+static K_MUTEX_DEFINE(duty_lock);
+
+static bool started;
+static enum rid_duty_mode mode;
+static uint32_t mode_since;
+static int radio_count = 1;
+static uint32_t gap_ms[CONFIG_RID_SCAN_RADIOS];
+static uint32_t last_hit;
+
+// the ends of the last two scans, i.e. the last times the radio stopped listening
+static uint32_t last_done;
+static uint32_t prev_done;
+
+static uint32_t start_time;
+static uint64_t radio_us;
+static uint64_t latency_sum_ms;
+static struct rid_duty_stats stats;
+
+static void set_mode(enum rid_duty_mode next, uint32_t now)
+{
+	stats.mode_ms[mode] += now - mode_since;
+	mode_since = now;
+	mode = next;
+	LOG_DBG("%s mode", rid_duty_mode_txt(next));
+}
+
+void rid_duty_init(uint32_t now, int radios)
+{
+	k_mutex_lock(&duty_lock, K_FOREVER);
+	radio_count = CLAMP(radios, 1, CONFIG_RID_SCAN_RADIOS);
+	mode = RID_DUTY_ACTIVE;
+	mode_since = now;
+	last_hit = now;
+	last_done = now;
+	prev_done = now;
+	start_time = now;
+	started = true;
+	k_mutex_unlock(&duty_lock);
+}
+
+uint32_t rid_duty_scan_done(int radio, uint32_t now, uint32_t scan_us)
+{
+	k_mutex_lock(&duty_lock, K_FOREVER);
+
+	radio_us += scan_us;
+	prev_done = last_done;
+	last_done = now;
+
+#if defined(CONFIG_RID_DUTY)
+	if (mode == RID_DUTY_ACTIVE) {
+		if ((int32_t)(now - last_hit) >= CONFIG_RID_DUTY_HOLD_MS) {
+			set_mode(RID_DUTY_DECAY, now);
+			memset(gap_ms, 0, sizeof(gap_ms));
+		}
+	}
+	if (mode != RID_DUTY_ACTIVE) {
+		// every radio decays at its own pace, from its first scan in decay mode on
+		gap_ms[radio] = gap_ms[radio] == 0 ? CONFIG_RID_DUTY_DECAY_GAP_MS : gap_ms[radio] * 2;
+		gap_ms[radio] = MIN(gap_ms[radio], CONFIG_RID_DUTY_SENTINEL_GAP_MS);
+		if (mode == RID_DUTY_DECAY && gap_ms[radio] == CONFIG_RID_DUTY_SENTINEL_GAP_MS) {
+			set_mode(RID_DUTY_SENTINEL, now);
+		}
+	}
+#endif
+
+	uint32_t gap = gap_ms[radio];
+
+	k_mutex_unlock(&duty_lock);
+
+	return gap;
+}
+
+bool rid_duty_hit(uint32_t timestamp)
+{
+	bool escalated = false;
+
+	k_mutex_lock(&duty_lock, K_FOREVER);
+	last_hit = timestamp;
+	if (started && mode != RID_DUTY_ACTIVE) {
+		set_mode(RID_DUTY_ACTIVE, k_uptime_get_32());
+		memset(gap_ms, 0, sizeof(gap_ms));
+		stats.escalations++;
+		escalated = true;
+	}
+	k_mutex_unlock(&duty_lock);
+
+	return escalated;
+}
+
+bool rid_duty_active(void)
+{
+	return mode == RID_DUTY_ACTIVE;
+}
+
+void rid_duty_detected(uint32_t first_seen)
+{
+	if (!started) {
+		return;  // replay and benchmarks do not scan
+	}
+
+	k_mutex_lock(&duty_lock, K_FOREVER);
+
+	// a frame from before the latest scan end came in during that scan, so the
+	// aircraft may have been there unheard ever since the scan before it ended
+	uint32_t listen_end = (int32_t)(first_seen - last_done) < 0 ? prev_done : last_done;
+	uint32_t latency = (int32_t)(first_seen - listen_end) > 0 ? first_seen - listen_end : 0;
+
+	stats.detections++;
+	latency_sum_ms += latency;
+	stats.latency_max_ms = MAX(stats.latency_max_ms, latency);
+
+	k_mutex_unlock(&duty_lock);
+
+	rid_stats_record(RID_STAGE_DETECT, latency);
+}
+
+void rid_duty_get_stats(struct rid_duty_stats *out)
+{
+	uint32_t now = k_uptime_get_32();
+
+	k_mutex_lock(&duty_lock, K_FOREVER);
+
+	*out = stats;
+	out->mode = mode;
+	out->mode_ms[mode] += now - mode_since;
+	out->elapsed_ms = now - start_time;
+	out->radio_ms = MIN(radio_us / USEC_PER_MSEC, (uint64_t)out->elapsed_ms * radio_count);
+	out->latency_avg_ms = stats.detections ? latency_sum_ms / stats.detections : 0;
+
+	k_mutex_unlock(&duty_lock);
+
+	// charge in uA ms, then energy in mJ: uA * mV * ms = 1e-9 mJ
+	uint64_t charge = (uint64_t)out->radio_ms * CONFIG_RID_DUTY_RX_CURRENT_UA +
+			  ((uint64_t)out->elapsed_ms * radio_count - out->radio_ms) *
+			  CONFIG_RID_DUTY_IDLE_CURRENT_UA;
+
+	out->avg_current_ua = out->elapsed_ms ? charge / out->elapsed_ms : 0;
+	out->energy_mj = charge * CONFIG_RID_DUTY_SUPPLY_MV / 1000000000ULL;
+	out->energy_per_detection_mj = out->detections ? out->energy_mj / out->detections : 0;
+}
+
+const char *rid_duty_mode_txt(enum rid_duty_mode m)
+{
+	switch (m) {
+	case RID_DUTY_ACTIVE:
+		return "active";
+	case RID_DUTY_DECAY:
+		return "decay";
+	case RID_DUTY_SENTINEL:
+		return "sentinel";
+	case RID_DUTY_MODE_COUNT:
+		break;
+	}
+
+	return "unknown";
+}
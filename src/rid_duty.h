@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Adaptive scan duty cycle
+ *
+ * With CONFIG_RID_DUTY the scanner idles in a low duty "sentinel" mode, one
+ * scan every CONFIG_RID_DUTY_SENTINEL_GAP_MS, until a Remote ID frame is
+ * received. It then scans back to back until no frame has been seen for
+ * CONFIG_RID_DUTY_HOLD_MS, and decays back to sentinel by doubling the gap
+ * between scans from CONFIG_RID_DUTY_DECAY_GAP_MS. Without it every scan
+ * follows the previous one at once, as before.
+ *
+ * Either way the radio time is put through a simple current model to
+ * estimate the energy spent per detected aircraft, and the time between the
+ * scanner last stopped listening and the first frame of a new aircraft is
+ * recorded as its detection latency.
+ *
+ * With several radios, each one waits out gaps of its own but all follow
+ * the same mode, and the current model counts the idle current of each.
+ */
+
+#ifndef RID_DUTY_H_
+#define RID_DUTY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum rid_duty_mode {
+	RID_DUTY_ACTIVE,    // scanning back to back
+	RID_DUTY_DECAY,     // no frame for the hold time, gaps growing
+	RID_DUTY_SENTINEL,  // one scan per sentinel gap
+	RID_DUTY_MODE_COUNT,
+};
+
+struct rid_duty_stats {
+	enum rid_duty_mode mode;
+	uint32_t escalations;                  // changes to active mode on a frame
+	uint32_t mode_ms[RID_DUTY_MODE_COUNT]; // time spent in each mode
+	uint32_t elapsed_ms;
+	uint32_t radio_ms;                     // time spent scanning, summed over the radios
+	uint32_t avg_current_ua;               // by the current model
+	uint32_t energy_mj;
+	uint32_t detections;                   // new aircraft
+	uint32_t energy_per_detection_mj;
+	uint32_t latency_avg_ms;               // detection latency
+	uint32_t latency_max_ms;
+};
+
+/* Start in active mode, so the first aircraft around at boot are found at once. */
+void rid_duty_init(uint32_t now, int radios);
+
+/* Account a completed scan of scan_us by radio ending at now (ms since boot)
+ * and return how long the radio should wait before requesting the next one.
+ */
+uint32_t rid_duty_scan_done(int radio, uint32_t now, uint32_t scan_us);
+
+/* Count a Remote ID frame received at timestamp. Returns true if it switched
+ * the scanner to active mode, in which case a pending gap should be cut short.
+ */
+bool rid_duty_hit(uint32_t timestamp);
+
+bool rid_duty_active(void);
+
+/* Record the detection of a new aircraft whose first frame arrived at first_seen. */
+void rid_duty_detected(uint32_t first_seen);
+
+void rid_duty_get_stats(struct rid_duty_stats *stats);
+
+const char *rid_duty_mode_txt(enum rid_duty_mode mode);
+
+#endif /* RID_DUTY_H_ */
@@ -0,0 +1,499 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "odid_decoder.h"
+#include "rid_filter.h"
+#include "rid_parse.h"
+
+LOG_MODULE_REGISTER(rid_filter, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define RULE_TEXT_SIZE 64
+
+enum field {
+	FIELD_RSSI,
+	FIELD_FREQ,
+	FIELD_BAND,
+	FIELD_MAC,
+	FIELD_UAS,
+};
+
+enum op {
+	OP_EQ,
+	OP_NE,
+	OP_LT,
+	OP_LE,
+	OP_GT,
+	OP_GE,
+};
+
+struct predicate {
+	uint8_t field;
+	uint8_t op;
+	uint8_t len;              // UAS ID bytes compared
+	union {
+		int32_t value;        // rssi, freq, band
+		struct {
+			uint64_t mac;     // big-endian 48-bit address, masked
+			uint64_t mask;
+		};
+		uint8_t uas[ODID_ID_SIZE];
+	};
+};
+
+struct rule {
+	bool drop;
+	uint8_t first;            // into predicates
+	uint8_t count;
+	uint32_t hits;
+	char text[RULE_TEXT_SIZE];
+};
+
+/* What the predicates look at, worked out once per frame. */
+struct frame_view {
+	int32_t rssi;
+	int32_t freq;
+	int32_t band;
+	uint64_t mac;
+	const uint8_t *pack;
+	size_t pack_len;
+};
+
+BUILD_ASSERT(CONFIG_RID_FILTER_MAX_PREDICATES <= UINT8_MAX, "predicate indices are 8 bit");
+
+static K_MUTEX_DEFINE(filter_lock);
+static struct rule rules[CONFIG_RID_FILTER_MAX_RULES];
+static struct predicate predicates[CONFIG_RID_FILTER_MAX_PREDICATES];
+static int rule_count;
+static int predicate_count;
+static struct rid_filter_stats stats;
+
+/* ---- parsing ---- */
+
+static int parse_int(const char *s, const char *end, int32_t min, int32_t max, int32_t *out)
+{
+	bool negative = s < end && *s == '-';
+	int64_t value = 0;
+
+	if (negative) {
+		s++;
+	}
+	if (s == end) {
+		return -EINVAL;
+	}
+	for (; s < end; s++) {
+		if (*s < '0' || *s > '9') {
+			return -EINVAL;
+		}
+		value = value * 10 + (*s - '0');
+		if (value > (int64_t)INT32_MAX) {
+			return -EINVAL;
+		}
+	}
+	value = negative ? -value : value;
+	if (value < min || value > max) {
+		return -EINVAL;
+	}
+	*out = value;
+
+	return 0;
+}
+
+static int hex_digit(char c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	c |= 0x20;
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+
+	return -1;
+}
+
+/* xx:xx:xx[...][/bits]; without /bits, the bytes given are the prefix. */
+static int parse_mac(const char *s, const char *end, struct predicate *p)
+{
+	int bits = 0;
+	const char *slash = memchr(s, '/', end - s);
+
+	p->mac = 0;
+	for (const char *q = s; q < (slash ? slash : end); ) {
+		int hi = q + 1 < end ? hex_digit(q[0]) : -1;
+		int lo = q + 1 < end ? hex_digit(q[1]) : -1;
+
+		if (hi < 0 || lo < 0 || bits == 48) {
+			return -EINVAL;
+		}
+		p->mac |= (uint64_t)(hi << 4 | lo) << (40 - bits);
+		bits += 8;
+		q += 2;
+		if (q < end && *q == ':') {
+			q++;
+		}
+	}
+	if (slash != NULL) {
+		int32_t prefix;
+
+		if (parse_int(slash + 1, end, 1, bits, &prefix) < 0) {
+			return -EINVAL;
+		}
+		bits = prefix;
+	}
+	if (bits == 0) {
+		return -EINVAL;
+	}
+	p->mask = ~0ULL << (48 - bits) & 0xFFFFFFFFFFFFULL;
+	p->mac &= p->mask;
+
+	return 0;
+}
+
+static int parse_predicate(const char *tok, size_t len, struct predicate *p)
+{
+	static const struct {
+		const char *name;
+		enum op op;
+	} ops[] = {
+		// two-character operators first, so "<=" is not taken for "<"
+		{ "!=", OP_NE }, { "<=", OP_LE }, { ">=", OP_GE },
+		{ "=", OP_EQ }, { "<", OP_LT }, { ">", OP_GT },
+	};
+	static const char *const fields[] = {
+		[FIELD_RSSI] = "rssi",
+		[FIELD_FREQ] = "freq",
+		[FIELD_BAND] = "band",
+		[FIELD_MAC] = "mac",
+		[FIELD_UAS] = "uas",
+	};
+	const char *end = tok + len;
+	const char *value = NULL;
+	size_t name_len = 0;
+
+	while (name_len < len && strchr("!=<>", tok[name_len]) == NULL) {
+		name_len++;
+	}
+	for (size_t i = 0; i < ARRAY_SIZE(ops); i++) {
+		size_t op_len = strlen(ops[i].name);
+
+		if (name_len + op_len <= len && memcmp(tok + name_len, ops[i].name, op_len) == 0) {
+			p->op = ops[i].op;
+			value = tok + name_len + op_len;
+			break;
+		}
+	}
+	if (value == NULL || value == end) {
+		return -EINVAL;
+	}
+
+	p->field = UINT8_MAX;
+	for (size_t f = 0; f < ARRAY_SIZE(fields); f++) {
+		if (rid_token_is(tok, name_len, fields[f])) {
+			p->field = f;
+		}
+	}
+
+	bool equality = p->op == OP_EQ || p->op == OP_NE;
+
+	switch (p->field) {
+	case FIELD_RSSI:
+		return parse_int(value, end, -128, 127, &p->value);
+	case FIELD_FREQ:
+		return parse_int(value, end, 0, UINT16_MAX, &p->value);
+	case FIELD_BAND:
+		if (!equality || parse_int(value, end, 2, 6, &p->value) < 0 ||
+		    p->value == 3 || p->value == 4) {
+			return -EINVAL;
+		}
+		return 0;
+	case FIELD_MAC:
+		return equality ? parse_mac(value, end, p) : -EINVAL;
+	case FIELD_UAS: {
+		size_t id_len = end - value;
+		bool prefix = value[id_len - 1] == '*';
+
+		id_len -= prefix;
+		if (!equality || id_len > ODID_ID_SIZE || (prefix && id_len == 0)) {
+			return -EINVAL;
+		}
+		// IDs are NUL padded, so a whole ID compares the padding too
+		memset(p->uas, 0, sizeof(p->uas));
+		memcpy(p->uas, value, id_len);
+		p->len = prefix ? id_len : ODID_ID_SIZE;
+		return 0;
+	}
+	default:
+		return -EINVAL;
+	}
+}
+
+static int add_rule(struct rid_cursor *c)
+{
+	const char *line = c->p;
+	const char *tok;
+	size_t len;
+	int first = predicate_count;
+
+	if (rule_count >= CONFIG_RID_FILTER_MAX_RULES) {
+		return -ENOMEM;
+	}
+
+	struct rule *r = &rules[rule_count];
+
+	rid_next_token(c, &tok, &len);
+	if (rid_token_is(tok, len, "drop")) {
+		r->drop = true;
+	} else if (rid_token_is(tok, len, "accept")) {
+		r->drop = false;
+	} else {
+		return -EINVAL;
+	}
+
+	while (rid_next_token(c, &tok, &len)) {
+		if (predicate_count >= CONFIG_RID_FILTER_MAX_PREDICATES) {
+			predicate_count = first;
+			return -ENOMEM;
+		}
+
+		int err = parse_predicate(tok, len, &predicates[predicate_count]);
+
+		if (err < 0) {
+			predicate_count = first;
+			return err;
+		}
+		predicate_count++;
+	}
+
+	r->first = first;
+	r->count = predicate_count - first;
+	r->hits = 0;
+	while (line < c->end && (*line == ' ' || *line == '\t')) {
+		line++;
+	}
+	len = MIN((size_t)(c->end - line), sizeof(r->text) - 1);
+	memcpy(r->text, line, len);
+	r->text[len] = '\0';
+	rule_count++;
+
+	return 0;
+}
+
+int rid_filter_add(const char *line)
+{
+	struct rid_cursor c = { line, line + strlen(line), NULL };
+	int err = 0;
+
+	k_mutex_lock(&filter_lock, K_FOREVER);
+	if (rid_content_line(&c)) {
+		err = add_rule(&c);
+	}
+	stats.rules = rule_count;
+	stats.predicates = predicate_count;
+	k_mutex_unlock(&filter_lock);
+
+	return err;
+}
+
+int rid_filter_load(const char *text, size_t len)
+{
+	const char *end = text + len;
+	int added = 0;
+
+	k_mutex_lock(&filter_lock, K_FOREVER);
+	for (const char *p = text; p < end; ) {
+		const char *eol = p;
+
+		while (eol < end && *eol != '\n' && *eol != ';') {
+			eol++;
+		}
+
+		struct rid_cursor c = { p, eol, NULL };
+
+		if (rid_content_line(&c)) {
+			int err = add_rule(&c);
+
+			if (err < 0) {
+				LOG_ERR("filter rule %d: %s", added + 1,
+					err == -ENOMEM ? "no room" : "invalid");
+				added = err;
+				break;
+			}
+			added++;
+		}
+		p = eol < end ? eol + 1 : end;
+	}
+	stats.rules = rule_count;
+	stats.predicates = predicate_count;
+	k_mutex_unlock(&filter_lock);
+
+	return added;
+}
+
+void rid_filter_clear(void)
+{
+	k_mutex_lock(&filter_lock, K_FOREVER);
+	rule_count = 0;
+	predicate_count = 0;
+	stats.rules = 0;
+	stats.predicates = 0;
+	k_mutex_unlock(&filter_lock);
+}
+
+int rid_filter_init(void)
+{
+	static const char builtin[] = CONFIG_RID_FILTER_RULES;
+	int added;
+
+	rid_filter_clear();
+	added = rid_filter_load(builtin, sizeof(builtin) - 1);
+	if (added > 0) {
+		LOG_INF("%d filter rules loaded", added);
+	}
+
+	return MIN(added, 0);
+}
+
+/* ---- evaluation ---- */
+
+static bool compare(enum op op, int32_t a, int32_t b)
+{
+	switch (op) {
+	case OP_EQ:
+		return a == b;
+	case OP_NE:
+		return a != b;
+	case OP_LT:
+		return a < b;
+	case OP_LE:
+		return a <= b;
+	case OP_GT:
+		return a > b;
+	case OP_GE:
+		return a >= b;
+	}
+
+	return false;
+}
+
+static bool uas_in_pack(const struct predicate *p, const struct frame_view *v)
+{
+	size_t count = v->pack_len >= ODID_PACK_HDR_SIZE ? v->pack[2] : 0;
+	const uint8_t *msg = &v->pack[ODID_PACK_HDR_SIZE];
+
+	count = MIN(count, (v->pack_len - MIN(v->pack_len, ODID_PACK_HDR_SIZE)) / ODID_MSG_SIZE);
+	for (size_t i = 0; i < count; i++, msg += ODID_MSG_SIZE) {
+		// the UAS ID follows the type byte and the ID and UA type byte
+		if (odid_msg_type_of(msg) == ODID_MSG_BASIC_ID && memcmp(&msg[2], p->uas, p->len) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool holds(const struct predicate *p, const struct frame_view *v)
+{
+	switch (p->field) {
+	case FIELD_RSSI:
+		return compare(p->op, v->rssi, p->value);
+	case FIELD_FREQ:
+		return compare(p->op, v->freq, p->value);
+	case FIELD_BAND:
+		return compare(p->op, v->band, p->value);
+	case FIELD_MAC:
+		return ((v->mac & p->mask) == p->mac) == (p->op == OP_EQ);
+	case FIELD_UAS:
+		return uas_in_pack(p, v) == (p->op == OP_EQ);
+	}
+
+	return false;
+}
+
+static int32_t band_of(int32_t freq)
+{
+	return freq < 3000 ? 2 : freq < 5925 ? 5 : 6;
+}
+
+bool rid_filter_frame(const struct wifi_raw_scan_result *raw, const uint8_t *pack, size_t pack_len)
+{
+	struct frame_view v = {
+		.rssi = raw->rssi,
+		.freq = raw->frequency,
+		.band = band_of(raw->frequency),
+		.mac = sys_get_be48(raw->data + 10),
+		.pack = pack,
+		.pack_len = pack_len,
+	};
+	bool pass = true;
+	bool matched = false;
+
+	k_mutex_lock(&filter_lock, K_FOREVER);
+	stats.frames++;
+	for (int r = 0; r < rule_count && !matched; r++) {
+		const struct predicate *p = &predicates[rules[r].first];
+		const struct predicate *end = p + rules[r].count;
+
+		while (p < end && holds(p, &v)) {
+			p++;
+		}
+		if (p == end) {
+			matched = true;
+			pass = !rules[r].drop;
+			rules[r].hits++;
+		}
+	}
+	if (!matched) {
+		stats.unmatched++;
+	}
+	if (!pass) {
+		stats.dropped++;
+	}
+	k_mutex_unlock(&filter_lock);
+
+	return pass;
+}
+
+void rid_filter_foreach(void (*cb)(const struct rid_filter_rule_info *rule, void *user), void *user)
+{
+	k_mutex_lock(&filter_lock, K_FOREVER);
+	for (int r = 0; r < rule_count; r++) {
+		struct rid_filter_rule_info info = {
+			.index = r,
+			.drop = rules[r].drop,
+			.text = rules[r].text,
+			.hits = rules[r].hits,
+		};
+
+		cb(&info, user);
+	}
+	k_mutex_unlock(&filter_lock);
+}
+
+void rid_filter_get_stats(struct rid_filter_stats *out)
+{
+	k_mutex_lock(&filter_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&filter_lock);
+}
+
+void rid_filter_reset_stats(void)
+{
+	k_mutex_lock(&filter_lock, K_FOREVER);
+	for (int r = 0; r < rule_count; r++) {
+		rules[r].hits = 0;
+	}
+	stats.frames = 0;
+	stats.dropped = 0;
+	stats.unmatched = 0;
+	k_mutex_unlock(&filter_lock);
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Pre-decode Remote ID frame filter
+ *
+ * An ordered list of rules, each an action and a conjunction of predicates
+ * on the raw scan result and its message pack. Every Remote ID frame is run
+ * past the rules after the ODID element is located and before it is looked
+ * up, decoded, output or tracked; the first rule whose predicates all hold
+ * decides, and a frame no rule matches is accepted. A rule without
+ * predicates matches every frame, so a final "drop" turns the list into an
+ * allow list.
+ *
+ * Rules are text, one per line or separated by ';' ('#' starts a comment):
+ *
+ *   <accept|drop> [<field><op><value> ...]
+ *
+ *   rssi   dBm                      = != < <= > >=
+ *   freq   MHz                      = != < <= > >=
+ *   band   2, 5 or 6 (GHz)          = !=
+ *   mac    xx:xx:xx[:xx:xx:xx][/bits], transmitter address prefix   = !=
+ *   uas    UAS ID of a Basic ID message, a trailing '*' matches a prefix   = !=
+ *
+ * For example "accept mac=60:60:1f/24 rssi>-80; accept uas=1581F5*; drop".
+ * Predicates are parsed into a flat table once, so a frame costs a few
+ * integer compares per predicate; uas walks the pack for Basic ID messages.
+ */
+
+#ifndef RID_FILTER_H_
+#define RID_FILTER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/net/wifi_mgmt.h>
+
+struct rid_filter_rule_info {
+	uint8_t index;
+	bool drop;
+	const char *text;
+	uint32_t hits;
+};
+
+struct rid_filter_stats {
+	uint32_t rules;
+	uint32_t predicates;
+	uint32_t frames;        // frames run past the rules
+	uint32_t dropped;
+	uint32_t unmatched;     // accepted because no rule matched
+};
+
+#if defined(CONFIG_RID_FILTER)
+
+/* Load the rules built in with CONFIG_RID_FILTER_RULES. */
+int rid_filter_init(void);
+
+/* Append one rule. Returns -EINVAL if it does not parse or -ENOMEM if the
+ * rule or predicate table is full.
+ */
+int rid_filter_add(const char *line);
+
+/* Append every rule of text. Returns the number of rules added or the first error. */
+int rid_filter_load(const char *text, size_t len);
+
+void rid_filter_clear(void);
+
+/* Whether to go on with raw, whose message pack of pack_len bytes is at pack. */
+bool rid_filter_frame(const struct wifi_raw_scan_result *raw, const uint8_t *pack, size_t pack_len);
+
+/* Call cb for every rule in order, with the rules locked. */
+void rid_filter_foreach(void (*cb)(const struct rid_filter_rule_info *rule, void *user), void *user);
+
+void rid_filter_get_stats(struct rid_filter_stats *stats);
+
+/* Zero the hit counters. */
+void rid_filter_reset_stats(void);
+
+#else
+
+static inline int rid_filter_init(void) { return 0; }
+static inline bool rid_filter_frame(const struct wifi_raw_scan_result *raw, const uint8_t *pack,
+				    size_t pack_len)
+{
+	return true;
+}
+
+#endif /* CONFIG_RID_FILTER */
+
+#endif /* RID_FILTER_H_ */
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Fixed-point geometry on ODID positions
+ *
+ * Positions stay in the units of the ODID messages, latitude and longitude
+ * in 1e-7 degrees. Over the distances a scanner hears, the earth is flat
+ * enough that a longitude difference times cos(latitude) is in the units of
+ * latitude, so no floating point is needed. The values a Location/Vector
+ * message carries for an unknown altitude, speed or direction are here too.
+ */
+
+#ifndef RID_GEO_H_
+#define RID_GEO_H_
+
+#include <stdint.h>
+
+// 1e-7 degrees of latitude per decimetre: 1e7 / 111195 m per degree, / 10
+#define RID_GEO_E7_PER_DM_X1000   8993
+// centimetres per 1e-7 degrees of latitude, Q16
+#define RID_GEO_CM_PER_E7_Q16     72873
+
+// what the decoded Location/Vector message holds when a value is unknown
+#define RID_GEO_ALTITUDE_NONE     (-10000)  // decimetres, ODID's -1000 m
+#define RID_GEO_ALTITUDE_UNKNOWN  (-9990)   // any altitude below this is unknown
+#define RID_GEO_SPEED_UNKNOWN     25500     // cm/s, the 255 step with the 0.75 m/s multiplier
+#define RID_GEO_VSPEED_UNKNOWN    6300      // cm/s, 63 m/s either way
+#define RID_GEO_DIRECTION_UNKNOWN 361       // degrees
+
+/* cos(latitude) in Q15 with Bhaskara's approximation, to within 0.002. */
+static inline int32_t rid_geo_cos_q15(int32_t lat)
+{
+	int64_t d = lat / 10000;  // millidegrees
+	int64_t half_turn2 = 180000LL * 180000LL;
+
+	return (int32_t)(((half_turn2 - 4 * d * d) << 15) / (half_turn2 + d * d));
+}
+
+/* sin(degrees) in Q15, with the same approximation. */
+static inline int32_t rid_geo_sin_q15(int32_t deg)
+{
+	int32_t sign = 1;
+
+	deg %= 360;
+	if (deg >= 180) {
+		deg -= 180;
+		sign = -1;
+	}
+
+	int32_t p = deg * (180 - deg);
+
+	return sign * (4 * p * 32768) / (40500 - p);
+}
+
+#endif /* RID_GEO_H_ */
@@ -0,0 +1,625 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "rid_geo.h"
+#include "rid_geofence.h"
+#include "rid_parse.h"
+#include "rid_stats.h"
+
+LOG_MODULE_REGISTER(rid_geofence, CONFIG_LOG_DEFAULT_LEVEL);
+
+#if defined(RID_GEOFENCE_HAVE_FILE)
+// zone definitions embedded at build time from CONFIG_RID_GEOFENCE_FILE
+static const char builtin_zones[] = {
+#include "rid_geofence_zones.inc"
+};
+#endif
+
+#define NIL           0xFFFF
+#define CELL_SHIFT    CONFIG_RID_GEOFENCE_CELL_SHIFT
+
+#define LAT_MAX_E7    900000000
+#define LON_MAX_E7    1800000000
+
+BUILD_ASSERT(CONFIG_RID_GEOFENCE_MAX_ZONES < NIL, "zone indices are 16 bit");
+BUILD_ASSERT(CONFIG_RID_GEOFENCE_GRID_ENTRIES < NIL, "grid entry indices are 16 bit");
+BUILD_ASSERT(CONFIG_RID_GEOFENCE_MAX_VERTICES < NIL, "vertex indices are 16 bit");
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_RID_GEOFENCE_GRID_BUCKETS), "bucket count must be a power of two");
+// +-180 degrees >> 17 still fits the 16-bit cell coordinates
+BUILD_ASSERT(CELL_SHIFT >= 17, "cells smaller than 2^17 overflow the cell coordinates");
+
+enum zone_shape {
+	SHAPE_CYLINDER,
+	SHAPE_POLYGON,
+};
+
+struct zone {
+	uint16_t id;
+	uint8_t shape;
+	bool restricted;
+	int32_t floor;            // decimetres
+	int32_t ceiling;
+	int32_t min_lat;          // bounding box, 1e-7 degrees
+	int32_t max_lat;
+	int32_t min_lon;
+	int32_t max_lon;
+	union {
+		struct {
+			int32_t lat;
+			int32_t lon;
+			int32_t radius;   // 1e-7 degrees of latitude
+			int32_t cos_q15;  // cos(latitude), scales longitude differences to latitude units
+			uint32_t radius_m;
+		} cylinder;
+		struct {
+			uint16_t first;   // index into vertices
+			uint16_t count;
+		} polygon;
+	};
+};
+
+struct vertex {
+	int32_t lat;
+	int32_t lon;
+};
+
+/* One zone overlapping one grid cell, chained per hash bucket. */
+struct cell_entry {
+	int16_t x;                // latitude >> CELL_SHIFT
+	int16_t y;                // longitude >> CELL_SHIFT
+	uint16_t zone;
+	uint16_t next;
+};
+
+static struct zone zones[CONFIG_RID_GEOFENCE_MAX_ZONES];
+static struct vertex vertices[CONFIG_RID_GEOFENCE_MAX_VERTICES];
+static struct cell_entry entries[CONFIG_RID_GEOFENCE_GRID_ENTRIES];
+static uint16_t buckets[CONFIG_RID_GEOFENCE_GRID_BUCKETS];
+static uint16_t wide[CONFIG_RID_GEOFENCE_MAX_ZONES];
+
+static uint16_t zone_count;
+static uint16_t vertex_count;
+static uint16_t entry_count;
+static uint16_t wide_count;
+static uint16_t generation = 1;
+
+static rid_geofence_event_cb event_cb;
+static struct rid_geofence_stats stats;
+
+static K_MUTEX_DEFINE(geofence_lock);
+
+static uint32_t bucket_of(int16_t x, int16_t y)
+{
+	return ((uint16_t)x * 2654435761U ^ (uint16_t)y * 2246822519U) &
+	       (CONFIG_RID_GEOFENCE_GRID_BUCKETS - 1);
+}
+
+/* ---- parsing ---- */
+
+/* Decimal number scaled by 10^decimals, e.g. "-71.094" with 7 decimals is -710940000. */
+static int parse_fixed(struct rid_cursor *c, int decimals, int64_t limit, int32_t *out)
+{
+	const char *tok;
+	size_t len;
+	size_t i = 0;
+	bool negative = false;
+	int64_t value = 0;
+	int frac = -1;  // digits seen after the point, -1 before it
+
+	if (!rid_next_token(c, &tok, &len)) {
+		return -EINVAL;
+	}
+	if (tok[0] == '-' || tok[0] == '+') {
+		negative = tok[0] == '-';
+		i++;
+	}
+	if (i == len) {
+		return -EINVAL;
+	}
+	for (; i < len; i++) {
+		if (tok[i] == '.' && frac < 0) {
+			frac = 0;
+		} else if (tok[i] >= '0' && tok[i] <= '9') {
+			if (frac >= decimals) {
+				continue;  // finer than the representation, truncate
+			}
+			value = value * 10 + (tok[i] - '0');
+			if (frac >= 0) {
+				frac++;
+			}
+			if (value > limit * 10) {
+				return -EINVAL;
+			}
+		} else {
+			return -EINVAL;
+		}
+	}
+	for (frac = MAX(frac, 0); frac < decimals; frac++) {
+		value *= 10;
+	}
+	if (value > limit) {
+		return -EINVAL;
+	}
+	*out = negative ? -value : value;
+
+	return 0;
+}
+
+/* Floor or ceiling in metres, or '-' for open. */
+static int parse_limit(struct rid_cursor *c, int32_t open, int32_t *out)
+{
+	struct rid_cursor peek = *c;
+	const char *tok;
+	size_t len;
+
+	if (rid_next_token(&peek, &tok, &len) && rid_token_is(tok, len, "-")) {
+		*c = peek;
+		*out = open;
+		return 0;
+	}
+
+	return parse_fixed(c, 1, 100000, out);
+}
+
+static int parse_position(struct rid_cursor *c, int32_t *lat, int32_t *lon)
+{
+	if (parse_fixed(c, 7, LAT_MAX_E7, lat) < 0 || parse_fixed(c, 7, LON_MAX_E7, lon) < 0) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int parse_zone(struct rid_cursor *c, struct zone *z)
+{
+	const char *tok;
+	size_t len;
+	int32_t id;
+	bool polygon;
+
+	if (!rid_next_token(c, &tok, &len)) {
+		return -EINVAL;
+	}
+	if (rid_token_is(tok, len, "cylinder")) {
+		polygon = false;
+	} else if (rid_token_is(tok, len, "polygon")) {
+		polygon = true;
+	} else {
+		return -EINVAL;
+	}
+
+	if (parse_fixed(c, 0, UINT16_MAX, &id) < 0 || id < 0 || !rid_next_token(c, &tok, &len)) {
+		return -EINVAL;
+	}
+	z->id = id;
+	if (rid_token_is(tok, len, "restricted")) {
+		z->restricted = true;
+	} else if (rid_token_is(tok, len, "monitored")) {
+		z->restricted = false;
+	} else {
+		return -EINVAL;
+	}
+
+	if (!polygon) {
+		int32_t radius_dm;
+
+		z->shape = SHAPE_CYLINDER;
+		if (parse_position(c, &z->cylinder.lat, &z->cylinder.lon) < 0 ||
+		    parse_fixed(c, 1, 1000000, &radius_dm) < 0 || radius_dm <= 0) {
+			return -EINVAL;
+		}
+		z->cylinder.radius_m = radius_dm / 10;
+		z->cylinder.radius = (int64_t)radius_dm * RID_GEO_E7_PER_DM_X1000 / 1000;
+		z->cylinder.cos_q15 = MAX(rid_geo_cos_q15(z->cylinder.lat), 1);
+	}
+
+	if (parse_limit(c, INT32_MIN, &z->floor) < 0 || parse_limit(c, INT32_MAX, &z->ceiling) < 0 ||
+	    z->floor > z->ceiling) {
+		return -EINVAL;
+	}
+
+	if (polygon) {
+		z->shape = SHAPE_POLYGON;
+		z->polygon.first = vertex_count;
+		z->polygon.count = 0;
+		for (struct rid_cursor peek = *c; rid_next_token(&peek, &tok, &len); peek = *c) {
+			if (z->polygon.first + z->polygon.count >= CONFIG_RID_GEOFENCE_MAX_VERTICES) {
+				return -ENOMEM;
+			}
+
+			struct vertex *v = &vertices[z->polygon.first + z->polygon.count];
+
+			if (parse_position(c, &v->lat, &v->lon) < 0) {
+				return -EINVAL;
+			}
+			z->polygon.count++;
+		}
+		if (z->polygon.count < 3) {
+			return -EINVAL;
+		}
+	} else if (rid_next_token(c, &tok, &len)) {
+		return -EINVAL;  // trailing garbage
+	}
+
+	return 0;
+}
+
+/* ---- index ---- */
+
+static void bounding_box(struct zone *z)
+{
+	if (z->shape == SHAPE_CYLINDER) {
+		int64_t dlon = (int64_t)z->cylinder.radius * 32768 / z->cylinder.cos_q15;
+
+		z->min_lat = z->cylinder.lat - z->cylinder.radius;
+		z->max_lat = z->cylinder.lat + z->cylinder.radius;
+		z->min_lon = (int32_t)MAX(z->cylinder.lon - dlon, -(int64_t)LON_MAX_E7 - 1);
+		z->max_lon = (int32_t)MIN(z->cylinder.lon + dlon, (int64_t)LON_MAX_E7 + 1);
+		return;
+	}
+
+	const struct vertex *v = &vertices[z->polygon.first];
+
+	z->min_lat = z->max_lat = v[0].lat;
+	z->min_lon = z->max_lon = v[0].lon;
+	for (int i = 1; i < z->polygon.count; i++) {
+		z->min_lat = MIN(z->min_lat, v[i].lat);
+		z->max_lat = MAX(z->max_lat, v[i].lat);
+		z->min_lon = MIN(z->min_lon, v[i].lon);
+		z->max_lon = MAX(z->max_lon, v[i].lon);
+	}
+}
+
+/* Put zone idx into every cell its bounding box overlaps, or on the wide list if that is too many. */
+static int index_zone(uint16_t idx)
+{
+	const struct zone *z = &zones[idx];
+	int32_t x0 = z->min_lat >> CELL_SHIFT;
+	int32_t x1 = z->max_lat >> CELL_SHIFT;
+	int32_t y0 = z->min_lon >> CELL_SHIFT;
+	int32_t y1 = z->max_lon >> CELL_SHIFT;
+	uint32_t cells = (x1 - x0 + 1) * (y1 - y0 + 1);
+
+	if (cells > CONFIG_RID_GEOFENCE_MAX_CELLS_PER_ZONE) {
+		wide[wide_count++] = idx;
+		return 0;
+	}
+	if (entry_count + cells > CONFIG_RID_GEOFENCE_GRID_ENTRIES) {
+		return -ENOMEM;
+	}
+
+	for (int32_t x = x0; x <= x1; x++) {
+		for (int32_t y = y0; y <= y1; y++) {
+			struct cell_entry *e = &entries[entry_count];
+			uint32_t b = bucket_of(x, y);
+
+			e->x = x;
+			e->y = y;
+			e->zone = idx;
+			e->next = buckets[b];
+			buckets[b] = entry_count++;
+		}
+	}
+
+	return 0;
+}
+
+static int add_zone(struct rid_cursor *c)
+{
+	if (zone_count >= CONFIG_RID_GEOFENCE_MAX_ZONES) {
+		return -ENOMEM;
+	}
+
+	struct zone *z = &zones[zone_count];
+	int err;
+
+	memset(z, 0, sizeof(*z));
+	err = parse_zone(c, z);
+	if (err < 0) {
+		return err;
+	}
+
+	bounding_box(z);
+	// zones across the antimeridian or wider than 180 degrees are not supported
+	if (z->min_lat < -LAT_MAX_E7 || z->max_lat > LAT_MAX_E7 ||
+	    z->min_lon < -LON_MAX_E7 || z->max_lon > LON_MAX_E7 ||
+	    (int64_t)z->max_lon - z->min_lon > LON_MAX_E7) {
+		return -EINVAL;
+	}
+
+	err = index_zone(zone_count);
+	if (err < 0) {
+		return err;
+	}
+
+	if (z->shape == SHAPE_POLYGON) {
+		vertex_count += z->polygon.count;
+	}
+	zone_count++;
+
+	return 0;
+}
+
+int rid_geofence_add(const char *line)
+{
+	struct rid_cursor c = { line, line + strlen(line), "," };
+	int err = 0;
+
+	k_mutex_lock(&geofence_lock, K_FOREVER);
+	if (rid_content_line(&c)) {
+		err = add_zone(&c);
+	}
+	k_mutex_unlock(&geofence_lock);
+
+	return err;
+}
+
+int rid_geofence_load(const char *text, size_t len)
+{
+	const char *end = text + len;
+	int added = 0;
+	int line_no = 1;
+
+	k_mutex_lock(&geofence_lock, K_FOREVER);
+	for (const char *p = text; p < end; line_no++) {
+		const char *eol = memchr(p, '\n', end - p);
+		struct rid_cursor c = { p, eol ? eol : end, "," };
+
+		if (rid_content_line(&c)) {
+			int err = add_zone(&c);
+
+			if (err < 0) {
+				LOG_ERR("zone line %d: %s", line_no, err == -ENOMEM ? "no room" : "invalid");
+				added = err;
+				break;
+			}
+			added++;
+		}
+		p = eol ? eol + 1 : end;
+	}
+	k_mutex_unlock(&geofence_lock);
+
+	return added;
+}
+
+void rid_geofence_clear(void)
+{
+	k_mutex_lock(&geofence_lock, K_FOREVER);
+
+	zone_count = 0;
+	vertex_count = 0;
+	entry_count = 0;
+	wide_count = 0;
+	for (int i = 0; i < CONFIG_RID_GEOFENCE_GRID_BUCKETS; i++) {
+		buckets[i] = NIL;
+	}
+	// every track's membership now refers to zones that are gone
+	generation = generation == UINT16_MAX ? 1 : generation + 1;
+
+	k_mutex_unlock(&geofence_lock);
+}
+
+int rid_geofence_init(rid_geofence_event_cb cb)
+{
+	event_cb = cb;
+	rid_geofence_clear();
+
+#if defined(RID_GEOFENCE_HAVE_FILE)
+	int added = rid_geofence_load(builtin_zones, sizeof(builtin_zones));
+
+	if (added < 0) {
+		return added;
+	}
+	LOG_INF("%d geofence zones loaded", added);
+#endif
+
+	return 0;
+}
+
+/* ---- tests ---- */
+
+/* Even-odd ray casting towards east, on coordinates relative to the point. The bounding box
+ * check before it keeps every difference below 2^31, so the cross products fit in 64 bits.
+ */
+static bool in_polygon(const struct zone *z, int32_t lat, int32_t lon)
+{
+	const struct vertex *v = &vertices[z->polygon.first];
+	bool inside = false;
+
+	for (int i = 0, j = z->polygon.count - 1; i < z->polygon.count; j = i++) {
+		int64_t lat_i = (int64_t)v[i].lat - lat;
+		int64_t lat_j = (int64_t)v[j].lat - lat;
+
+		if ((lat_i > 0) != (lat_j > 0)) {
+			int64_t lon_i = (int64_t)v[i].lon - lon;
+			int64_t lon_j = (int64_t)v[j].lon - lon;
+			// the edge crosses the point's parallel east of it if this has the sign of lat_j - lat_i
+			int64_t cross = lon_i * lat_j - lon_j * lat_i;
+
+			if ((cross > 0) == (lat_j > lat_i)) {
+				inside = !inside;
+			}
+		}
+	}
+
+	return inside;
+}
+
+static bool in_cylinder(const struct zone *z, int32_t lat, int32_t lon)
+{
+	int64_t dlat = (int64_t)lat - z->cylinder.lat;
+	int64_t dlon = ((int64_t)lon - z->cylinder.lon) * z->cylinder.cos_q15 >> 15;
+
+	return dlat * dlat + dlon * dlon <= (int64_t)z->cylinder.radius * z->cylinder.radius;
+}
+
+static bool in_zone(const struct zone *z, int32_t lat, int32_t lon, int32_t alt)
+{
+	if (lat < z->min_lat || lat > z->max_lat || lon < z->min_lon || lon > z->max_lon) {
+		return false;
+	}
+	if (alt >= RID_GEO_ALTITUDE_UNKNOWN && (alt < z->floor || alt > z->ceiling)) {
+		return false;
+	}
+
+	stats.candidates++;
+
+	return z->shape == SHAPE_CYLINDER ? in_cylinder(z, lat, lon) : in_polygon(z, lat, lon);
+}
+
+static bool contains(const uint16_t *set, int count, uint16_t idx)
+{
+	for (int i = 0; i < count; i++) {
+		if (set[i] == idx) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void emit(enum rid_geofence_event_type type, uint16_t idx, struct rid_geofence_event *event)
+{
+	event->type = type;
+	event->zone_id = zones[idx].id;
+	switch (type) {
+	case RID_GEOFENCE_ENTER:
+		stats.enters++;
+		break;
+	case RID_GEOFENCE_EXIT:
+		stats.exits++;
+		break;
+	case RID_GEOFENCE_BREACH:
+		stats.breaches++;
+		break;
+	}
+	if (event_cb != NULL) {
+		event_cb(event);
+	}
+}
+
+void rid_geofence_check(struct rid_geofence_state *state, enum rid_geofence_subject subject,
+			const uint8_t mac[6], int32_t latitude, int32_t longitude,
+			int32_t altitude, uint32_t timestamp)
+{
+	uint16_t inside[CONFIG_RID_GEOFENCE_MAX_INSIDE];
+	int count = 0;
+
+	if (latitude == 0 && longitude == 0) {
+		return;
+	}
+
+	k_mutex_lock(&geofence_lock, K_FOREVER);
+
+	uint32_t start = rid_stats_start();
+	int16_t x = latitude >> CELL_SHIFT;
+	int16_t y = longitude >> CELL_SHIFT;
+
+	stats.checks++;
+	if (state->generation != generation) {
+		state->generation = generation;
+		state->count = 0;
+	}
+
+	for (uint16_t e = buckets[bucket_of(x, y)]; e != NIL && count < (int)ARRAY_SIZE(inside); e = entries[e].next) {
+		if (entries[e].x == x && entries[e].y == y &&
+		    in_zone(&zones[entries[e].zone], latitude, longitude, altitude)) {
+			inside[count++] = entries[e].zone;
+		}
+	}
+	for (int i = 0; i < wide_count && count < (int)ARRAY_SIZE(inside); i++) {
+		if (in_zone(&zones[wide[i]], latitude, longitude, altitude)) {
+			inside[count++] = wide[i];
+		}
+	}
+	rid_stats_stop(RID_STAGE_GEOFENCE, start);
+
+	struct rid_geofence_event event = {
+		.subject = subject,
+		.mac = mac,
+		.latitude = latitude,
+		.longitude = longitude,
+		.altitude = altitude,
+		.timestamp = timestamp,
+	};
+
+	for (int i = 0; i < state->count; i++) {
+		if (!contains(inside, count, state->inside[i])) {
+			emit(RID_GEOFENCE_EXIT, state->inside[i], &event);
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		if (!contains(state->inside, state->count, inside[i])) {
+			emit(zones[inside[i]].restricted ? RID_GEOFENCE_BREACH : RID_GEOFENCE_ENTER,
+			     inside[i], &event);
+		}
+	}
+	memcpy(state->inside, inside, count * sizeof(inside[0]));
+	state->count = count;
+
+	k_mutex_unlock(&geofence_lock);
+}
+
+void rid_geofence_foreach(void (*cb)(const struct rid_geofence_zone_info *zone, void *user),
+			  void *user)
+{
+	k_mutex_lock(&geofence_lock, K_FOREVER);
+
+	for (int i = 0; i < zone_count; i++) {
+		const struct zone *z = &zones[i];
+		struct rid_geofence_zone_info info = {
+			.id = z->id,
+			.restricted = z->restricted,
+			.polygon = z->shape == SHAPE_POLYGON,
+			.floor = z->floor,
+			.ceiling = z->ceiling,
+		};
+
+		if (z->shape == SHAPE_POLYGON) {
+			info.vertices = z->polygon.count;
+			info.latitude = vertices[z->polygon.first].lat;
+			info.longitude = vertices[z->polygon.first].lon;
+		} else {
+			info.radius = z->cylinder.radius_m;
+			info.latitude = z->cylinder.lat;
+			info.longitude = z->cylinder.lon;
+		}
+		cb(&info, user);
+	}
+
+	k_mutex_unlock(&geofence_lock);
+}
+
+void rid_geofence_get_stats(struct rid_geofence_stats *out)
+{
+	k_mutex_lock(&geofence_lock, K_FOREVER);
+	*out = stats;
+	out->zones = zone_count;
+	out->vertices = vertex_count;
+	out->cell_entries = entry_count;
+	out->wide_zones = wide_count;
+	k_mutex_unlock(&geofence_lock);
+}
+
+const char *rid_geofence_event_txt(enum rid_geofence_event_type type)
+{
+	switch (type) {
+	case RID_GEOFENCE_ENTER:
+		return "ENTER";
+	case RID_GEOFENCE_EXIT:
+		return "EXIT";
+	case RID_GEOFENCE_BREACH:
+		return "BREACH";
+	}
+
+	return "?";
+}
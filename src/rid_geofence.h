@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Geofence zones and entry/exit/breach detection
+ *
+ * Zones are vertical cylinders or polygons with a floor and a ceiling. They
+ * are indexed in a uniform grid of 2^CONFIG_RID_GEOFENCE_CELL_SHIFT x 1e-7
+ * degree cells, hashed into a fixed bucket table, so a position is only
+ * tested against the zones overlapping its cell. All tests work on the raw
+ * 1e-7 degree ODID coordinates in integer math.
+ *
+ * Zones are loaded from text, one per line ('#' starts a comment):
+ *
+ *   cylinder <id> <restricted|monitored> <lat> <lon> <radius m> <floor m> <ceiling m>
+ *   polygon  <id> <restricted|monitored> <floor m> <ceiling m> <lat> <lon> <lat> <lon> ...
+ *
+ * Latitudes and longitudes are decimal degrees. A floor or ceiling of '-'
+ * leaves that side open. Entering a restricted zone is a breach, entering a
+ * monitored zone an entry; leaving either is an exit.
+ */
+
+#ifndef RID_GEOFENCE_H_
+#define RID_GEOFENCE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum rid_geofence_subject {
+	RID_GEOFENCE_UA,        // aircraft position, from Location/Vector
+	RID_GEOFENCE_OPERATOR,  // operator position, from System
+	RID_GEOFENCE_SUBJECT_COUNT,
+};
+
+enum rid_geofence_event_type {
+	RID_GEOFENCE_ENTER = 1,
+	RID_GEOFENCE_EXIT = 2,
+	RID_GEOFENCE_BREACH = 3,
+};
+
+struct rid_geofence_state;
+
+#if defined(CONFIG_RID_GEOFENCE)
+/* Which zones one subject is inside; kept per track and owned by the geofence engine. */
+struct rid_geofence_state {
+	uint16_t generation;    // zone set the indices refer to; stale states start out empty
+	uint8_t count;
+	uint16_t inside[CONFIG_RID_GEOFENCE_MAX_INSIDE];
+};
+#endif
+
+struct rid_geofence_event {
+	enum rid_geofence_event_type type;
+	enum rid_geofence_subject subject;
+	uint16_t zone_id;
+	const uint8_t *mac;
+	int32_t latitude;       // 1e-7 degrees
+	int32_t longitude;      // 1e-7 degrees
+	int32_t altitude;       // decimetres
+	uint32_t timestamp;     // ms since boot when the frame was received
+};
+
+struct rid_geofence_stats {
+	uint32_t zones;
+	uint32_t vertices;
+	uint32_t cell_entries;  // grid entries in use
+	uint32_t wide_zones;    // zones too large for the grid, tested for every position
+	uint32_t checks;        // positions tested
+	uint32_t candidates;    // exact zone tests done for those positions
+	uint32_t enters;
+	uint32_t exits;
+	uint32_t breaches;
+};
+
+struct rid_geofence_zone_info {
+	uint16_t id;
+	bool restricted;
+	bool polygon;
+	uint16_t vertices;      // polygons only
+	uint32_t radius;        // metres, cylinders only
+	int32_t latitude;       // centre of a cylinder, first vertex of a polygon
+	int32_t longitude;
+	int32_t floor;          // decimetres, INT32_MIN if open
+	int32_t ceiling;        // decimetres, INT32_MAX if open
+};
+
+typedef void (*rid_geofence_event_cb)(const struct rid_geofence_event *event);
+
+/* Load the zones built in with CONFIG_RID_GEOFENCE_FILE, if any. */
+int rid_geofence_init(rid_geofence_event_cb cb);
+
+/* Parse and add one zone line. Returns -EINVAL if it does not parse and
+ * -ENOMEM if the zone, vertex or grid pools are full.
+ */
+int rid_geofence_add(const char *line);
+
+/* Add every line of text. Returns the number of zones added or the first error. */
+int rid_geofence_load(const char *text, size_t len);
+
+void rid_geofence_clear(void);
+
+/* Test one position of mac against the zones and report entries, exits and
+ * breaches relative to state. An altitude below -999 m counts as unknown
+ * and never leaves a zone's vertical range; latitude and longitude both 0
+ * count as no fix and are not tested.
+ */
+void rid_geofence_check(struct rid_geofence_state *state, enum rid_geofence_subject subject,
+			const uint8_t mac[6], int32_t latitude, int32_t longitude,
+			int32_t altitude, uint32_t timestamp);
+
+/* Call cb for every zone, with the zone set locked. */
+void rid_geofence_foreach(void (*cb)(const struct rid_geofence_zone_info *zone, void *user),
+			  void *user);
+
+void rid_geofence_get_stats(struct rid_geofence_stats *stats);
+
+const char *rid_geofence_event_txt(enum rid_geofence_event_type type);
+
+#endif /* RID_GEOFENCE_H_ */
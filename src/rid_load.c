@@ -0,0 +1,500 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/dummy.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/wifi_mgmt.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "odid_locate.h"
+#include "odid_synth.h"
+#include "rid_auth.h"
+#include "rid_cycles.h"
+#include "rid_load.h"
+#include "rid_ring.h"
+
+LOG_MODULE_REGISTER(rid_load, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define MAX_CHANNELS   16
+#define MAX_STEPS      16
+#define AP_PERIOD_MS   102   // the usual beacon interval of 100 TU
+#define SITE_CM        100000  // aircraft stay within 1 km of the site
+#define HISTORY        8     // beacons per aircraft still waiting for their latency
+#define AUTH_TIMESTAMP 220000000  // seconds into 2025, the same for every blob
+
+// one locally administered OUI for the whole swarm, the aircraft index in the last two bytes
+static const uint8_t swarm_oui[3] = {0x02, 0x52, 0x4C};
+
+struct drone {
+	uint16_t frequency;
+	int8_t rssi;
+	uint8_t counter;
+	uint32_t due_ms;         // next beacon, ms into the step
+	int32_t x_cm;            // east of the site
+	int32_t y_cm;            // north of the site
+	int16_t vx;              // cm/s
+	int16_t vy;
+
+	// when the latest beacons were raised, by message counter, in wall-clock us
+	uint8_t sent_counter[HISTORY];
+	uint32_t sent_us[HISTORY];
+
+	uint32_t latency_sum_us;
+	uint32_t updates;
+};
+
+static struct drone drones[CONFIG_RID_LOAD_MAX_DRONES];
+static uint16_t frequencies[MAX_CHANNELS];
+static int channel_count;
+static struct rid_load_step step;  // load thread only
+static uint32_t rand_state = CONFIG_RID_LOAD_SEED;
+
+/* Nothing is ever sent on the swarm's interface. */
+static int load_iface_send(const struct device *dev, struct net_pkt *pkt)
+{
+	return -ENOTSUP;
+}
+
+static void load_iface_init(struct net_if *iface)
+{
+	ARG_UNUSED(iface);
+}
+
+static const struct dummy_api load_iface_api = {
+	.iface_api.init = load_iface_init,
+	.send = load_iface_send,
+};
+
+// the frames come from an interface of their own, so no radio counts them as scan results
+NET_DEVICE_INIT(rid_load, "rid_load", NULL, NULL, NULL, NULL, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&load_iface_api, DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 1500);
+
+// rid_load_decoded() runs on the decoder thread; what it reads and writes
+// (the beacons in flight and the latency fields of drones[], and these)
+// is guarded by load_lock
+static K_MUTEX_DEFINE(load_lock);
+static uint32_t flying;            // aircraft of the current step
+static uint32_t updated;           // well-formed beacons that reached the track table
+static uint32_t latency_max_us;
+
+static uint32_t load_rand(void)
+{
+	// xorshift32, deterministic so runs are comparable
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+	return rand_state;
+}
+
+static int rand_between(int min, int max)
+{
+	return min + (int)(load_rand() % (uint32_t)(max - min + 1));
+}
+
+/* Parse a comma-separated list of numbers into out. Returns how many there were. */
+static int parse_list(const char *s, uint32_t *out, int max)
+{
+	int count = 0;
+
+	while (*s != '\0') {
+		char *end;
+		unsigned long value = strtoul(s, &end, 10);
+
+		if (end == s || (*end != ',' && *end != '\0') || count == max) {
+			return -EINVAL;
+		}
+		out[count++] = value;
+		s = *end == ',' ? end + 1 : end;
+	}
+
+	return count;
+}
+
+static int parse_channels(void)
+{
+	uint32_t channels[MAX_CHANNELS];
+	int count = parse_list(CONFIG_RID_LOAD_CHANNELS, channels, ARRAY_SIZE(channels));
+
+	for (int i = 0; i < count; i++) {
+		if (channels[i] >= 1 && channels[i] <= 14) {
+			frequencies[i] = channels[i] == 14 ? 2484 : 2407 + channels[i] * 5;
+		} else if (channels[i] >= 32 && channels[i] <= 177) {
+			frequencies[i] = 5000 + channels[i] * 5;
+		} else {
+			return -EINVAL;
+		}
+	}
+
+	return count > 0 ? count : -EINVAL;
+}
+
+#if CONFIG_RID_LOAD_AUTH_PAGES > 0
+// every page full, the last one included
+#define AUTH_LENGTH (ODID_AUTH_PAGE0_DATA + (CONFIG_RID_LOAD_AUTH_PAGES - 1) * ODID_AUTH_PAGE_DATA)
+
+/* Stands in for a signature: different for every aircraft and every byte of it. */
+static void auth_data(uint32_t index, uint8_t data[AUTH_LENGTH])
+{
+	for (int i = 0; i < AUTH_LENGTH; i++) {
+		data[i] = index * 31 + i * 7;
+	}
+}
+
+static void auth_page(uint32_t index, uint8_t page, uint8_t msg[ODID_MSG_SIZE])
+{
+	uint8_t data[AUTH_LENGTH];
+	struct odid_auth auth = {
+		.auth_type = 1,
+		.page = page,
+		.last_page = CONFIG_RID_LOAD_AUTH_PAGES - 1,
+		.length = AUTH_LENGTH,
+		.timestamp = AUTH_TIMESTAMP,
+		.data = page == 0 ? data : &data[ODID_AUTH_PAGE0_DATA + (page - 1) * ODID_AUTH_PAGE_DATA],
+	};
+
+	auth_data(index, data);
+	odid_encode_auth(msg, &auth);
+}
+
+#if defined(CONFIG_RID_AUTH)
+/* Whether the pages of an aircraft of the swarm came back together in order. */
+static int verify_auth(const struct rid_auth_blob *blob)
+{
+	uint8_t data[AUTH_LENGTH];
+
+	if (memcmp(blob->mac, swarm_oui, sizeof(swarm_oui)) != 0) {
+		return -ENOTSUP;
+	}
+	auth_data(sys_get_be16(&blob->mac[4]), data);
+
+	return blob->length == AUTH_LENGTH && blob->timestamp == AUTH_TIMESTAMP &&
+	       memcmp(blob->data, data, AUTH_LENGTH) == 0 ? 0 : -EBADMSG;
+}
+#endif
+#endif /* CONFIG_RID_LOAD_AUTH_PAGES > 0 */
+
+static void drone_mac(uint32_t index, uint8_t mac[6])
+{
+	memcpy(mac, swarm_oui, sizeof(swarm_oui));
+	mac[3] = 0;
+	sys_put_be16(index, &mac[4]);
+}
+
+/* Place aircraft index somewhere around the site, heading somewhere at 2 to 20 m/s. */
+static void drone_init(uint32_t index)
+{
+	struct drone *d = &drones[index];
+
+	memset(d, 0, sizeof(*d));
+	d->frequency = frequencies[index % channel_count];
+	d->rssi = rand_between(CONFIG_RID_LOAD_RSSI_MIN, CONFIG_RID_LOAD_RSSI_MAX);
+	d->counter = load_rand();
+	d->due_ms = load_rand() % (MSEC_PER_SEC / CONFIG_RID_LOAD_RATE_HZ);
+	d->x_cm = rand_between(-SITE_CM, SITE_CM);
+	d->y_cm = rand_between(-SITE_CM, SITE_CM);
+	d->vx = rand_between(-2000, 2000);
+	d->vy = rand_between(-2000, 2000);
+}
+
+/* Fly on for dt_ms, turning back at the edge of the site. */
+static void drone_move(struct drone *d, uint32_t dt_ms)
+{
+	d->x_cm += d->vx * (int32_t)dt_ms / (int32_t)MSEC_PER_SEC;
+	d->y_cm += d->vy * (int32_t)dt_ms / (int32_t)MSEC_PER_SEC;
+	if (abs(d->x_cm) > SITE_CM) {
+		d->vx = -d->vx;
+	}
+	if (abs(d->y_cm) > SITE_CM) {
+		d->vy = -d->vy;
+	}
+}
+
+static size_t drone_beacon(uint32_t index, uint8_t *buf, size_t size)
+{
+	static const uint8_t operator_id[ODID_ID_SIZE] = "FIN87ASTRDGE12K8";
+	const struct drone *d = &drones[index];
+	uint8_t uas_id[ODID_ID_SIZE] = {0};
+	uint8_t msgs[5][ODID_MSG_SIZE];
+	size_t count = 4;
+	uint8_t mac[6];
+
+	snprintf((char *)uas_id, sizeof(uas_id), "1581F5LOAD%05u", index);
+
+	struct odid_basic_id basic_id = {.id_type = 1, .ua_type = 2, .uas_id = uas_id};
+	// 1e-7 degrees are 1.1 cm north and, at 60 degrees north, 0.56 cm east
+	struct odid_location location = {
+		.status = 2,
+		.speed = (uint16_t)MAX(abs(d->vx), abs(d->vy)),
+		.latitude = 601700000 + d->y_cm * 1000 / 1113,
+		.longitude = 249400000 + d->x_cm * 1000 / 556,
+		.geodetic_altitude = 1200,
+		.height = 1000,
+		.horizontal_accuracy = 10,
+		.vertical_accuracy = 4,
+		.speed_accuracy = 3,
+		.timestamp = 0xFFFF,     // unknown, so the swarm does not set the UTC clock
+	};
+	struct odid_system system = {
+		.operator_location_type = 1,
+		.operator_latitude = 601700000,
+		.operator_longitude = 249400000,
+		.area_count = 1,
+		.ua_category = 1,
+		.ua_class = 2,
+	};
+	struct odid_operator_id op_id = {.id_type = 0, .operator_id = operator_id};
+
+	odid_encode_basic_id(msgs[0], &basic_id);
+	odid_encode_location(msgs[1], &location);
+	odid_encode_system(msgs[2], &system);
+	odid_encode_operator_id(msgs[3], &op_id);
+#if CONFIG_RID_LOAD_AUTH_PAGES > 0
+	// one page per beacon, in turn
+	auth_page(index, d->counter % CONFIG_RID_LOAD_AUTH_PAGES, msgs[count++]);
+#endif
+	drone_mac(index, mac);
+
+	return odid_synth_beacon(buf, size, mac, d->counter, msgs[0], count);
+}
+
+/* Break a well-formed beacon of len bytes in one of the ways radios and
+ * transmitters do. Returns the new length.
+ */
+static size_t malform(uint8_t *buf, size_t len)
+{
+	size_t pack_len;
+	const uint8_t *pack = odid_locate_pack(buf, len, &pack_len, NULL, NULL);
+	uint8_t *p = &buf[pack - buf];
+
+	switch (load_rand() % 3) {
+	case 0:
+		// cut off in the middle of the messages
+		return pack - buf + pack_len / 2;
+	case 1:
+		// claims more messages than it carries
+		p[2] += 1 + load_rand() % 4;
+		return len;
+	default:
+		// scrambled messages behind an intact pack header
+		for (size_t i = ODID_PACK_HDR_SIZE; i < pack_len; i++) {
+			p[i] = load_rand();
+		}
+		return len;
+	}
+}
+
+static void raise_frame(struct net_if *iface, struct wifi_raw_scan_result *raw)
+{
+	uint32_t start = k_uptime_get_32();
+
+	// the event queue copies the result, so raw can be reused right away
+	wifi_mgmt_raise_raw_scan_result_event(iface, raw);
+
+	uint32_t waited = k_uptime_get_32() - start;
+
+	step.raised++;
+	if (waited >= CONFIG_NET_MGMT_EVENT_QUEUE_TIMEOUT) {
+		step.timeouts++;  // dropped by net_mgmt
+	} else if (waited > 0) {
+		step.blocked++;
+	}
+}
+
+static void raise_drone(struct net_if *iface, uint32_t index)
+{
+	static struct wifi_raw_scan_result raw;
+	struct drone *d = &drones[index];
+	size_t len = drone_beacon(index, raw.data, sizeof(raw.data));
+	bool broken = load_rand() % 1000 < CONFIG_RID_LOAD_MALFORMED_PERMILLE;
+
+	// a malformed beacon is not waited for, should it still decode
+	k_mutex_lock(&load_lock, K_FOREVER);
+	d->sent_counter[d->counter % HISTORY] = broken ? d->counter + 1 : d->counter;
+	d->sent_us[d->counter % HISTORY] = (uint32_t)rid_wall_time_us();
+	k_mutex_unlock(&load_lock);
+	if (broken) {
+		len = malform(raw.data, len);
+		step.malformed++;
+	} else {
+		step.beacons++;
+	}
+	raw.frame_length = len;
+	raw.frequency = d->frequency;
+	raw.rssi = CLAMP(d->rssi + rand_between(-3, 3), INT8_MIN, 0);
+
+	raise_frame(iface, &raw);
+	d->counter++;
+}
+
+static void raise_ap(struct net_if *iface, uint32_t index)
+{
+	static struct wifi_raw_scan_result raw;
+	uint8_t mac[6] = {0x00, 0x11, 0x22, 0x33, 0x00, index};
+	uint8_t channel = index % 3 == 0 ? 1 : index % 3 == 1 ? 6 : 11;
+
+	raw.frame_length = odid_synth_ap_beacon(raw.data, sizeof(raw.data), mac, "HomeNetwork", channel);
+	raw.frequency = 2407 + channel * 5;
+	raw.rssi = -50 - (int8_t)(index % 40);
+
+	raise_frame(iface, &raw);
+}
+
+void rid_load_decoded(const uint8_t mac[6], uint8_t counter)
+{
+	uint32_t index = sys_get_be16(&mac[4]);
+
+	if (memcmp(mac, swarm_oui, sizeof(swarm_oui)) != 0) {
+		return;
+	}
+
+	k_mutex_lock(&load_lock, K_FOREVER);
+
+	struct drone *d = index < flying ? &drones[index] : NULL;
+
+	// not of this step, raised too long ago, or malformed on purpose
+	if (d != NULL && d->sent_counter[counter % HISTORY] == counter) {
+		uint32_t latency_us = (uint32_t)rid_wall_time_us() - d->sent_us[counter % HISTORY];
+
+		d->sent_counter[counter % HISTORY] = counter + 1;  // count it once
+		d->latency_sum_us += latency_us;
+		d->updates++;
+		updated++;
+		latency_max_us = MAX(latency_max_us, latency_us);
+	}
+
+	k_mutex_unlock(&load_lock);
+}
+
+static void run_step(struct net_if *iface, uint32_t count)
+{
+	const uint32_t period_ms = MSEC_PER_SEC / CONFIG_RID_LOAD_RATE_HZ;
+	struct rid_ring_stats before;
+	struct rid_ring_stats after;
+	uint64_t latency_sum_us = 0;
+	int64_t start = k_uptime_get();
+	uint32_t ap_due = 0;
+
+	memset(&step, 0, sizeof(step));
+	step.drones = count;
+
+	k_mutex_lock(&load_lock, K_FOREVER);
+	for (uint32_t i = 0; i < count; i++) {
+		drones[i].latency_sum_us = 0;
+		drones[i].updates = 0;
+		drones[i].due_ms %= period_ms;
+	}
+	flying = count;
+	updated = 0;
+	latency_max_us = 0;
+	k_mutex_unlock(&load_lock);
+	rid_ring_get_stats(&before);
+
+	for (uint32_t t = 0; t < CONFIG_RID_LOAD_STEP_MS; t++) {
+		if (t >= ap_due) {
+			for (uint32_t i = 0; i < CONFIG_RID_LOAD_APS; i++) {
+				raise_ap(iface, i);
+			}
+			ap_due += AP_PERIOD_MS;
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			struct drone *d = &drones[i];
+
+			if (t < d->due_ms) {
+				continue;
+			}
+			drone_move(d, period_ms);
+			raise_drone(iface, i);
+			// +-10 % jitter, as beacon timers and the medium give
+			d->due_ms += period_ms - period_ms / 10 + load_rand() % (period_ms / 5 + 1);
+		}
+		// on a fixed cadence, however long the raises blocked
+		k_sleep(K_TIMEOUT_ABS_MS(start + t + 1));
+	}
+
+	// let the event queue, the ring and the decoder catch up before counting
+	do {
+		k_sleep(K_MSEC(10));
+		rid_ring_get_stats(&after);
+	} while (after.depth > 0);
+	k_sleep(K_MSEC(100));
+	rid_ring_get_stats(&after);
+
+	uint32_t arrived = (after.pushed - before.pushed) + (after.dropped - before.dropped);
+
+	step.ring_dropped = after.dropped - before.dropped;
+	step.lost_events = step.raised > arrived ? step.raised - arrived : 0;
+
+	k_mutex_lock(&load_lock, K_FOREVER);
+	for (uint32_t i = 0; i < count; i++) {
+		if (drones[i].updates > 0) {
+			uint32_t avg_us = drones[i].latency_sum_us / drones[i].updates;
+
+			step.drones_updated++;
+			step.worst_drone_avg_us = MAX(step.worst_drone_avg_us, avg_us);
+			latency_sum_us += drones[i].latency_sum_us;
+		}
+	}
+	step.updated = updated;
+	step.latency_max_us = latency_max_us;
+	k_mutex_unlock(&load_lock);
+	step.latency_avg_us = step.updated ? latency_sum_us / step.updated : 0;
+}
+
+static void log_step(const struct rid_load_step *s)
+{
+	uint32_t lost = s->beacons - MIN(s->updated, s->beacons);
+	uint32_t lost_permille = s->beacons ? lost * 1000 / s->beacons : 0;
+
+	LOG_INF("load %u aircraft: raised %u (%u/s), beacons %u malformed %u, updated %u, "
+		"lost %u (%u.%u%%)",
+		s->drones, s->raised, s->raised * MSEC_PER_SEC / CONFIG_RID_LOAD_STEP_MS,
+		s->beacons, s->malformed, s->updated, lost, lost_permille / 10, lost_permille % 10);
+	LOG_INF("load %u aircraft: event queue blocked %u timeouts %u lost %u, ring dropped %u",
+		s->drones, s->blocked, s->timeouts, s->lost_events, s->ring_dropped);
+	LOG_INF("load %u aircraft: %u updated, latency avg %u max %u us, worst aircraft avg %u us",
+		s->drones, s->drones_updated, s->latency_avg_us, s->latency_max_us,
+		s->worst_drone_avg_us);
+}
+
+int rid_load_run(void)
+{
+	uint32_t counts[MAX_STEPS];
+	int steps = parse_list(CONFIG_RID_LOAD_DRONES, counts, ARRAY_SIZE(counts));
+	struct net_if *iface = NET_IF_GET(rid_load, 0);
+	uint32_t ready = 0;
+
+#if defined(CONFIG_RID_AUTH) && CONFIG_RID_LOAD_AUTH_PAGES > 0
+	rid_auth_set_verifier(verify_auth);
+#endif
+	channel_count = parse_channels();
+	if (steps <= 0 || channel_count < 0) {
+		LOG_ERR("Invalid load ramp \"%s\" or channels \"%s\"", CONFIG_RID_LOAD_DRONES,
+			CONFIG_RID_LOAD_CHANNELS);
+		return -EINVAL;
+	}
+
+	for (int i = 0; i < steps; i++) {
+		uint32_t count = MIN(counts[i], CONFIG_RID_LOAD_MAX_DRONES);
+
+		// aircraft already flying keep their course; the ramp only adds to them
+		for (; ready < count; ready++) {
+			drone_init(ready);
+		}
+		run_step(iface, count);
+		log_step(&step);
+	}
+
+	LOG_INF("load done: %d steps", steps);
+
+	return steps;
+}
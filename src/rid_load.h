@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Synthetic Remote ID traffic generator
+ *
+ * A swarm of simulated aircraft, each flying straight legs around the site
+ * and broadcasting ODID beacons (Basic ID, Location, System, Operator ID and
+ * the next of CONFIG_RID_LOAD_AUTH_PAGES Authentication pages) at
+ * CONFIG_RID_LOAD_RATE_HZ with some jitter, on channels taken in turn
+ * from CONFIG_RID_LOAD_CHANNELS and at an RSSI between CONFIG_RID_LOAD_RSSI_MIN
+ * and CONFIG_RID_LOAD_RSSI_MAX. Ordinary access points beacon around them,
+ * and CONFIG_RID_LOAD_MALFORMED_PERMILLE of the aircraft beacons are broken
+ * on purpose: cut short, claiming more messages than they carry, or with
+ * scrambled messages.
+ *
+ * Every frame is raised as a NET_EVENT_WIFI_RAW_SCAN_RESULT event, so it
+ * takes the path of a frame from the radio: the net_mgmt event queue, the
+ * event handler, the ring and the decoder. The swarm grows through the
+ * counts in CONFIG_RID_LOAD_DRONES, CONFIG_RID_LOAD_STEP_MS each, and every
+ * step reports how many frames were lost on the way and where, how many
+ * raises timed out against CONFIG_NET_MGMT_EVENT_QUEUE_TIMEOUT, and how long
+ * beacons took from being raised to updating their aircraft's track.
+ */
+
+#ifndef RID_LOAD_H_
+#define RID_LOAD_H_
+
+#include <stdint.h>
+
+struct rid_load_step {
+	uint32_t drones;
+	uint32_t raised;          // frames raised, access point beacons included
+	uint32_t beacons;         // well-formed aircraft beacons among them
+	uint32_t malformed;
+	uint32_t blocked;         // raises that waited for room in the event queue
+	uint32_t timeouts;        // raises that gave up after CONFIG_NET_MGMT_EVENT_QUEUE_TIMEOUT
+	uint32_t lost_events;     // frames that never reached the event handler
+	uint32_t ring_dropped;    // frames the event handler found no room for
+	uint32_t updated;         // well-formed beacons that reached the track table
+	uint32_t drones_updated;  // aircraft with at least one of them
+	uint32_t latency_avg_us;  // from being raised to updating the track
+	uint32_t latency_max_us;
+	uint32_t worst_drone_avg_us;
+};
+
+#if defined(CONFIG_RID_LOAD)
+
+/* Run every step of the ramp and log its results. Returns the number of
+ * steps run, or a negative errno if CONFIG_RID_LOAD_DRONES does not parse.
+ */
+int rid_load_run(void);
+
+/* A frame from mac with message counter has updated its track. Called from
+ * the decoder thread while the load thread runs a step.
+ */
+void rid_load_decoded(const uint8_t mac[6], uint8_t counter);
+
+#else
+
+static inline void rid_load_decoded(const uint8_t mac[6], uint8_t counter) {}
+
+#endif /* CONFIG_RID_LOAD */
+
+#endif /* RID_LOAD_H_ */
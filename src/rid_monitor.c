@@ -0,0 +1,542 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#if !defined(RID_MONITOR_HAVE_PCAP)
+#include <zephyr/net/ethernet.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/socket.h>
+#endif
+
+#include "odid_locate.h"
+#include "rid_duty.h"
+#include "rid_monitor.h"
+#include "rid_sched.h"
+
+LOG_MODULE_REGISTER(rid_monitor, CONFIG_LOG_DEFAULT_LEVEL);
+
+static struct rid_monitor_stats stats;
+static uint32_t first_frame_time;
+
+static uint16_t channel_to_frequency(uint8_t band, uint8_t channel)
+{
+	if (band == WIFI_FREQ_BAND_2_4_GHZ) {
+		return channel == 14 ? 2484 : 2407 + channel * 5;
+	}
+
+	return 5000 + channel * 5;
+}
+
+static uint16_t monitor_frequency(void)
+{
+	return channel_to_frequency(CONFIG_RID_MONITOR_CHANNEL <= 14 ? WIFI_FREQ_BAND_2_4_GHZ
+								     : WIFI_FREQ_BAND_5_GHZ,
+				    CONFIG_RID_MONITOR_CHANNEL);
+}
+
+static void count_frame(const struct wifi_raw_scan_result *raw, bool queued)
+{
+	if (stats.frames == 0 && stats.dropped == 0) {
+		first_frame_time = k_uptime_get_32();
+	}
+	if (!queued) {
+		stats.dropped++;
+		return;
+	}
+	stats.frames++;
+	stats.bytes += raw->frame_length;
+}
+
+static bool deliver(rid_monitor_sink sink, const struct wifi_raw_scan_result *raw, uint8_t radio)
+{
+	bool queued = sink(raw, radio);
+
+	count_frame(raw, queued);
+
+	return queued;
+}
+
+void rid_monitor_get_stats(struct rid_monitor_stats *out)
+{
+	*out = stats;
+	if (stats.frames > 0 || stats.dropped > 0) {
+		out->elapsed_ms = k_uptime_get_32() - first_frame_time;
+	}
+}
+
+#if !defined(RID_MONITOR_HAVE_PCAP)
+
+/* What the nRF70 driver puts in front of every frame received in monitor mode. */
+struct raw_rx_pkt_header {
+	uint16_t frequency;
+	uint16_t signal;
+	uint8_t rate_flags;
+	uint8_t rate;
+} __packed;
+
+static K_THREAD_STACK_DEFINE(monitor_stack, CONFIG_RID_MONITOR_STACK_SIZE);
+static struct k_thread monitor_thread_data;
+static int monitor_sock = -1;
+
+static int set_monitor_mode(struct net_if *iface)
+{
+	struct wifi_mode_info mode = {
+		.mode = WIFI_MONITOR_MODE,
+		.if_index = net_if_get_by_iface(iface),
+		.oper = WIFI_MGMT_SET,
+	};
+	struct wifi_channel_info channel = {
+		.channel = CONFIG_RID_MONITOR_CHANNEL,
+		.if_index = net_if_get_by_iface(iface),
+		.oper = WIFI_MGMT_SET,
+	};
+	// Remote ID only comes in beacons and action frames; let the driver drop the rest,
+	// cut to what a raw scan result holds
+	struct wifi_filter_info filter = {
+		.filter = WIFI_PACKET_FILTER_MGMT,
+		.if_index = net_if_get_by_iface(iface),
+		.buffer_size = CONFIG_WIFI_MGMT_RAW_SCAN_RESULT_LENGTH,
+		.oper = WIFI_MGMT_SET,
+	};
+	int ret;
+
+	ret = net_mgmt(NET_REQUEST_WIFI_MODE, iface, &mode, sizeof(mode));
+	if (ret) {
+		LOG_ERR("Cannot switch to monitor mode (%d)", ret);
+		return ret;
+	}
+	ret = net_mgmt(NET_REQUEST_WIFI_CHANNEL, iface, &channel, sizeof(channel));
+	if (ret) {
+		LOG_ERR("Cannot set channel %d (%d)", CONFIG_RID_MONITOR_CHANNEL, ret);
+		return ret;
+	}
+	ret = net_mgmt(NET_REQUEST_WIFI_PACKET_FILTER, iface, &filter, sizeof(filter));
+	if (ret) {
+		// not fatal, the decoder skips data frames quickly enough
+		LOG_WRN("Cannot filter management frames (%d)", ret);
+	}
+
+	return 0;
+}
+
+static void monitor_thread(void *p1, void *p2, void *p3)
+{
+	rid_monitor_sink sink = p1;
+	static struct wifi_raw_scan_result raw;
+	struct raw_rx_pkt_header hdr;
+	// the driver header and the frame go straight to where they belong, no copy
+	struct iovec iov[] = {
+		{ .iov_base = &hdr, .iov_len = sizeof(hdr) },
+		{ .iov_base = raw.data, .iov_len = sizeof(raw.data) },
+	};
+	struct msghdr msg = {
+		.msg_iov = iov,
+		.msg_iovlen = ARRAY_SIZE(iov),
+	};
+
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (1) {
+		ssize_t len = zsock_recvmsg(monitor_sock, &msg, 0);
+
+		if (len < 0) {
+			stats.errors++;
+			LOG_ERR("Receive failed (%d)", errno);
+			k_sleep(K_MSEC(100));
+			continue;
+		}
+		if (len <= (ssize_t)sizeof(hdr)) {
+			continue;
+		}
+		if ((size_t)len == sizeof(hdr) + sizeof(raw.data)) {
+			stats.truncated++;  // or exactly as long, which cannot be told apart
+		}
+
+		raw.frequency = sys_le16_to_cpu(hdr.frequency);
+		raw.rssi = (int16_t)sys_le16_to_cpu(hdr.signal);
+		raw.frame_length = len - sizeof(hdr);
+		deliver(sink, &raw, 0);
+	}
+}
+
+int rid_monitor_start(rid_monitor_sink sink)
+{
+	struct net_if *iface = net_if_get_default();
+	struct sockaddr_ll addr = {
+		.sll_family = AF_PACKET,
+		.sll_protocol = htons(ETH_P_ALL),
+		.sll_ifindex = net_if_get_by_iface(iface),
+	};
+	int ret = set_monitor_mode(iface);
+
+	if (ret) {
+		return ret;
+	}
+
+	monitor_sock = zsock_socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (monitor_sock < 0) {
+		LOG_ERR("Cannot open packet socket (%d)", errno);
+		return -errno;
+	}
+	if (zsock_bind(monitor_sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		ret = -errno;
+		LOG_ERR("Cannot bind packet socket (%d)", ret);
+		zsock_close(monitor_sock);
+		return ret;
+	}
+
+	k_thread_create(&monitor_thread_data, monitor_stack, K_THREAD_STACK_SIZEOF(monitor_stack),
+			monitor_thread, sink, NULL, NULL, CONFIG_RID_MONITOR_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&monitor_thread_data, "rid_monitor");
+	LOG_INF("Monitoring channel %d (%u MHz)", CONFIG_RID_MONITOR_CHANNEL, monitor_frequency());
+
+	return 0;
+}
+
+#else /* RID_MONITOR_HAVE_PCAP */
+
+// pcap file embedded at build time from CONFIG_RID_MONITOR_PCAP_FILE
+static const uint8_t pcap_data[] = {
+#include "rid_monitor_pcap.inc"
+};
+
+#define PCAP_HDR_SIZE            24
+#define PCAP_RECORD_HDR_SIZE     16
+#define PCAP_LINKTYPE_IEEE802_11 105
+#define PCAP_LINKTYPE_RADIOTAP   127
+
+struct pcap_reader {
+	bool big_endian;
+	bool nsec;
+	bool radiotap;
+	size_t off;
+};
+
+static uint32_t pcap_get32(const struct pcap_reader *r, size_t off)
+{
+	return r->big_endian ? sys_get_be32(&pcap_data[off]) : sys_get_le32(&pcap_data[off]);
+}
+
+static int pcap_open(struct pcap_reader *r)
+{
+	if (sizeof(pcap_data) < PCAP_HDR_SIZE) {
+		return -EINVAL;
+	}
+
+	uint32_t magic = sys_get_le32(pcap_data);
+
+	switch (magic) {
+	case 0xa1b2c3d4:
+	case 0xa1b23c4d:
+		r->big_endian = false;
+		break;
+	case 0xd4c3b2a1:
+	case 0x4d3cb2a1:
+		r->big_endian = true;
+		break;
+	default:
+		return -EINVAL;
+	}
+	r->nsec = magic == 0xa1b23c4d || magic == 0x4d3cb2a1;
+
+	uint32_t linktype = pcap_get32(r, 20);
+
+	if (linktype != PCAP_LINKTYPE_IEEE802_11 && linktype != PCAP_LINKTYPE_RADIOTAP) {
+		LOG_ERR("Link type %u is neither 802.11 nor radiotap", linktype);
+		return -EINVAL;
+	}
+	r->radiotap = linktype == PCAP_LINKTYPE_RADIOTAP;
+	r->off = PCAP_HDR_SIZE;
+
+	return 0;
+}
+
+/* Take the frequency and RSSI from a radiotap header where present. Returns
+ * the header length, or -EINVAL.
+ */
+static int radiotap_parse(const uint8_t *pkt, size_t len, struct wifi_raw_scan_result *raw)
+{
+	// (alignment, size) of the fields up to antenna signal, in presence bit order
+	static const struct {
+		uint8_t align;
+		uint8_t size;
+	} fields[] = {
+		{ 8, 8 },  // TSFT
+		{ 1, 1 },  // flags
+		{ 1, 1 },  // rate
+		{ 2, 4 },  // channel: frequency and flags
+		{ 1, 2 },  // FHSS
+		{ 1, 1 },  // antenna signal, dBm
+	};
+
+	if (len < 8) {
+		return -EINVAL;
+	}
+
+	size_t hdr_len = sys_get_le16(&pkt[2]);
+	uint32_t present = sys_get_le32(&pkt[4]);
+	size_t off = 8;
+
+	if (hdr_len < off || hdr_len > len) {
+		return -EINVAL;
+	}
+	// the fields start after the last extended presence bitmap
+	for (uint32_t p = present; p & BIT(31); off += 4) {
+		if (off + 4 > hdr_len) {
+			return -EINVAL;
+		}
+		p = sys_get_le32(&pkt[off]);
+	}
+
+	for (size_t bit = 0; bit < ARRAY_SIZE(fields); bit++) {
+		if (!(present & BIT(bit))) {
+			continue;
+		}
+		off = ROUND_UP(off, fields[bit].align);
+		if (off + fields[bit].size > hdr_len) {
+			break;
+		}
+		if (bit == 3) {
+			raw->frequency = sys_get_le16(&pkt[off]);
+		} else if (bit == 5) {
+			raw->rssi = (int8_t)pkt[off];
+		}
+		off += fields[bit].size;
+	}
+
+	return hdr_len;
+}
+
+/* Fill raw with the next record and its time in us. Returns 1, 0 at the end
+ * of the file, or -EINVAL.
+ */
+static int pcap_next(struct pcap_reader *r, struct wifi_raw_scan_result *raw, uint64_t *time_us)
+{
+	if (r->off + PCAP_RECORD_HDR_SIZE > sizeof(pcap_data)) {
+		return 0;
+	}
+
+	uint32_t sec = pcap_get32(r, r->off);
+	uint32_t frac = pcap_get32(r, r->off + 4);
+	uint32_t incl = pcap_get32(r, r->off + 8);
+	const uint8_t *pkt = &pcap_data[r->off + PCAP_RECORD_HDR_SIZE];
+
+	if (incl > sizeof(pcap_data) - r->off - PCAP_RECORD_HDR_SIZE) {
+		return -EINVAL;
+	}
+	r->off += PCAP_RECORD_HDR_SIZE + incl;
+	*time_us = (uint64_t)sec * USEC_PER_SEC + (r->nsec ? frac / NSEC_PER_USEC : frac);
+
+	raw->rssi = CONFIG_RID_MONITOR_PCAP_RSSI;
+	raw->frequency = monitor_frequency();
+	if (r->radiotap) {
+		int hdr_len = radiotap_parse(pkt, incl, raw);
+
+		if (hdr_len < 0) {
+			return hdr_len;
+		}
+		pkt += hdr_len;
+		incl -= hdr_len;
+	}
+
+	if (incl > sizeof(raw->data)) {
+		stats.truncated++;
+		incl = sizeof(raw->data);
+	}
+	raw->frame_length = incl;
+	memcpy(raw->data, pkt, incl);
+
+	return 1;
+}
+
+#if defined(CONFIG_RID_MONITOR_PCAP_SCAN)
+struct scan_window {
+	uint64_t start_us;
+	uint64_t end_us;
+	uint64_t rest_us;       // end of the previous scan and the channel switch after it
+	uint16_t frequency;     // 0 before the first scan
+};
+
+// pcap time at the start of the pass and the ms since boot it stands for
+static uint64_t pass_start_us;
+static uint32_t pass_start_ms;
+
+/* Ms since boot at pcap time time_us, for the duty cycle; the same as the
+ * time the frame is received at recorded speed.
+ */
+static uint32_t scan_time_ms(uint64_t time_us)
+{
+	return pass_start_ms + (uint32_t)((time_us - pass_start_us) / USEC_PER_MSEC);
+}
+
+/* Whether one of the emulated radios is listening on frequency at time_us,
+ * and if so which one. Radios rest between scans as the duty cycle says.
+ */
+static int scan_hears(struct scan_window *windows, uint64_t time_us, uint16_t frequency)
+{
+	for (int radio = 0; radio < CONFIG_RID_SCAN_RADIOS; radio++) {
+		struct scan_window *w = &windows[radio];
+
+		while (time_us >= w->end_us) {
+			struct wifi_scan_params params;
+			uint32_t gap_ms = 0;
+
+			if (w->frequency != 0) {
+				gap_ms = rid_duty_scan_done(radio, scan_time_ms(w->end_us),
+							    w->end_us - w->start_us);
+			}
+			w->rest_us = w->end_us + CONFIG_RID_MONITOR_PCAP_SCAN_GAP_MS * USEC_PER_MSEC;
+			w->start_us = w->rest_us + gap_ms * USEC_PER_MSEC;
+			if (rid_sched_next(radio, &params, w->start_us / USEC_PER_MSEC) < 0) {
+				w->end_us = UINT64_MAX;  // a radio left without a channel never listens
+				w->frequency = 0;
+				break;
+			}
+			w->end_us = w->start_us + params.dwell_time_passive * USEC_PER_MSEC;
+			w->frequency = channel_to_frequency(params.band_chan[0].band,
+							    params.band_chan[0].channel);
+			stats.scans++;
+		}
+		// a frame heard since cuts a rest short, as rid_scan_kick() does
+		if (time_us < w->start_us && w->start_us > w->rest_us && rid_duty_active()) {
+			uint64_t dwell_us = w->end_us - w->start_us;
+
+			w->start_us = MAX(w->rest_us, time_us);
+			w->end_us = w->start_us + dwell_us;
+		}
+		if (time_us >= w->start_us && frequency == w->frequency) {
+			return radio;
+		}
+	}
+
+	return -1;
+}
+#endif
+
+static int pcap_pass(rid_monitor_sink sink, int64_t *due)
+{
+	static struct wifi_raw_scan_result raw;
+	struct pcap_reader r;
+	uint64_t time_us;
+	uint64_t prev_us = 0;
+	bool first = true;
+	int ret;
+#if defined(CONFIG_RID_MONITOR_PCAP_SCAN)
+	struct scan_window windows[CONFIG_RID_SCAN_RADIOS] = { 0 };
+#endif
+
+	ret = pcap_open(&r);
+	if (ret) {
+		LOG_ERR("%s is not a pcap file", CONFIG_RID_MONITOR_PCAP_FILE);
+		return ret;
+	}
+
+	while ((ret = pcap_next(&r, &raw, &time_us)) > 0) {
+		size_t pack_len;
+		enum odid_transport transport;
+		bool odid = odid_locate_pack(raw.data, raw.frame_length, &pack_len, NULL,
+					     &transport) != NULL;
+
+		if (first) {
+			prev_us = time_us;
+#if defined(CONFIG_RID_MONITOR_PCAP_SCAN)
+			for (size_t i = 0; i < ARRAY_SIZE(windows); i++) {
+				windows[i].end_us = time_us;
+			}
+			pass_start_us = time_us;
+			pass_start_ms = k_uptime_get_32();
+#endif
+			first = false;
+		}
+
+#if CONFIG_RID_MONITOR_PCAP_SPEED > 0
+		*due += (int64_t)(time_us - MIN(prev_us, time_us)) / USEC_PER_MSEC * 100 /
+			CONFIG_RID_MONITOR_PCAP_SPEED;
+		k_sleep(K_TIMEOUT_ABS_MS(*due));
+#endif
+		prev_us = MAX(prev_us, time_us);
+
+		stats.odid += odid;
+		if (odid) {
+			stats.odid_over[transport]++;
+		}
+#if defined(CONFIG_RID_MONITOR_PCAP_SCAN)
+		int radio = scan_hears(windows, time_us, raw.frequency);
+#else
+		int radio = raw.frequency == monitor_frequency() ? 0 : -1;
+#endif
+		if (radio < 0) {
+			stats.skipped++;
+			stats.odid_lost += odid;
+			continue;
+		}
+
+#if CONFIG_RID_MONITOR_PCAP_SPEED > 0
+		// at recorded speed a full ring drops, as it would live
+		if (!deliver(sink, &raw, radio)) {
+			stats.odid_lost += odid;
+		}
+#else
+		// as fast as the decoder keeps up, without losing anything
+		while (!sink(&raw, radio)) {
+			k_sleep(K_MSEC(1));
+		}
+		count_frame(&raw, true);
+#endif
+	}
+	if (ret < 0) {
+		stats.errors++;
+		LOG_ERR("Malformed pcap record at offset %zu", r.off);
+	}
+
+	return ret;
+}
+
+int rid_monitor_pcap_run(rid_monitor_sink sink)
+{
+	int64_t due = k_uptime_get();
+
+#if defined(CONFIG_RID_MONITOR_PCAP_SCAN)
+	if (rid_sched_init(CONFIG_RID_SCAN_RADIOS) < 0) {
+		return -EINVAL;
+	}
+	rid_duty_init(k_uptime_get_32(), CONFIG_RID_SCAN_RADIOS);
+#endif
+
+	for (int loop = 0; loop < CONFIG_RID_MONITOR_PCAP_LOOPS; loop++) {
+		if (pcap_pass(sink, &due) < 0) {
+			break;
+		}
+	}
+
+	struct rid_monitor_stats s;
+
+	rid_monitor_get_stats(&s);
+#if defined(CONFIG_RID_MONITOR_PCAP_SCAN)
+	LOG_INF("monitor done: scan plan, %u scans on %d radios", s.scans, CONFIG_RID_SCAN_RADIOS);
+#else
+	LOG_INF("monitor done: channel %d", CONFIG_RID_MONITOR_CHANNEL);
+#endif
+	LOG_INF("monitor: %u frames in %u ms (%u/s), %u dropped, %u skipped",
+		s.frames, s.elapsed_ms, (uint32_t)(s.frames * 1000ULL / MAX(s.elapsed_ms, 1U)),
+		s.dropped, s.skipped);
+	LOG_INF("monitor: %u Remote ID frames, %u lost (%u%%)",
+		s.odid, s.odid_lost, s.odid ? s.odid_lost * 100 / s.odid : 0);
+	LOG_INF("monitor: Remote ID over beacons %u, NAN %u, action frames %u",
+		s.odid_over[ODID_TRANSPORT_BEACON], s.odid_over[ODID_TRANSPORT_NAN],
+		s.odid_over[ODID_TRANSPORT_ACTION]);
+
+	return s.frames;
+}
+
+#endif /* RID_MONITOR_HAVE_PCAP */
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Monitor mode frame source
+ *
+ * Instead of scanning, the interface is put in monitor mode on
+ * CONFIG_RID_MONITOR_CHANNEL and every management frame it receives is read
+ * from a packet socket and handed to the same queue as raw scan results. The
+ * radio never leaves the channel, so no frame is lost to the dwell time on
+ * other channels or to the gaps between scans.
+ *
+ * With CONFIG_RID_MONITOR_PCAP_FILE, frames come from a pcap file embedded at
+ * build time instead, which lets native_sim measure frame rates and losses.
+ * The file may be 802.11 (frames are taken to be on the monitored channel)
+ * or radiotap (frames on other channels are skipped). With
+ * CONFIG_RID_MONITOR_PCAP_SCAN, the same file is seen through the scan plan
+ * instead: a frame only passes while the emulated scan dwells on its channel.
+ * CONFIG_RID_SCAN_RADIOS radios are emulated, each with its share of the plan.
+ */
+
+#ifndef RID_MONITOR_H_
+#define RID_MONITOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/net/wifi_mgmt.h>
+
+#include "odid_locate.h"
+
+struct rid_monitor_stats {
+	uint32_t frames;       // handed to the sink
+	uint32_t bytes;
+	uint32_t dropped;      // refused by the sink, i.e. the ring was full
+	uint32_t truncated;    // longer than a raw scan result holds
+	uint32_t errors;       // socket receive errors or malformed pcap records
+	uint32_t elapsed_ms;   // since the first frame
+
+	// pcap only
+	uint32_t skipped;      // on another channel, or outside the emulated scans
+	uint32_t odid;         // frames in the file carrying Remote ID
+	uint32_t odid_over[ODID_TRANSPORT_COUNT];  // of those, by transport
+	uint32_t odid_lost;    // of those, skipped or dropped
+	uint32_t scans;        // emulated scans
+};
+
+/* Receives one frame, heard by radio. Returns false if it could not be queued. */
+typedef bool (*rid_monitor_sink)(const struct wifi_raw_scan_result *raw, uint8_t radio);
+
+/* Switch the default interface to monitor mode and start reading frames
+ * into sink from a thread of its own. Returns 0 or a negative errno.
+ */
+int rid_monitor_start(rid_monitor_sink sink);
+
+/* Feed the embedded pcap file into sink CONFIG_RID_MONITOR_PCAP_LOOPS times,
+ * paced by CONFIG_RID_MONITOR_PCAP_SPEED, and log the result. Returns the
+ * number of frames handed to the sink, or a negative errno.
+ */
+int rid_monitor_pcap_run(rid_monitor_sink sink);
+
+void rid_monitor_get_stats(struct rid_monitor_stats *stats);
+
+#endif /* RID_MONITOR_H_ */
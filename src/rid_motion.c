@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+
+#include "rid_geo.h"
+#include "rid_motion.h"
+
+#define TENTHS_PER_HOUR   36000
+
+// no track stays silent this long, and the covariance arithmetic relies on it
+#define MAX_DT_MS         60000
+
+// covariance limits, which keep every product below in 64 bits: 1 km and 100 m/s
+#define P_POS_MAX         10000000000LL
+#define P_VEL_MAX         100000000LL
+
+// innovations beyond 100 km or 1 km/s are corrupt frames, not motion
+#define Y_POS_MAX         10000000
+#define Y_VEL_MAX         100000
+
+enum { EAST, NORTH, UP };
+
+// one standard deviation, taken as half the bound of each
+// enum VERTICAL_HORIZONTAL_BARO_ALT_ACCURACY value, cm
+static const uint16_t vertical_sigma_cm[] = { 15000, 7500, 2250, 1250, 500, 150, 50 };
+// and of each enum HORIZONTAL_ACCURACY value, but no more than 250 m, which
+// keeps p00 * r within 64 bits in axis_measure_position()
+static const uint16_t horizontal_sigma_cm[] = { 25000, 25000, 25000, 25000, 25000, 25000,
+						25000, 9260, 4630, 1500, 500, 150, 50 };
+// and of each enum SPEED_ACCURACY value, cm/s
+static const uint16_t speed_sigma_cm_s[] = { 1000, 500, 150, 50, 15 };
+
+static struct rid_motion_stats stats;
+static uint64_t error_sum_cm;
+static uint64_t stale_sum_cm;
+static uint64_t sigma_sum_cm;
+
+static uint32_t isqrt64(uint64_t v)
+{
+	uint64_t root = 0;
+
+	for (uint64_t bit = 1ULL << 62; bit != 0; bit >>= 2) {
+		if (v >= root + bit) {
+			v -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+	}
+
+	return root;
+}
+
+static uint16_t sigma(const uint16_t *table, size_t size, uint8_t accuracy)
+{
+	return table[accuracy < size ? accuracy : 0];
+}
+
+static void to_local(const struct rid_motion *m, int32_t lat, int32_t lon,
+		     int32_t *east, int32_t *north)
+{
+	int64_t dlon = ((int64_t)lon - m->origin_lon) * m->cos_q15 >> 15;
+
+	*east = dlon * RID_GEO_CM_PER_E7_Q16 >> 16;
+	*north = ((int64_t)lat - m->origin_lat) * RID_GEO_CM_PER_E7_Q16 >> 16;
+}
+
+static void from_local(const struct rid_motion *m, int32_t east, int32_t north,
+		       int32_t *lat, int32_t *lon)
+{
+	*lat = m->origin_lat + ((int64_t)north << 16) / RID_GEO_CM_PER_E7_Q16;
+	*lon = m->origin_lon + (((int64_t)east << 16) / RID_GEO_CM_PER_E7_Q16 << 15) / m->cos_q15;
+}
+
+/* Keep the covariance positive semidefinite and within the limits, whatever
+ * the rounding did.
+ */
+static void axis_clamp(struct rid_motion_axis *a)
+{
+	a->p00 = CLAMP(a->p00, 1, P_POS_MAX);
+	a->p11 = CLAMP(a->p11, 1, P_VEL_MAX);
+
+	int64_t limit = isqrt64(a->p00 * a->p11);
+
+	a->p01 = CLAMP(a->p01, -limit, limit);
+}
+
+static void axis_init(struct rid_motion_axis *a, int32_t pos, int64_t r)
+{
+	a->pos = pos;
+	a->vel = 0;
+	a->p00 = r;
+	a->p01 = 0;
+	a->p11 = P_VEL_MAX;  // until a speed comes in, anything goes
+}
+
+static int32_t axis_position_at(const struct rid_motion_axis *a, int32_t dt_ms)
+{
+	return a->pos + (int64_t)a->vel * dt_ms / MSEC_PER_SEC;
+}
+
+/* Move the state dt_ms ahead, with a random acceleration of
+ * CONFIG_RID_MOTION_ACCEL held over the interval.
+ */
+static void axis_predict(struct rid_motion_axis *a, int32_t dt_ms)
+{
+	int64_t dt = dt_ms;
+	int64_t dv = (int64_t)CONFIG_RID_MOTION_ACCEL * dt / MSEC_PER_SEC;
+	int64_t q11 = dv * dv;
+	int64_t q01 = q11 * dt / (2 * MSEC_PER_SEC);
+	int64_t q00 = q01 * dt / (2 * MSEC_PER_SEC);
+	int64_t p11_dt = a->p11 * dt / MSEC_PER_SEC;
+
+	a->pos = axis_position_at(a, dt_ms);
+	a->p00 += (2 * a->p01 + p11_dt) * dt / MSEC_PER_SEC + q00;
+	a->p01 += p11_dt + q01;
+	a->p11 += q11;
+	axis_clamp(a);
+}
+
+/* Fold in a measured position z with variance r. Gains are Q16. */
+static void axis_measure_position(struct rid_motion_axis *a, int32_t z, int64_t r)
+{
+	int64_t s = a->p00 + r;
+	int64_t y = CLAMP((int64_t)z - a->pos, -Y_POS_MAX, Y_POS_MAX);
+	int64_t k0 = (a->p00 << 16) / s;
+	int64_t k1 = (a->p01 << 16) / s;
+
+	a->pos += (k0 * y) >> 16;
+	a->vel += (k1 * y) >> 16;
+	a->p11 -= (k1 * a->p01) >> 16;
+	a->p01 = a->p01 * r / s;
+	a->p00 = a->p00 * r / s;
+	axis_clamp(a);
+}
+
+/* Fold in a measured velocity z with variance r. */
+static void axis_measure_velocity(struct rid_motion_axis *a, int32_t z, int64_t r)
+{
+	int64_t s = a->p11 + r;
+	int64_t y = CLAMP((int64_t)z - a->vel, -Y_VEL_MAX, Y_VEL_MAX);
+	int64_t k0 = (a->p01 << 16) / s;
+	int64_t k1 = (a->p11 << 16) / s;
+
+	a->pos += (k0 * y) >> 16;
+	a->vel += (k1 * y) >> 16;
+	a->p00 -= (k0 * a->p01) >> 16;
+	a->p01 = a->p01 * r / s;
+	a->p11 = a->p11 * r / s;
+	axis_clamp(a);
+}
+
+/* Time from the latest message fed to loc, received at now, in ms; negative
+ * if loc is older. The ODID timestamps say when the positions were taken, so
+ * they are used whenever both messages carry one.
+ */
+static int32_t elapsed_ms(const struct rid_motion *m, const struct odid_location *loc, uint32_t now)
+{
+	if (loc->timestamp < TENTHS_PER_HOUR && m->fix_timestamp < TENTHS_PER_HOUR) {
+		int32_t d = (loc->timestamp - m->fix_timestamp + TENTHS_PER_HOUR) % TENTHS_PER_HOUR;
+
+		return (d > TENTHS_PER_HOUR / 2 ? d - TENTHS_PER_HOUR : d) * 100;
+	}
+
+	return (int32_t)(now - m->fix_time);
+}
+
+#if CONFIG_RID_MOTION_HOLDOUT > 1
+static void score(const struct rid_motion *m, int32_t dt_ms, int32_t east, int32_t north)
+{
+	int64_t de = axis_position_at(&m->axis[EAST], dt_ms) - east;
+	int64_t dn = axis_position_at(&m->axis[NORTH], dt_ms) - north;
+	uint32_t error = isqrt64(de * de + dn * dn);
+
+	de = m->last_east - east;
+	dn = m->last_north - north;
+
+	uint32_t stale = isqrt64(de * de + dn * dn);
+
+	stats.held_out++;
+	error_sum_cm += error;
+	stale_sum_cm += stale;
+	stats.error_max_cm = MAX(stats.error_max_cm, error);
+	stats.stale_max_cm = MAX(stats.stale_max_cm, stale);
+}
+#endif
+
+static void measure_horizontal_velocity(struct rid_motion *m, const struct odid_location *loc)
+{
+	if (loc->speed >= RID_GEO_SPEED_UNKNOWN || loc->direction >= RID_GEO_DIRECTION_UNKNOWN) {
+		return;
+	}
+
+	int64_t s = sigma(speed_sigma_cm_s, ARRAY_SIZE(speed_sigma_cm_s), loc->speed_accuracy);
+	// plus a few degrees of direction error across the track
+	int64_t r = s * s + (int64_t)loc->speed * loc->speed / 256;
+
+	axis_measure_velocity(&m->axis[EAST],
+			      (int32_t)loc->speed * rid_geo_sin_q15(loc->direction) >> 15, r);
+	axis_measure_velocity(&m->axis[NORTH],
+			      (int32_t)loc->speed * rid_geo_sin_q15(loc->direction + 90) >> 15, r);
+}
+
+static void measure_vertical(struct rid_motion *m, const struct odid_location *loc, int32_t dt_ms)
+{
+	struct rid_motion_axis *a = &m->axis[UP];
+	int64_t s = sigma(vertical_sigma_cm, ARRAY_SIZE(vertical_sigma_cm), loc->vertical_accuracy);
+
+	if (loc->geodetic_altitude < RID_GEO_ALTITUDE_UNKNOWN) {
+		return;
+	}
+	if (!m->vertical) {
+		axis_init(a, loc->geodetic_altitude * 10, s * s);
+		m->vertical = true;
+	} else {
+		axis_predict(a, dt_ms);
+		axis_measure_position(a, loc->geodetic_altitude * 10, s * s);
+	}
+
+	if (abs(loc->vertical_speed) < RID_GEO_VSPEED_UNKNOWN) {
+		s = sigma(speed_sigma_cm_s, ARRAY_SIZE(speed_sigma_cm_s), loc->speed_accuracy);
+		axis_measure_velocity(a, loc->vertical_speed, s * s);
+	}
+}
+
+void rid_motion_update(struct rid_motion *m, const struct odid_location *loc, uint32_t now)
+{
+	int32_t dt_ms = 0;
+	int32_t east;
+	int32_t north;
+
+	if (loc->latitude == 0 && loc->longitude == 0) {
+		stats.skipped++;  // no fix
+		return;
+	}
+
+	if (!m->horizontal) {
+		m->origin_lat = loc->latitude;
+		m->origin_lon = loc->longitude;
+		m->cos_q15 = MAX(rid_geo_cos_q15(loc->latitude), 1);
+	} else {
+		dt_ms = elapsed_ms(m, loc, now);
+		if (dt_ms < 0 || (dt_ms == 0 && loc->timestamp == m->fix_timestamp)) {
+			stats.skipped++;  // a copy of the latest message fed, or an older one
+			return;
+		}
+		dt_ms = MIN(dt_ms, MAX_DT_MS);
+	}
+	to_local(m, loc->latitude, loc->longitude, &east, &north);
+
+#if CONFIG_RID_MOTION_HOLDOUT > 1
+	if (m->messages++ % CONFIG_RID_MOTION_HOLDOUT != 0) {
+		score(m, dt_ms, east, north);
+		return;
+	}
+#endif
+
+	int64_t s = sigma(horizontal_sigma_cm, ARRAY_SIZE(horizontal_sigma_cm), loc->horizontal_accuracy);
+
+	sigma_sum_cm += s;
+
+	if (!m->horizontal) {
+		axis_init(&m->axis[EAST], east, s * s);
+		axis_init(&m->axis[NORTH], north, s * s);
+		m->horizontal = true;
+	} else {
+		axis_predict(&m->axis[EAST], dt_ms);
+		axis_predict(&m->axis[NORTH], dt_ms);
+		axis_measure_position(&m->axis[EAST], east, s * s);
+		axis_measure_position(&m->axis[NORTH], north, s * s);
+	}
+	measure_horizontal_velocity(m, loc);
+	measure_vertical(m, loc, dt_ms);
+
+	m->fix_time = now;
+	m->fix_timestamp = loc->timestamp;
+	m->last_east = east;
+	m->last_north = north;
+	stats.updates++;
+}
+
+bool rid_motion_predict(const struct rid_motion *m, uint32_t now, struct rid_motion_estimate *est)
+{
+	if (!m->horizontal) {
+		return false;
+	}
+
+	uint32_t age_ms = now - m->fix_time;
+	struct rid_motion_axis axis[3];
+
+	memcpy(axis, m->axis, sizeof(axis));
+	for (size_t i = 0; i < ARRAY_SIZE(axis); i++) {
+		axis_predict(&axis[i], MIN(age_ms, MAX_DT_MS));
+	}
+
+	from_local(m, axis[EAST].pos, axis[NORTH].pos, &est->latitude, &est->longitude);
+	est->altitude = m->vertical ? axis[UP].pos / 10 : RID_GEO_ALTITUDE_NONE;
+	est->velocity_east = CLAMP(axis[EAST].vel, INT16_MIN, INT16_MAX);
+	est->velocity_north = CLAMP(axis[NORTH].vel, INT16_MIN, INT16_MAX);
+	est->vertical_speed = m->vertical ? CLAMP(axis[UP].vel, INT16_MIN, INT16_MAX) : 0;
+	est->horizontal_error_cm = isqrt64(axis[EAST].p00 + axis[NORTH].p00);
+	est->vertical_error_cm = m->vertical ? isqrt64(axis[UP].p00) : 0;
+	est->age_ms = age_ms;
+
+	return true;
+}
+
+void rid_motion_get_stats(struct rid_motion_stats *out)
+{
+	*out = stats;
+	out->error_avg_cm = stats.held_out ? error_sum_cm / stats.held_out : 0;
+	out->stale_avg_cm = stats.held_out ? stale_sum_cm / stats.held_out : 0;
+	out->sigma_avg_cm = stats.updates ? sigma_sum_cm / stats.updates : 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Per-track motion filter
+ *
+ * A Location/Vector message only arrives when a scan lands on the channel of
+ * the aircraft, so the last reported position is often seconds old. Every
+ * track runs a constant-velocity Kalman filter over its Location messages,
+ * one per axis (east, north, up) in a local frame around the first fix, in
+ * integer centimetres. Positions are weighted by the horizontal and vertical
+ * accuracy the aircraft reports, and speed, direction and vertical speed
+ * are weighted by its speed accuracy. rid_motion_predict() answers where the
+ * aircraft is now, with the uncertainty of the answer.
+ *
+ * Measurement times come from the ODID timestamps, so replaying a capture
+ * faster than real time filters it the same way. With
+ * CONFIG_RID_MOTION_HOLDOUT, only one Location message in that many is fed
+ * to the filter; the others are held out and the prediction for their time
+ * is scored against them, next to the error of the last fed position.
+ */
+
+#ifndef RID_MOTION_H_
+#define RID_MOTION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "odid_decoder.h"
+
+struct rid_motion_axis {
+	int32_t pos;         // cm from the origin
+	int32_t vel;         // cm/s
+	int64_t p00;         // covariance, cm^2
+	int64_t p01;         // cm^2/s
+	int64_t p11;         // (cm/s)^2
+};
+
+struct rid_motion {
+	bool horizontal;                // a position fix has been taken
+	bool vertical;                  // an altitude fix has been taken
+	int32_t origin_lat;             // 1e-7 degrees
+	int32_t origin_lon;
+	int32_t cos_q15;                // cos(origin_lat), scales longitude to latitude
+	struct rid_motion_axis axis[3]; // east, north, up
+	uint32_t fix_time;              // ms since boot of the latest message fed
+	uint16_t fix_timestamp;         // its ODID timestamp, tenths of a second past the hour
+	uint32_t messages;              // Location messages seen, fed or held out
+	int32_t last_east;              // position of the latest message fed, cm
+	int32_t last_north;
+};
+
+struct rid_motion_estimate {
+	int32_t latitude;               // 1e-7 degrees
+	int32_t longitude;
+	int32_t altitude;               // geodetic, decimetres
+	int16_t velocity_east;          // cm/s
+	int16_t velocity_north;
+	int16_t vertical_speed;         // cm/s, positive up
+	uint32_t horizontal_error_cm;   // one standard deviation
+	uint32_t vertical_error_cm;
+	uint32_t age_ms;                // since the latest message fed
+};
+
+struct rid_motion_stats {
+	uint32_t updates;        // Location messages fed to a filter
+	uint32_t skipped;        // older than the latest one fed, or without a position
+	uint32_t held_out;       // scored instead of fed
+	uint32_t error_avg_cm;   // prediction against the held out position
+	uint32_t error_max_cm;
+	uint32_t stale_avg_cm;   // latest fed position against the held out one
+	uint32_t stale_max_cm;
+	uint32_t sigma_avg_cm;   // horizontal accuracy of the positions fed, one standard deviation
+};
+
+#if defined(CONFIG_RID_MOTION)
+
+/* Feed loc, received at now (ms since boot), to the filter of a track, or
+ * score it against the filter if it is held out.
+ */
+void rid_motion_update(struct rid_motion *m, const struct odid_location *loc, uint32_t now);
+
+/* Estimate the position at now (ms since boot). Returns false before the
+ * first position fix.
+ */
+bool rid_motion_predict(const struct rid_motion *m, uint32_t now, struct rid_motion_estimate *est);
+
+void rid_motion_get_stats(struct rid_motion_stats *stats);
+
+#endif /* CONFIG_RID_MOTION */
+
+#endif /* RID_MOTION_H_ */
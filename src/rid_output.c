@@ -0,0 +1,536 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/sys/util.h>
+
+#if defined(CONFIG_RID_OUTPUT_BACKEND_RTT)
+#include <zephyr/init.h>
+#include <SEGGER_RTT.h>
+#endif
+
+#if defined(CONFIG_RID_OUTPUT_BACKEND_UART)
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#endif
+
+#include "rid_output.h"
+#include "rid_stats.h"
+
+RING_BUF_DECLARE(alerts, CONFIG_RID_OUTPUT_ALERT_SIZE);
+
+#if defined(CONFIG_RID_OUTPUT_PRIORITY)
+// the staging buffer split evenly between the frame classes
+#define STAGING_SHARE (CONFIG_RID_OUTPUT_STAGING_SIZE / RID_OUTPUT_PRIO_COUNT)
+
+RING_BUF_DECLARE(staging_urgent, STAGING_SHARE);
+RING_BUF_DECLARE(staging_near, STAGING_SHARE);
+RING_BUF_DECLARE(staging_routine, STAGING_SHARE);
+RING_BUF_DECLARE(staging_repeat, STAGING_SHARE);
+
+// most urgent first
+static struct ring_buf *const queues[] = {
+	&alerts, &staging_urgent, &staging_near, &staging_routine, &staging_repeat,
+};
+
+#define REPEAT_QUEUE  (ARRAY_SIZE(queues) - 1)
+
+// one thousandth of a record, the unit of the token buckets
+#define TOKEN         1000
+#define BUCKET_FULL   (CONFIG_RID_OUTPUT_BURST * TOKEN)
+#define BUCKET_FILL_MS DIV_ROUND_UP(BUCKET_FULL, CONFIG_RID_OUTPUT_RATE)
+
+#define BUCKET_WAYS   4
+#define BUCKET_SETS   (CONFIG_RID_OUTPUT_AIRCRAFT / BUCKET_WAYS)
+
+BUILD_ASSERT(BUCKET_SETS > 0 && (BUCKET_SETS & (BUCKET_SETS - 1)) == 0,
+	     "CONFIG_RID_OUTPUT_AIRCRAFT must be four times a power of two");
+
+/* An aircraft's share of a backed-up link, in the set of four its MAC picks.
+ * A new aircraft takes a free way or the one heard from longest ago, and
+ * starts with a full bucket.
+ */
+struct bucket {
+	uint8_t mac[6];
+	uint8_t valid;
+	uint32_t tokens;
+	uint32_t refilled;      // ms since boot, when its aircraft was last heard
+	uint32_t repeat_seq;    // repeats_staged once its latest repeat was staged
+};
+
+struct bucket_set {
+	struct bucket way[BUCKET_WAYS];
+};
+
+static struct bucket_set buckets[BUCKET_SETS];
+
+// the last flush left frames staged: the link is not keeping up
+static bool backed_up;
+
+// repeat records staged and taken off the head of their queue, for coalescing
+static uint32_t repeats_staged;
+static uint32_t repeats_taken;
+#else
+RING_BUF_DECLARE(staging, CONFIG_RID_OUTPUT_STAGING_SIZE);
+
+static struct ring_buf *const queues[] = {
+	&alerts, &staging,
+};
+#endif
+
+#define ALERT_QUEUE   0
+
+/* Staged ahead of every record and dropped when it goes out, for the latency
+ * of the record; never sent on the link.
+ */
+struct record_local {
+	uint32_t timestamp;     // ms since boot when the frame was received
+	int32_t air_ms;         // age of its position by then, negative if unknown
+};
+
+// the queue whose head record is being written and its bytes not yet written; the stream is
+// at a record boundary, where a more urgent record may go ahead, when none are left
+static uint32_t current;
+static uint32_t current_left;
+static struct record_local current_local;
+
+static struct rid_output_stats stats;
+
+/* ---- RTT backend: binary records on their own up-channel, next to the text console on channel 0 ---- */
+
+#if defined(CONFIG_RID_OUTPUT_BACKEND_RTT)
+static uint8_t rtt_up_buf[CONFIG_RID_OUTPUT_RTT_BUFFER_SIZE];
+
+// configured at boot, since the first flush asks the channel for its space
+// before it writes anything
+static int rtt_init(void)
+{
+	SEGGER_RTT_ConfigUpBuffer(CONFIG_RID_OUTPUT_RTT_CHANNEL, "rid", rtt_up_buf,
+				  sizeof(rtt_up_buf), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+
+	return 0;
+}
+
+SYS_INIT(rtt_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+static size_t rtt_write(const uint8_t *buf, size_t len)
+{
+	return SEGGER_RTT_WriteNoLock(CONFIG_RID_OUTPUT_RTT_CHANNEL, buf, len);
+}
+
+static size_t rtt_write_space(void)
+{
+	return SEGGER_RTT_GetAvailWriteSpace(CONFIG_RID_OUTPUT_RTT_CHANNEL);
+}
+
+const struct rid_output_backend rid_output_backend_rtt = {
+	.name = "rtt",
+	.write = rtt_write,
+	.write_space = rtt_write_space,
+};
+#endif
+
+/* ---- UART backend: polled output, a bounded chunk per flush so the decoder is never stuck for long ---- */
+
+#if defined(CONFIG_RID_OUTPUT_BACKEND_UART)
+#if DT_HAS_CHOSEN(nordic_rid_uart)
+#define RID_UART_NODE DT_CHOSEN(nordic_rid_uart)
+#else
+#define RID_UART_NODE DT_CHOSEN(zephyr_console)
+#endif
+
+static size_t uart_write(const uint8_t *buf, size_t len)
+{
+	const struct device *uart = DEVICE_DT_GET(RID_UART_NODE);
+
+	for (size_t i = 0; i < len; i++) {
+		uart_poll_out(uart, buf[i]);
+	}
+
+	return len;
+}
+
+static size_t uart_write_space(void)
+{
+	return CONFIG_RID_OUTPUT_UART_CHUNK;
+}
+
+const struct rid_output_backend rid_output_backend_uart = {
+	.name = "uart",
+	.write = uart_write,
+	.write_space = uart_write_space,
+};
+#endif
+
+/* ---- null backend: accepts and discards everything, for measuring the sink itself ---- */
+
+static size_t null_write(const uint8_t *buf, size_t len)
+{
+	ARG_UNUSED(buf);
+
+	return len;
+}
+
+static size_t null_write_space(void)
+{
+	return SIZE_MAX;
+}
+
+const struct rid_output_backend rid_output_backend_null = {
+	.name = "null",
+	.write = null_write,
+	.write_space = null_write_space,
+};
+
+/* ---- throttled backend: discards like the null one, but only so fast, to back the link up in tests ---- */
+
+#if defined(CONFIG_RID_OUTPUT_BACKEND_THROTTLE)
+// thousandths of a byte the link can still take, topped up with time, up to a second's worth
+static uint32_t throttle_allowance;
+static uint32_t throttle_time;
+
+static size_t throttle_write(const uint8_t *buf, size_t len)
+{
+	ARG_UNUSED(buf);
+
+	len = MIN(len, throttle_allowance / 1000);
+	throttle_allowance -= len * 1000;
+
+	return len;
+}
+
+static size_t throttle_write_space(void)
+{
+	uint32_t now = k_uptime_get_32();
+	uint32_t elapsed = MIN(now - throttle_time, MSEC_PER_SEC);
+
+	throttle_allowance = MIN(throttle_allowance + elapsed * CONFIG_RID_OUTPUT_THROTTLE_RATE,
+				 CONFIG_RID_OUTPUT_THROTTLE_RATE * MSEC_PER_SEC);
+	throttle_time = now;
+
+	return throttle_allowance / 1000;
+}
+
+const struct rid_output_backend rid_output_backend_throttle = {
+	.name = "throttle",
+	.write = throttle_write,
+	.write_space = throttle_write_space,
+};
+#endif
+
+#if defined(CONFIG_RID_OUTPUT_BACKEND_RTT)
+static const struct rid_output_backend *backend = &rid_output_backend_rtt;
+#elif defined(CONFIG_RID_OUTPUT_BACKEND_UART)
+static const struct rid_output_backend *backend = &rid_output_backend_uart;
+#elif defined(CONFIG_RID_OUTPUT_BACKEND_THROTTLE)
+static const struct rid_output_backend *backend = &rid_output_backend_throttle;
+#else
+static const struct rid_output_backend *backend;
+#endif
+
+void rid_output_set_backend(const struct rid_output_backend *new_backend)
+{
+	if (backend != NULL) {
+		rid_output_flush();
+	}
+	for (size_t i = 0; i < ARRAY_SIZE(queues); i++) {
+		ring_buf_reset(queues[i]);
+	}
+	current_left = 0;
+#if defined(CONFIG_RID_OUTPUT_PRIORITY)
+	repeats_taken = repeats_staged;
+	backed_up = false;
+#endif
+	backend = new_backend;
+}
+
+static size_t frames_staged(void)
+{
+	size_t staged = 0;
+
+	for (size_t i = ALERT_QUEUE + 1; i < ARRAY_SIZE(queues); i++) {
+		staged += ring_buf_size_get(queues[i]);
+	}
+
+	return staged;
+}
+
+#if defined(CONFIG_RID_OUTPUT_PRIORITY)
+static struct bucket *bucket_of(const uint8_t mac[6], uint32_t now)
+{
+	uint32_t h = sys_get_be32(&mac[2]) * 2654435761U;
+	struct bucket_set *set = &buckets[(h >> 16) & (BUCKET_SETS - 1)];
+	struct bucket *b = &set->way[0];
+
+	for (int w = 0; w < BUCKET_WAYS; w++) {
+		struct bucket *e = &set->way[w];
+
+		if (e->valid && memcmp(e->mac, mac, sizeof(e->mac)) == 0) {
+			e->tokens = MIN(e->tokens + MIN(now - e->refilled, BUCKET_FILL_MS) *
+						    CONFIG_RID_OUTPUT_RATE,
+					BUCKET_FULL);
+			e->refilled = now;
+			return e;
+		}
+		// a free way if there is one, else the least recently heard
+		if (!e->valid) {
+			b = e;
+		} else if (b->valid && (int32_t)(e->refilled - b->refilled) < 0) {
+			b = e;
+		}
+	}
+
+	memcpy(b->mac, mac, sizeof(b->mac));
+	b->valid = true;
+	b->tokens = BUCKET_FULL;
+	b->refilled = now;
+	b->repeat_seq = repeats_taken;
+
+	return b;
+}
+
+/* Whether to keep a frame of class prio from b's aircraft off the link. */
+static bool withhold(struct bucket *b, enum rid_output_prio prio)
+{
+	switch (prio) {
+	case RID_OUTPUT_PRIO_URGENT:
+		return false;
+	case RID_OUTPUT_PRIO_REPEAT:
+		// only sent when nothing else waits, so they do not take the aircraft's tokens
+		if ((int32_t)(b->repeat_seq - repeats_taken) > 0) {
+			stats.coalesced++;  // the one still staged says as much
+			return true;
+		}
+		return false;
+	default:
+		break;
+	}
+
+	if (b->tokens >= TOKEN) {
+		b->tokens -= TOKEN;
+		return false;
+	}
+	// out of tokens only matters while the link cannot keep up
+	if (backed_up) {
+		stats.rate_limited++;
+		return true;
+	}
+
+	return false;
+}
+#endif
+
+int rid_output_frame(const struct rid_frame *frame, int channel, int32_t air_ms,
+		     enum rid_output_prio prio)
+{
+	if (backend == NULL) {
+		return 0;
+	}
+
+#if defined(CONFIG_RID_OUTPUT_PRIORITY)
+	struct ring_buf *buf = queues[REPEAT_QUEUE - prio];
+	struct bucket *b = bucket_of(&frame->raw.data[10], frame->timestamp);
+
+	if (withhold(b, prio)) {
+		stats.shed[prio]++;
+		return -EBUSY;
+	}
+#else
+	struct ring_buf *buf = &staging;
+#endif
+
+	uint16_t frame_len = MIN((size_t)MAX(frame->raw.frame_length, 0), sizeof(frame->raw.data));
+	struct rid_record_hdr hdr = {
+		.sync = RID_RECORD_SYNC,
+		.type = RID_RECORD_FRAME,
+		.len = sys_cpu_to_le16(frame_len),
+		.timestamp = sys_cpu_to_le32(frame->timestamp),
+		.rssi = frame->raw.rssi,
+		.channel = (uint8_t)channel,
+		.frequency = sys_cpu_to_le16(frame->raw.frequency),
+	};
+	struct record_local local = {
+		.timestamp = frame->timestamp,
+		.air_ms = air_ms,
+	};
+	uint32_t needed = sizeof(local) + sizeof(hdr) + frame_len;
+
+	if (ring_buf_space_get(buf) < needed) {
+		rid_output_flush();
+		if (ring_buf_space_get(buf) < needed) {
+			stats.dropped++;
+			stats.shed[prio]++;
+			return -ENOMEM;
+		}
+	}
+
+	ring_buf_put(buf, (const uint8_t *)&local, sizeof(local));
+	ring_buf_put(buf, (const uint8_t *)&hdr, sizeof(hdr));
+	ring_buf_put(buf, frame->raw.data, frame_len);
+	stats.records++;
+#if defined(CONFIG_RID_OUTPUT_PRIORITY)
+	if (prio == RID_OUTPUT_PRIO_REPEAT) {
+		b->repeat_seq = ++repeats_staged;
+	}
+#endif
+
+	return 0;
+}
+
+int rid_output_alert(const struct rid_record_alert *alert, uint32_t timestamp, int32_t air_ms)
+{
+	if (backend == NULL) {
+		return 0;
+	}
+
+	struct rid_record_hdr hdr = {
+		.sync = RID_RECORD_SYNC,
+		.type = RID_RECORD_ALERT,
+		.len = sys_cpu_to_le16(sizeof(*alert)),
+		.timestamp = sys_cpu_to_le32(timestamp),
+	};
+	struct rid_record_alert payload = *alert;
+	struct record_local local = {
+		.timestamp = timestamp,
+		.air_ms = air_ms,
+	};
+
+	payload.zone = sys_cpu_to_le16(alert->zone);
+	payload.latitude = sys_cpu_to_le32(alert->latitude);
+	payload.longitude = sys_cpu_to_le32(alert->longitude);
+	payload.altitude = sys_cpu_to_le32(alert->altitude);
+
+	if (ring_buf_space_get(&alerts) < sizeof(local) + sizeof(hdr) + sizeof(payload)) {
+		stats.alerts_dropped++;
+		return -ENOMEM;
+	}
+	ring_buf_put(&alerts, (const uint8_t *)&local, sizeof(local));
+	ring_buf_put(&alerts, (const uint8_t *)&hdr, sizeof(hdr));
+	ring_buf_put(&alerts, (const uint8_t *)&payload, sizeof(payload));
+
+	rid_output_flush();
+
+	return 0;
+}
+
+/* Take the local part off the record at the head of buf, which must be at a
+ * record boundary, and return the length of the rest.
+ */
+static uint32_t head_record(struct ring_buf *buf, struct record_local *local)
+{
+	struct {
+		struct record_local local;
+		struct rid_record_hdr hdr;
+	} __packed head;
+
+	ring_buf_peek(buf, (uint8_t *)&head, sizeof(head));
+	ring_buf_get(buf, NULL, sizeof(head.local));
+	*local = head.local;
+
+	return sizeof(head.hdr) + sys_le16_to_cpu(head.hdr.len);
+}
+
+static void record_sent(enum rid_stage stage, enum rid_stage air_stage,
+			const struct record_local *local)
+{
+	uint32_t sent_ms = k_uptime_get_32() - local->timestamp;
+
+	rid_stats_record(stage, sent_ms);
+	if (local->air_ms >= 0) {
+		rid_stats_record(air_stage, local->air_ms + sent_ms);
+	}
+}
+
+/* The most urgent queue with a record waiting, or -1. */
+static int next_queue(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(queues); i++) {
+		if (!ring_buf_is_empty(queues[i])) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void flush(void)
+{
+	// no more than the backend said it could take when the flush began, so that a backend
+	// that always has room (the UART) is still only given a bounded chunk per flush
+	size_t budget = backend->write_space();
+
+	if (budget == 0) {
+		stats.stalls++;
+		return;
+	}
+
+	// one record at a time, so that alerts and more urgent frames can cut in between records
+	while (budget > 0) {
+		if (current_left == 0) {
+			int next = next_queue();
+
+			if (next < 0) {
+				return;
+			}
+			current = next;
+			current_left = head_record(queues[current], &current_local);
+#if defined(CONFIG_RID_OUTPUT_PRIORITY)
+			if (current == REPEAT_QUEUE) {
+				repeats_taken++;
+			}
+#endif
+		}
+
+		struct ring_buf *buf = queues[current];
+		uint8_t *data;
+		uint32_t claimed;
+		size_t written;
+
+		claimed = ring_buf_get_claim(buf, &data, MIN(budget, current_left));
+		written = backend->write(data, claimed);
+		ring_buf_get_finish(buf, written);
+		stats.bytes += written;
+		budget -= written;
+		current_left -= written;
+
+		if (current_left == 0 && current == ALERT_QUEUE) {
+			stats.alerts++;
+			record_sent(RID_STAGE_ALERT, RID_STAGE_AIR_ALERT, &current_local);
+		} else if (current_left == 0) {
+			record_sent(RID_STAGE_LINK, RID_STAGE_AIR_LINK, &current_local);
+		}
+		if (written < claimed) {
+			stats.stalls++;
+			return;
+		}
+	}
+}
+
+void rid_output_flush(void)
+{
+	if (backend == NULL) {
+		return;
+	}
+
+	flush();
+#if defined(CONFIG_RID_OUTPUT_PRIORITY)
+	backed_up = frames_staged() > 0;
+#endif
+}
+
+size_t rid_output_pending(void)
+{
+	return ring_buf_size_get(&alerts) + frames_staged();
+}
+
+void rid_output_get_stats(struct rid_output_stats *out)
+{
+	*out = stats;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Buffered binary output of matching raw frames
+ *
+ * Every record is a fixed little-endian header followed by the raw 802.11
+ * frame or, for alerts, a struct rid_record_alert. Records are staged in RAM
+ * and pushed to the backend in bulk, as far as the backend has room; alerts
+ * have their own staging buffer and go out ahead of any frames still
+ * waiting, at the next record boundary. scripts/rid_decode.py turns the
+ * stream back into text on the host.
+ *
+ * With CONFIG_RID_OUTPUT_PRIORITY every frame comes with a class, and each
+ * class has its own share of the staging buffer, drained most urgent first.
+ * While the backend leaves frames staged, every aircraft is held
+ * to CONFIG_RID_OUTPUT_RATE records per second (with bursts of
+ * CONFIG_RID_OUTPUT_BURST), and a repeat is dropped while one from the same
+ * aircraft still waits. New aircraft and geofence updates are never held
+ * back; everything withheld is counted by class.
+ */
+
+#ifndef RID_OUTPUT_H_
+#define RID_OUTPUT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#include "rid_ring.h"
+
+#define RID_RECORD_SYNC 0xA5
+
+enum rid_record_type {
+	RID_RECORD_FRAME = 1,
+	RID_RECORD_ALERT = 2,
+};
+
+/* How much a frame tells the host, least first. */
+enum rid_output_prio {
+	RID_OUTPUT_PRIO_REPEAT,     // nothing the track table had not already reported
+	RID_OUTPUT_PRIO_ROUTINE,    // new content or movement
+	RID_OUTPUT_PRIO_NEAR,       // the same from an aircraft at or above CONFIG_RID_OUTPUT_NEAR_RSSI
+	RID_OUTPUT_PRIO_URGENT,     // a new aircraft, or one inside or crossing a geofence zone
+	RID_OUTPUT_PRIO_COUNT,
+};
+
+struct rid_record_hdr {
+	uint8_t sync;           // RID_RECORD_SYNC, lets the host resynchronise mid-stream
+	uint8_t type;           // enum rid_record_type
+	uint16_t len;           // bytes following this header
+	uint32_t timestamp;     // ms since boot when the frame was received
+	int8_t rssi;
+	uint8_t channel;
+	uint16_t frequency;     // MHz
+} __packed;
+
+/* Payload of a RID_RECORD_ALERT record; rssi, channel and frequency in its header are 0. */
+struct rid_record_alert {
+	uint8_t event;          // enum rid_geofence_event_type
+	uint8_t subject;        // enum rid_geofence_subject
+	uint16_t zone;          // zone id
+	uint8_t mac[6];
+	int32_t latitude;       // 1e-7 degrees
+	int32_t longitude;      // 1e-7 degrees
+	int32_t altitude;       // decimetres
+} __packed;
+
+struct rid_output_backend {
+	const char *name;
+	/* Write up to len bytes without blocking, return how many were taken. */
+	size_t (*write)(const uint8_t *buf, size_t len);
+	/* Bytes the transport can take right now; a flush writes no more than
+	 * this, so it also bounds the time a flush blocks a polled transport.
+	 */
+	size_t (*write_space)(void);
+};
+
+struct rid_output_stats {
+	uint32_t records;   // records staged
+	uint32_t dropped;   // records discarded because the staging buffer was full
+	uint32_t bytes;     // bytes handed to the backend
+	uint32_t stalls;    // flushes that found the backend without room
+	uint32_t alerts;    // alert records handed to the backend
+	uint32_t alerts_dropped;
+	uint32_t rate_limited;  // frames withheld from aircraft over their share of a backed-up link
+	uint32_t coalesced;     // repeats withheld while one from the same aircraft was still staged
+	uint32_t shed[RID_OUTPUT_PRIO_COUNT];  // frames withheld or dropped, by class
+};
+
+extern const struct rid_output_backend rid_output_backend_rtt;
+extern const struct rid_output_backend rid_output_backend_uart;
+extern const struct rid_output_backend rid_output_backend_null;
+extern const struct rid_output_backend rid_output_backend_throttle;
+
+/* Attach a backend, or detach the sink entirely with NULL. */
+void rid_output_set_backend(const struct rid_output_backend *backend);
+
+/* Stage one received frame of class prio, whose position was air_ms old on
+ * reception (negative if unknown). Returns -ENOMEM if it was dropped or
+ * -EBUSY if it was withheld to make room on a backed-up link.
+ */
+int rid_output_frame(const struct rid_frame *frame, int channel, int32_t air_ms,
+		     enum rid_output_prio prio);
+
+/* Stage an alert about a frame received at timestamp, air_ms after its
+ * position was taken, and push it out right away, ahead of staged frames.
+ * Returns -ENOMEM if it was dropped.
+ */
+int rid_output_alert(const struct rid_record_alert *alert, uint32_t timestamp, int32_t air_ms);
+
+/* Push as much staged data to the backend as its write_space() allows. */
+void rid_output_flush(void);
+
+/* Bytes staged but not yet accepted by the backend. */
+size_t rid_output_pending(void);
+
+void rid_output_get_stats(struct rid_output_stats *stats);
+
+#endif /* RID_OUTPUT_H_ */
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Tokenizer shared by the text rule grammars
+ *
+ * Geofence zones (rid_geofence.h) and frame filter rules (rid_filter.h) are
+ * parsed a line at a time through a cursor over text that need not be NUL
+ * terminated. '#' starts a comment, lines with nothing but blanks are
+ * skipped, and tokens are separated by blanks and by whatever other
+ * characters the grammar adds.
+ */
+
+#ifndef RID_PARSE_H_
+#define RID_PARSE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+struct rid_cursor {
+	const char *p;
+	const char *end;
+	const char *separators;  // besides blanks, or NULL
+};
+
+static inline bool rid_is_separator(const struct rid_cursor *c, char ch)
+{
+	return ch == ' ' || ch == '\t' ||
+	       (c->separators != NULL && ch != '\0' && strchr(c->separators, ch) != NULL);
+}
+
+/* Take the next token off c. Returns false if only separators are left. */
+static inline bool rid_next_token(struct rid_cursor *c, const char **tok, size_t *len)
+{
+	while (c->p < c->end && rid_is_separator(c, *c->p)) {
+		c->p++;
+	}
+	*tok = c->p;
+	while (c->p < c->end && !rid_is_separator(c, *c->p)) {
+		c->p++;
+	}
+	*len = c->p - *tok;
+
+	return *len > 0;
+}
+
+static inline bool rid_token_is(const char *tok, size_t len, const char *word)
+{
+	return len == strlen(word) && memcmp(tok, word, len) == 0;
+}
+
+/* Cut c at a comment or line break and trim trailing blanks. Returns false
+ * if nothing is left to parse.
+ */
+static inline bool rid_content_line(struct rid_cursor *c)
+{
+	const char *tok;
+	size_t len;
+	struct rid_cursor peek;
+
+	for (const char *p = c->p; p < c->end; p++) {
+		if (*p == '#' || *p == '\r' || *p == '\n') {
+			c->end = p;
+			break;
+		}
+	}
+	while (c->end > c->p && (c->end[-1] == ' ' || c->end[-1] == '\t')) {
+		c->end--;
+	}
+	peek = *c;
+
+	return rid_next_token(&peek, &tok, &len);
+}
+
+#endif /* RID_PARSE_H_ */
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include "rid_ring.h"
+#include "rid_stats.h"
+
+BUILD_ASSERT((CONFIG_RID_RING_SIZE & (CONFIG_RID_RING_SIZE - 1)) == 0,
+	     "CONFIG_RID_RING_SIZE must be a power of two");
+
+#define RING_MASK (CONFIG_RID_RING_SIZE - 1)
+
+static struct rid_frame slots[CONFIG_RID_RING_SIZE];
+
+// free-running indices; head is only written by the producer, tail only by the consumer
+static atomic_t head;
+static atomic_t tail;
+
+static atomic_t pushed;
+static atomic_t dropped;
+static atomic_t high_water;
+
+// given by the producer when it fills a slot, so the consumer can sleep while the ring is empty
+static K_SEM_DEFINE(ring_ready, 0, 1);
+
+#if defined(CONFIG_ASSERT)
+// the thread of the first push, which has to make every push after it
+static atomic_ptr_t producer;
+#endif
+
+bool rid_ring_push(const struct wifi_raw_scan_result *raw, uint8_t radio)
+{
+#if defined(CONFIG_ASSERT)
+	atomic_ptr_cas(&producer, NULL, k_current_get());
+	__ASSERT(atomic_ptr_get(&producer) == k_current_get(),
+		 "rid_ring pushed from a second thread, two frame sources are running");
+#endif
+
+	uint32_t h = (uint32_t)atomic_get(&head);
+	uint32_t used = h - (uint32_t)atomic_get(&tail);
+
+	if (used >= CONFIG_RID_RING_SIZE) {
+		atomic_inc(&dropped);
+		return false;
+	}
+
+	slots[h & RING_MASK].timestamp = k_uptime_get_32();
+	slots[h & RING_MASK].cycles = rid_stats_start();
+	slots[h & RING_MASK].radio = radio;
+	memcpy(&slots[h & RING_MASK].raw, raw, sizeof(*raw));
+
+	// atomic_set() is a full barrier, so the slot contents are visible before the new head
+	atomic_set(&head, (atomic_val_t)(h + 1));
+	atomic_inc(&pushed);
+
+	used++;
+	if (used > (uint32_t)atomic_get(&high_water)) {
+		atomic_set(&high_water, (atomic_val_t)used);
+	}
+
+	k_sem_give(&ring_ready);
+
+	return true;
+}
+
+uint32_t rid_ring_wait(uint32_t max, k_timeout_t timeout)
+{
+	uint32_t avail = (uint32_t)atomic_get(&head) - (uint32_t)atomic_get(&tail);
+
+	if (avail == 0) {
+		if (k_sem_take(&ring_ready, timeout) != 0) {
+			return 0;
+		}
+		avail = (uint32_t)atomic_get(&head) - (uint32_t)atomic_get(&tail);
+	}
+
+	return MIN(avail, max);
+}
+
+const struct rid_frame *rid_ring_peek(uint32_t n)
+{
+	return &slots[((uint32_t)atomic_get(&tail) + n) & RING_MASK];
+}
+
+void rid_ring_release(uint32_t n)
+{
+	atomic_add(&tail, (atomic_val_t)n);
+}
+
+void rid_ring_get_stats(struct rid_ring_stats *stats)
+{
+	stats->pushed = (uint32_t)atomic_get(&pushed);
+	stats->dropped = (uint32_t)atomic_get(&dropped);
+	stats->high_water = (uint32_t)atomic_get(&high_water);
+	stats->depth = (uint32_t)atomic_get(&head) - (uint32_t)atomic_get(&tail);
+}
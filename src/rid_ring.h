@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Single-producer/single-consumer ring of raw scan results
+ *
+ * There is a single producer and the decoder thread is the only consumer, so
+ * the ring needs no locks: each side owns one index. The producer is the
+ * net_mgmt event callback while scanning, the monitor thread in monitor
+ * mode, or the main thread while it replays a capture, plays a pcap file or
+ * runs a benchmark. These modes exclude each other and none of them may run
+ * alongside scanning; main() starts exactly one, and with CONFIG_ASSERT a
+ * push from a second thread is caught.
+ */
+
+#ifndef RID_RING_H_
+#define RID_RING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/wifi_mgmt.h>
+
+/* One queued raw scan result together with the time it was received and the radio it came from. */
+struct rid_frame {
+	uint32_t timestamp;  // k_uptime_get_32() when the result reached the event callback
+	uint32_t cycles;     // rid_stats_start() at the same moment, for the time spent queued
+	uint8_t radio;       // see rid_scan.h
+	struct wifi_raw_scan_result raw;
+};
+
+struct rid_ring_stats {
+	uint32_t pushed;      // raw results accepted into the ring
+	uint32_t dropped;     // raw results rejected because the ring was full
+	uint32_t high_water;  // largest number of slots ever in use at once
+	uint32_t depth;       // slots in use right now
+};
+
+/* Copy a raw scan result received by radio into the next free slot and wake
+ * the consumer. Returns false (and counts a drop) if the ring is full.
+ * Producer side only.
+ */
+bool rid_ring_push(const struct wifi_raw_scan_result *raw, uint8_t radio);
+
+/* Block until at least one result is queued or the timeout expires, then
+ * return how many results (at most max) can be read with rid_ring_peek().
+ * Consumer side only.
+ */
+uint32_t rid_ring_wait(uint32_t max, k_timeout_t timeout);
+
+/* Return the n-th queued result, counted from the oldest one. The slot stays
+ * owned by the consumer until it is handed back with rid_ring_release().
+ */
+const struct rid_frame *rid_ring_peek(uint32_t n);
+
+/* Hand the n oldest slots back to the producer. */
+void rid_ring_release(uint32_t n);
+
+void rid_ring_get_stats(struct rid_ring_stats *stats);
+
+#endif /* RID_RING_H_ */
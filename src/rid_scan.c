@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/wifi_mgmt.h>
+
+#include "rid_duty.h"
+#include "rid_sched.h"
+#include "rid_scan.h"
+#include "rid_stats.h"
+
+LOG_MODULE_REGISTER(rid_scan, CONFIG_LOG_DEFAULT_LEVEL);
+
+struct scan_radio {
+	struct net_if *iface;
+	uint8_t index;
+	struct k_work_delayable work;
+
+	// the current state as a single BIT(enum rid_scan_state)
+	struct k_event events;
+	atomic_t state;
+
+	bool planned;
+	uint32_t backoff_ms;
+	uint32_t done_cycles;
+	bool done_cycles_valid;
+	uint32_t request_cycles;
+	uint32_t request_results;
+	uint32_t scan_us;
+	// set while waiting out a duty cycle gap, which a Remote ID frame may cut short
+	atomic_t gap_pending;
+	atomic_t results;
+
+	uint32_t start_time;
+	struct rid_scan_stats stats;
+	uint64_t gap_sum_us;
+	uint32_t gap_count;
+};
+
+static K_THREAD_STACK_DEFINE(scan_workq_stack, CONFIG_RID_SCAN_WORKQ_STACK_SIZE);
+static struct k_work_q scan_workq;
+
+static struct scan_radio radios[CONFIG_RID_SCAN_RADIOS];
+static int radio_count;
+
+static struct scan_radio *find_radio(struct net_if *iface)
+{
+	for (int i = 0; i < radio_count; i++) {
+		if (radios[i].iface == iface) {
+			return &radios[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void set_state(struct scan_radio *radio, enum rid_scan_state state)
+{
+	atomic_set(&radio->state, state);
+	k_event_set(&radio->events, BIT(state));
+}
+
+/* Move from one state to another unless someone else moved first. */
+static bool change_state(struct scan_radio *radio, enum rid_scan_state from,
+			 enum rid_scan_state to)
+{
+	if (!atomic_cas(&radio->state, from, to)) {
+		return false;
+	}
+	k_event_set(&radio->events, BIT(to));
+
+	return true;
+}
+
+static void request_scan(struct scan_radio *radio)
+{
+	struct wifi_scan_params params;
+	int ret;
+
+	if (radio->done_cycles_valid) {
+		uint32_t gap_us = k_cyc_to_us_floor32(k_cycle_get_32() - radio->done_cycles);
+
+		radio->gap_sum_us += gap_us;
+		radio->gap_count++;
+		radio->stats.gap_max_us = MAX(radio->stats.gap_max_us, gap_us);
+		radio->done_cycles_valid = false;
+	}
+
+	// one channel per request from the radio's share of the scan plan; a full
+	// sweep if there is no usable plan
+	if (radio->planned) {
+		rid_sched_next(radio->index, &params, k_uptime_get_32());
+	}
+
+	radio->request_results = atomic_get(&radio->results);
+	radio->request_cycles = k_cycle_get_32();
+
+	// arm the watchdog first, so a done event arriving at any point after the
+	// request overrides it rather than the other way around
+	set_state(radio, RID_SCAN_REQUESTED);
+	k_work_reschedule_for_queue(&scan_workq, &radio->work, K_MSEC(CONFIG_RID_SCAN_TIMEOUT_MS));
+
+	ret = net_mgmt(NET_REQUEST_WIFI_SCAN, radio->iface, radio->planned ? &params : NULL,
+		       radio->planned ? sizeof(params) : 0);
+	if (ret) {
+		LOG_ERR("Scan request on radio %u failed (%d)", radio->index, ret);
+		if (change_state(radio, RID_SCAN_REQUESTED, RID_SCAN_FAILED)) {
+			radio->stats.failures++;
+			k_work_reschedule_for_queue(&scan_workq, &radio->work, K_NO_WAIT);
+		}
+		return;
+	}
+
+	change_state(radio, RID_SCAN_REQUESTED, RID_SCAN_SCANNING);
+}
+
+static void scan_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct scan_radio *radio = CONTAINER_OF(dwork, struct scan_radio, work);
+
+	switch ((enum rid_scan_state)atomic_get(&radio->state)) {
+	case RID_SCAN_SCANNING:
+	case RID_SCAN_REQUESTED:
+		// the watchdog fired: the driver never reported the end of the scan
+		if (!change_state(radio, RID_SCAN_SCANNING, RID_SCAN_FAILED) &&
+		    !change_state(radio, RID_SCAN_REQUESTED, RID_SCAN_FAILED)) {
+			break;  // the done event won the race and has rescheduled us
+		}
+		radio->stats.timeouts++;
+		LOG_WRN("Scan on radio %u did not complete within %d ms", radio->index,
+			CONFIG_RID_SCAN_TIMEOUT_MS);
+		__fallthrough;
+	case RID_SCAN_FAILED:
+		radio->backoff_ms = radio->backoff_ms == 0
+					    ? CONFIG_RID_SCAN_RETRY_MIN_MS
+					    : MIN(radio->backoff_ms * 2, CONFIG_RID_SCAN_RETRY_MAX_MS);
+		radio->stats.backoff_ms = radio->backoff_ms;
+		set_state(radio, RID_SCAN_IDLE);
+		k_work_reschedule_for_queue(&scan_workq, &radio->work, K_MSEC(radio->backoff_ms));
+		break;
+	case RID_SCAN_DONE: {
+		uint32_t gap_ms = rid_duty_scan_done(radio->index, k_uptime_get_32(), radio->scan_us);
+
+		radio->backoff_ms = 0;
+		radio->stats.backoff_ms = 0;
+		if (gap_ms > 0) {
+			// the radio rests on purpose, which is not a gap worth reporting
+			radio->done_cycles_valid = false;
+			set_state(radio, RID_SCAN_IDLE);
+			k_work_reschedule_for_queue(&scan_workq, &radio->work, K_MSEC(gap_ms));
+			atomic_set(&radio->gap_pending, 1);
+			// a frame may have switched to active mode before the gap was pending
+			if (rid_duty_active()) {
+				rid_scan_kick();
+			}
+			break;
+		}
+		__fallthrough;
+	}
+	case RID_SCAN_IDLE:
+		atomic_clear(&radio->gap_pending);
+		request_scan(radio);
+		break;
+	}
+}
+
+static void add_radio(struct net_if *iface, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	if (!net_if_is_wifi(iface)) {
+		return;
+	}
+	if (radio_count == CONFIG_RID_SCAN_RADIOS) {
+		LOG_INF("Not scanning with interface %d, CONFIG_RID_SCAN_RADIOS is %d",
+			net_if_get_by_iface(iface), CONFIG_RID_SCAN_RADIOS);
+		return;
+	}
+
+	struct scan_radio *radio = &radios[radio_count];
+
+	radio->iface = iface;
+	radio->index = radio_count++;
+	radio->stats.ifindex = net_if_get_by_iface(iface);
+}
+
+int rid_scan_start(void)
+{
+	net_if_foreach(add_radio, NULL);
+	if (radio_count == 0) {
+		LOG_ERR("No Wi-Fi interface to scan with");
+		return -ENODEV;
+	}
+
+	bool planned = rid_sched_init(radio_count) > 0;
+	uint32_t now = k_uptime_get_32();
+
+	rid_duty_init(now, radio_count);
+
+	k_work_queue_start(&scan_workq, scan_workq_stack, K_THREAD_STACK_SIZEOF(scan_workq_stack),
+			   CONFIG_RID_SCAN_WORKQ_PRIORITY, NULL);
+	k_thread_name_set(&scan_workq.thread, "rid_scan");
+
+	int scanning = 0;
+
+	for (int i = 0; i < radio_count; i++) {
+		struct scan_radio *radio = &radios[i];
+
+		radio->planned = planned;
+		radio->start_time = now;
+		k_event_init(&radio->events);
+		k_work_init_delayable(&radio->work, scan_work_handler);
+		set_state(radio, RID_SCAN_IDLE);
+
+		// without a plan every radio would sweep the same bands, so only the first one does
+		if (planned ? rid_sched_radio_channels(i) == 0 : i > 0) {
+			LOG_WRN("Radio %u (interface %d) has no channel to scan", i, radio->stats.ifindex);
+			continue;
+		}
+		LOG_INF("Radio %u scanning with interface %d, %d channels", i, radio->stats.ifindex,
+			planned ? rid_sched_radio_channels(i) : 0);
+		k_work_reschedule_for_queue(&scan_workq, &radio->work, K_NO_WAIT);
+		scanning++;
+	}
+
+	return scanning;
+}
+
+void rid_scan_done(struct net_if *iface, int status)
+{
+	struct scan_radio *radio = find_radio(iface);
+	enum rid_scan_state next = status ? RID_SCAN_FAILED : RID_SCAN_DONE;
+
+	// a scan we did not request (e.g. from the wifi shell) is none of our business
+	if (radio == NULL || (!change_state(radio, RID_SCAN_SCANNING, next) &&
+			      !change_state(radio, RID_SCAN_REQUESTED, next))) {
+		return;
+	}
+
+	if (status) {
+		LOG_ERR("Scan on radio %u failed (%d)", radio->index, status);
+		radio->stats.failures++;
+	} else {
+		radio->stats.scans++;
+		radio->done_cycles = k_cycle_get_32();
+		radio->done_cycles_valid = true;
+		radio->scan_us = k_cyc_to_us_floor32(radio->done_cycles - radio->request_cycles);
+		rid_stats_record(RID_STAGE_SCAN, radio->scan_us);
+		rid_stats_record(RID_STAGE_SCAN_RESULTS,
+				 atomic_get(&radio->results) - radio->request_results);
+	}
+	k_work_reschedule_for_queue(&scan_workq, &radio->work, K_NO_WAIT);
+}
+
+uint8_t rid_scan_result(struct net_if *iface)
+{
+	struct scan_radio *radio = find_radio(iface);
+
+	if (radio == NULL) {
+		return 0;
+	}
+	atomic_inc(&radio->results);
+
+	return radio->index;
+}
+
+void rid_scan_hit(uint8_t radio)
+{
+	if (radio < radio_count) {
+		radios[radio].stats.hits++;
+	}
+}
+
+void rid_scan_kick(void)
+{
+	// only ever cuts a duty cycle gap short, never a retry backoff or a scan in flight
+	for (int i = 0; i < radio_count; i++) {
+		if (atomic_cas(&radios[i].gap_pending, 1, 0)) {
+			k_work_reschedule_for_queue(&scan_workq, &radios[i].work, K_NO_WAIT);
+		}
+	}
+}
+
+uint32_t rid_scan_wait(int radio, uint32_t mask, k_timeout_t timeout)
+{
+	if (radio < 0 || radio >= radio_count) {
+		return 0;
+	}
+
+	return k_event_wait(&radios[radio].events, mask, false, timeout);
+}
+
+int rid_scan_radio_count(void)
+{
+	return radio_count;
+}
+
+int rid_scan_get_stats(int n, struct rid_scan_stats *out)
+{
+	if (n < 0 || n >= radio_count) {
+		return -EINVAL;
+	}
+
+	const struct scan_radio *radio = &radios[n];
+	uint32_t elapsed_ms = k_uptime_get_32() - radio->start_time;
+
+	*out = radio->stats;
+	out->state = atomic_get(&radio->state);
+	out->gap_avg_us = radio->gap_count ? radio->gap_sum_us / radio->gap_count : 0;
+	out->results = atomic_get(&radio->results);
+	out->scans_per_100s = elapsed_ms ? (uint64_t)out->scans * 100 * MSEC_PER_SEC / elapsed_ms : 0;
+
+	return 0;
+}
+
+const char *rid_scan_state_txt(enum rid_scan_state state)
+{
+	switch (state) {
+	case RID_SCAN_IDLE:
+		return "idle";
+	case RID_SCAN_REQUESTED:
+		return "requested";
+	case RID_SCAN_SCANNING:
+		return "scanning";
+	case RID_SCAN_DONE:
+		return "done";
+	case RID_SCAN_FAILED:
+		return "failed";
+	}
+
+	return "unknown";
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Scan lifecycle
+ *
+ * Scans are requested back to back from a dedicated work queue. The
+ * NET_EVENT_WIFI_SCAN_DONE handler hands the result to rid_scan_done(), which
+ * posts the new state and kicks the work item, so the next request goes out
+ * as soon as the previous scan ends, or after the gap set by the duty cycle
+ * (see rid_duty.h). Failed or lost scans are retried with exponential backoff.
+ *
+ * Every Wi-Fi interface, up to CONFIG_RID_SCAN_RADIOS, is a radio with a
+ * lifecycle of its own and its own share of the scan plan (see rid_sched.h),
+ * so the radios scan different channels at the same time. Their results go
+ * into the same queue, tagged with the radio they came from.
+ */
+
+#ifndef RID_SCAN_H_
+#define RID_SCAN_H_
+
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/net_if.h>
+
+enum rid_scan_state {
+	RID_SCAN_IDLE,       // nothing in flight, next request is due or waiting for a retry
+	RID_SCAN_REQUESTED,  // request being handed to the driver
+	RID_SCAN_SCANNING,   // driver accepted the request, waiting for NET_EVENT_WIFI_SCAN_DONE
+	RID_SCAN_DONE,       // last scan succeeded
+	RID_SCAN_FAILED,     // last request was rejected, reported a failure or timed out
+};
+
+struct rid_scan_stats {
+	int ifindex;              // of the interface the radio scans with
+	enum rid_scan_state state;
+	uint32_t scans;           // scans completed successfully
+	uint32_t failures;        // requests rejected or scans reported failed
+	uint32_t timeouts;        // scans that never reported done
+	uint32_t backoff_ms;      // delay before the next retry, 0 while scans succeed
+	uint32_t gap_avg_us;      // time between a scan ending and the next one being requested
+	uint32_t gap_max_us;
+	uint32_t results;         // raw scan results received
+	uint32_t hits;            // of those, Remote ID frames
+	uint32_t scans_per_100s;  // since the radio started
+};
+
+/* Find the Wi-Fi interfaces, start the work queue and request the first
+ * scan on each. Returns the number of radios scanning.
+ */
+int rid_scan_start(void);
+
+/* Report the end of a scan on iface; status is the one of
+ * NET_EVENT_WIFI_SCAN_DONE. Called from the net_mgmt event callback.
+ */
+void rid_scan_done(struct net_if *iface, int status);
+
+/* Count a raw scan result received on iface and return the radio it belongs
+ * to, 0 for an interface that is not one of ours.
+ */
+uint8_t rid_scan_result(struct net_if *iface);
+
+/* Count a Remote ID frame received by radio. */
+void rid_scan_hit(uint8_t radio);
+
+/* Request the next scan now on every radio waiting out a duty cycle gap.
+ * Safe to call from any thread.
+ */
+void rid_scan_kick(void);
+
+/* Wait until the lifecycle of radio enters one of the states in mask (a
+ * BIT() per enum rid_scan_state). Returns the matching state bits, or 0 on
+ * timeout.
+ */
+uint32_t rid_scan_wait(int radio, uint32_t mask, k_timeout_t timeout);
+
+int rid_scan_radio_count(void);
+
+/* Fill stats for radio. Returns -EINVAL if there is no such radio. */
+int rid_scan_get_stats(int radio, struct rid_scan_stats *stats);
+
+const char *rid_scan_state_txt(enum rid_scan_state state);
+
+#endif /* RID_SCAN_H_ */
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "rid_sched.h"
+
+LOG_MODULE_REGISTER(rid_sched, CONFIG_LOG_DEFAULT_LEVEL);
+
+// smoothed hits per scan are kept in 1/256 units
+#define EWMA_SHIFT 8
+// each scan moves the average 1/8 of the way towards its own hit count
+#define EWMA_GAIN  3
+
+struct plan_entry {
+	uint8_t radio;
+	uint8_t channel;
+	uint8_t band;
+	uint16_t dwell_ms;
+	uint16_t base_weight;
+	uint16_t weight;
+	int32_t current;          // smooth weighted round robin credit
+
+	atomic_t pending_hits;    // frames counted since the channel's last scan was folded in
+	uint32_t hits;
+	uint32_t hit_avg;         // hits per scan, EWMA, 1/256 units
+
+	uint32_t scans;
+	uint32_t last_start;
+	uint32_t revisit_sum;
+	uint32_t revisit_max;
+};
+
+static struct plan_entry plan[CONFIG_RID_SCAN_PLAN_MAX];
+static int plan_size;
+static int radio_count;
+static struct plan_entry *last_scanned[CONFIG_RID_SCAN_RADIOS];
+
+static K_MUTEX_DEFINE(sched_lock);
+
+static int channel_to_frequency(uint8_t band, uint8_t channel)
+{
+	if (band == WIFI_FREQ_BAND_2_4_GHZ) {
+		return channel == 14 ? 2484 : 2407 + channel * 5;
+	}
+
+	return 5000 + channel * 5;
+}
+
+static struct plan_entry *find_frequency(uint16_t frequency)
+{
+	for (int i = 0; i < plan_size; i++) {
+		if (channel_to_frequency(plan[i].band, plan[i].channel) == frequency) {
+			return &plan[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Spread CONFIG_RID_SCAN_ADAPT_PERCENT of the base weight of the channels of
+ * radio over them in proportion to the traffic seen on them. Base weights
+ * stay as they are, so no channel is ever starved of scans.
+ */
+static void update_weights(int radio)
+{
+	uint32_t base_sum = 0;
+	uint32_t hit_sum = 0;
+
+	for (int i = 0; i < plan_size; i++) {
+		if (plan[i].radio == radio) {
+			base_sum += plan[i].base_weight;
+			hit_sum += plan[i].hit_avg;
+		}
+	}
+
+	uint32_t share = base_sum * CONFIG_RID_SCAN_ADAPT_PERCENT / 100;
+
+	for (int i = 0; i < plan_size; i++) {
+		if (plan[i].radio != radio) {
+			continue;
+		}
+
+		uint32_t bonus = hit_sum == 0 ? 0 : (uint64_t)share * plan[i].hit_avg / hit_sum;
+
+		plan[i].weight = plan[i].base_weight + bonus;
+	}
+}
+
+/* Hand the heaviest channels out first, each to the radio with the least
+ * weight so far; the lighter ones then even out the shares.
+ */
+static void split_plan(void)
+{
+	uint32_t load[CONFIG_RID_SCAN_RADIOS] = { 0 };
+	bool assigned[CONFIG_RID_SCAN_PLAN_MAX] = { false };
+
+	for (int n = 0; n < plan_size; n++) {
+		struct plan_entry *heaviest = NULL;
+		int radio = 0;
+
+		for (int i = 0; i < plan_size; i++) {
+			if (!assigned[i] && (heaviest == NULL || plan[i].base_weight > heaviest->base_weight)) {
+				heaviest = &plan[i];
+			}
+		}
+		for (int r = 1; r < radio_count; r++) {
+			if (load[r] < load[radio]) {
+				radio = r;
+			}
+		}
+		assigned[heaviest - plan] = true;
+		heaviest->radio = radio;
+		load[radio] += heaviest->base_weight;
+	}
+
+	for (int r = 0; r < radio_count; r++) {
+		LOG_DBG("radio %d: %d channels, weight %u", r, rid_sched_radio_channels(r), load[r]);
+	}
+}
+
+/* Fold the hits counted since the previous scan of e into its average. */
+static void fold_hits(struct plan_entry *e)
+{
+	uint32_t hits = atomic_clear(&e->pending_hits);
+
+	e->hits += hits;
+	e->hit_avg = e->hit_avg - (e->hit_avg >> EWMA_GAIN) +
+		     ((hits << EWMA_SHIFT) >> EWMA_GAIN);
+}
+
+/* Parse one "channel:weight[:dwell]" entry. */
+static int parse_entry(const char *s, struct plan_entry *e)
+{
+	char *end;
+	unsigned long channel = strtoul(s, &end, 10);
+	unsigned long weight = 1;
+	unsigned long dwell = CONFIG_RID_SCAN_DWELL_MS;
+
+	if (*end == ':') {
+		weight = strtoul(end + 1, &end, 10);
+	}
+	if (*end == ':') {
+		dwell = strtoul(end + 1, &end, 10);
+	}
+	if ((*end != ',' && *end != '\0') || weight == 0 || weight > UINT8_MAX ||
+	    dwell == 0 || dwell > UINT16_MAX) {
+		return -EINVAL;
+	}
+
+	if (channel >= 1 && channel <= 14) {
+		e->band = WIFI_FREQ_BAND_2_4_GHZ;
+	} else if (channel >= 32 && channel <= 177) {
+		e->band = WIFI_FREQ_BAND_5_GHZ;
+	} else {
+		return -EINVAL;
+	}
+	e->channel = channel;
+	e->base_weight = weight;
+	e->weight = weight;
+	e->dwell_ms = dwell;
+
+	return 0;
+}
+
+int rid_sched_init(int radios)
+{
+	const char *s = CONFIG_RID_SCAN_PLAN;
+
+	plan_size = 0;
+	radio_count = CLAMP(radios, 1, CONFIG_RID_SCAN_RADIOS);
+	memset(last_scanned, 0, sizeof(last_scanned));
+
+	while (*s != '\0' && plan_size < CONFIG_RID_SCAN_PLAN_MAX) {
+		struct plan_entry *e = &plan[plan_size];
+
+		memset(e, 0, sizeof(*e));
+		if (parse_entry(s, e) == 0) {
+			plan_size++;
+		} else {
+			LOG_WRN("Ignoring scan plan entry \"%s\"", s);
+		}
+		s = strchr(s, ',');
+		if (s == NULL) {
+			break;
+		}
+		s++;
+	}
+
+	if (plan_size == 0) {
+		LOG_ERR("Scan plan \"%s\" has no valid channel", CONFIG_RID_SCAN_PLAN);
+		return -EINVAL;
+	}
+	split_plan();
+
+	return plan_size;
+}
+
+int rid_sched_next(int radio, struct wifi_scan_params *params, uint32_t now)
+{
+	k_mutex_lock(&sched_lock, K_FOREVER);
+
+	if (last_scanned[radio] != NULL) {
+		fold_hits(last_scanned[radio]);
+		update_weights(radio);
+	}
+
+	// smooth weighted round robin over the radio's channels: every channel earns
+	// its weight in credit, the richest one is scanned and pays back the total
+	struct plan_entry *best = NULL;
+	int32_t total = 0;
+
+	for (int i = 0; i < plan_size; i++) {
+		if (plan[i].radio != radio) {
+			continue;
+		}
+		plan[i].current += plan[i].weight;
+		total += plan[i].weight;
+		if (best == NULL || plan[i].current > best->current) {
+			best = &plan[i];
+		}
+	}
+	if (best == NULL) {
+		k_mutex_unlock(&sched_lock);
+		return -ENOENT;
+	}
+	best->current -= total;
+
+	if (best->scans > 0) {
+		uint32_t revisit = now - best->last_start;
+
+		best->revisit_sum += revisit;
+		best->revisit_max = MAX(best->revisit_max, revisit);
+	}
+	best->last_start = now;
+	best->scans++;
+	last_scanned[radio] = best;
+
+	memset(params, 0, sizeof(*params));
+	params->scan_type = IS_ENABLED(CONFIG_RID_SCAN_PASSIVE) ? WIFI_SCAN_TYPE_PASSIVE
+								 : WIFI_SCAN_TYPE_ACTIVE;
+	params->bands = BIT(best->band);
+	params->dwell_time_active = best->dwell_ms;
+	params->dwell_time_passive = best->dwell_ms;
+	params->band_chan[0].band = best->band;
+	params->band_chan[0].channel = best->channel;
+
+	k_mutex_unlock(&sched_lock);
+
+	return 0;
+}
+
+void rid_sched_hit(uint16_t frequency)
+{
+	struct plan_entry *e = find_frequency(frequency);
+
+	if (e != NULL) {
+		atomic_inc(&e->pending_hits);
+	}
+}
+
+int rid_sched_channel_count(void)
+{
+	return plan_size;
+}
+
+int rid_sched_radio_channels(int radio)
+{
+	int count = 0;
+
+	for (int i = 0; i < plan_size; i++) {
+		count += plan[i].radio == radio;
+	}
+
+	return count;
+}
+
+int rid_sched_get_stats(int n, struct rid_sched_stats *stats)
+{
+	if (n < 0 || n >= plan_size) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&sched_lock, K_FOREVER);
+
+	const struct plan_entry *e = &plan[n];
+
+	stats->radio = e->radio;
+	stats->channel = e->channel;
+	stats->band = e->band;
+	stats->dwell_ms = e->dwell_ms;
+	stats->base_weight = e->base_weight;
+	stats->weight = e->weight;
+	stats->scans = e->scans;
+	stats->hits = e->hits + atomic_get(&e->pending_hits);
+	stats->hits_per_100 = (e->hit_avg * 100) >> EWMA_SHIFT;
+	stats->revisit_avg_ms = e->scans > 1 ? e->revisit_sum / (e->scans - 1) : 0;
+	stats->revisit_max_ms = e->revisit_max;
+
+	k_mutex_unlock(&sched_lock);
+
+	return 0;
+}
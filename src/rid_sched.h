@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Weighted channel-dwell scan scheduler
+ *
+ * Instead of full-band sweeps, every scan request covers a single channel
+ * from the plan in CONFIG_RID_SCAN_PLAN. Channels are picked by smooth
+ * weighted round robin, so a channel with 70% of the weight gets 70% of the
+ * scans, evenly spread out. CONFIG_RID_SCAN_ADAPT_PERCENT of the total
+ * weight follows the Remote ID traffic actually seen on each channel.
+ *
+ * With several radios, the plan is split between them by weight, so that
+ * every radio gets about the same share of the work and every channel is
+ * scanned by exactly one radio. Each radio runs its own round robin over its
+ * channels.
+ */
+
+#ifndef RID_SCHED_H_
+#define RID_SCHED_H_
+
+#include <stdint.h>
+
+#include <zephyr/net/wifi_mgmt.h>
+
+struct rid_sched_stats {
+	uint8_t radio;           // the one scanning the channel
+	uint8_t channel;
+	uint8_t band;            // enum wifi_frequency_bands
+	uint16_t dwell_ms;
+	uint16_t base_weight;    // from the plan
+	uint16_t weight;         // base weight plus the adaptive share
+	uint32_t scans;
+	uint32_t hits;           // Remote ID frames received on the channel
+	uint32_t hits_per_100;   // Remote ID frames per 100 scans, smoothed
+	uint32_t revisit_avg_ms; // time between the starts of two scans of the channel
+	uint32_t revisit_max_ms;
+};
+
+/* Parse CONFIG_RID_SCAN_PLAN and split it between radios. Returns the number
+ * of channels in the plan, or -EINVAL if it holds no valid entry.
+ */
+int rid_sched_init(int radios);
+
+/* Pick the next channel of radio and fill params with a single-channel scan
+ * request for it. now is the time the scan is about to start (ms since boot).
+ * Returns -ENOENT if the radio was left without a channel.
+ */
+int rid_sched_next(int radio, struct wifi_scan_params *params, uint32_t now);
+
+/* Count a Remote ID frame received on frequency (MHz). Safe to call from any
+ * thread.
+ */
+void rid_sched_hit(uint16_t frequency);
+
+int rid_sched_channel_count(void);
+
+/* Number of channels in the share of radio. */
+int rid_sched_radio_channels(int radio);
+
+/* Fill stats for the n-th channel of the plan. Returns -EINVAL if n is out of range. */
+int rid_sched_get_stats(int n, struct rid_sched_stats *stats);
+
+#endif /* RID_SCHED_H_ */
@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief "wifi rid" shell commands
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+#include "rid_auth.h"
+#include "rid_capture.h"
+#include "rid_clock.h"
+#include "rid_dedup.h"
+#include "rid_duty.h"
+#include "rid_filter.h"
+#include "rid_geofence.h"
+#include "rid_motion.h"
+#include "rid_ring.h"
+#include "rid_scan.h"
+#include "rid_stats.h"
+#include "rid_track.h"
+
+#if defined(CONFIG_RID_STATS)
+static int cmd_rid_stats(const struct shell *sh, size_t argc, char *argv[])
+{
+	uint64_t elapsed_us = MAX(rid_stats_elapsed_us(), 1);
+
+	shell_print(sh, "%-13s %8s %10s %10s %10s %10s", "stage", "count", "p50", "p99", "max", "per s");
+	for (int stage = 0; stage < RID_STAGE_COUNT; stage++) {
+		struct rid_stage_summary s;
+
+		rid_stats_summary(stage, &s);
+		shell_print(sh, "%-13s %8u %8u%-2s %8u%-2s %8u%-2s %10u",
+			    s.name, s.count, s.p50, s.unit, s.p99, s.unit, s.max, s.unit,
+			    (uint32_t)(s.count * (uint64_t)USEC_PER_SEC / elapsed_us));
+	}
+
+	struct rid_ring_stats ring;
+
+	rid_ring_get_stats(&ring);
+	shell_print(sh, "over %u s: ring pushed %u dropped %u high-water %u/%u",
+		    (uint32_t)(elapsed_us / USEC_PER_SEC), ring.pushed, ring.dropped,
+		    ring.high_water, CONFIG_RID_RING_SIZE);
+
+	for (int i = 0; i < rid_scan_radio_count(); i++) {
+		struct rid_scan_stats scan;
+
+		rid_scan_get_stats(i, &scan);
+		shell_print(sh, "scan %d (if %d): %s, done %u (%u.%02u/s) failed %u timed out %u "
+			    "gap avg %u max %u us, results %u hits %u",
+			    i, scan.ifindex, rid_scan_state_txt(scan.state), scan.scans,
+			    scan.scans_per_100s / 100, scan.scans_per_100s % 100, scan.failures,
+			    scan.timeouts, scan.gap_avg_us, scan.gap_max_us, scan.results, scan.hits);
+	}
+
+#if defined(CONFIG_RID_DEDUP)
+	struct rid_dedup_stats dedup;
+
+	rid_dedup_get_stats(&dedup);
+	shell_print(sh, "dedup: repeats %u new %u evicted %u, output bytes saved %u",
+		    dedup.hits, dedup.misses, dedup.evictions, dedup.saved_bytes);
+#endif
+
+	struct rid_duty_stats duty;
+
+	rid_duty_get_stats(&duty);
+	shell_print(sh, "duty: %s, radio on %u of %u s, avg %u uA, %u mJ, escalations %u",
+		    rid_duty_mode_txt(duty.mode), duty.radio_ms / MSEC_PER_SEC,
+		    duty.elapsed_ms / MSEC_PER_SEC, duty.avg_current_ua, duty.energy_mj,
+		    duty.escalations);
+	shell_print(sh, "detect: %u aircraft, %u mJ each, latency avg %u max %u ms",
+		    duty.detections, duty.energy_per_detection_mj, duty.latency_avg_ms,
+		    duty.latency_max_ms);
+
+	return 0;
+}
+
+static int cmd_rid_stats_reset(const struct shell *sh, size_t argc, char *argv[])
+{
+	rid_stats_reset();
+	shell_print(sh, "Stage histograms cleared");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(rid_stats_cmds,
+	SHELL_CMD_ARG(reset, NULL, "Clear the stage histograms", cmd_rid_stats_reset, 1, 0),
+	SHELL_SUBCMD_SET_END
+);
+
+#endif /* CONFIG_RID_STATS */
+
+#if defined(CONFIG_RID_CAPTURE)
+static int cmd_rid_capture(const struct shell *sh, size_t argc, char *argv[])
+{
+	struct rid_capture_stats stats;
+
+	rid_capture_get_stats(&stats);
+	shell_print(sh, "records %u bytes %u overwritten %u errors %u",
+		    stats.records, stats.bytes, stats.overwritten, stats.errors);
+
+	return 0;
+}
+
+static int cmd_rid_capture_start(const struct shell *sh, size_t argc, char *argv[])
+{
+	rid_capture_set_enabled(true);
+
+	return 0;
+}
+
+static int cmd_rid_capture_stop(const struct shell *sh, size_t argc, char *argv[])
+{
+	rid_capture_set_enabled(false);
+
+	return 0;
+}
+
+static int cmd_rid_capture_clear(const struct shell *sh, size_t argc, char *argv[])
+{
+	rid_capture_clear();
+
+	return 0;
+}
+
+/* Hex lines, "offset: bytes", which scripts/rid_capture.py --hex reads back. */
+static int cmd_rid_capture_dump(const struct shell *sh, size_t argc, char *argv[])
+{
+	uint8_t buf[32];
+	char line[2 * sizeof(buf) + 1];
+	size_t offset = 0;
+	size_t n;
+
+	while ((n = rid_capture_read(offset, buf, sizeof(buf))) > 0) {
+		bin2hex(buf, n, line, sizeof(line));
+		shell_print(sh, "%08x: %s", (uint32_t)offset, line);
+		offset += n;
+	}
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(rid_capture_cmds,
+	SHELL_CMD_ARG(start, NULL, "Resume capturing", cmd_rid_capture_start, 1, 0),
+	SHELL_CMD_ARG(stop, NULL, "Pause capturing", cmd_rid_capture_stop, 1, 0),
+	SHELL_CMD_ARG(clear, NULL, "Discard the capture", cmd_rid_capture_clear, 1, 0),
+	SHELL_CMD_ARG(dump, NULL, "Print the RAM capture as hex", cmd_rid_capture_dump, 1, 0),
+	SHELL_SUBCMD_SET_END
+);
+#endif /* CONFIG_RID_CAPTURE */
+
+#if defined(CONFIG_RID_FILTER) || defined(CONFIG_RID_GEOFENCE)
+/* The shell splits a rule or zone into words; put them back together for the parser. */
+static int join_args(size_t argc, char *argv[], char *buf, size_t size)
+{
+	size_t len = 0;
+
+	for (size_t i = 1; i < argc; i++) {
+		size_t n = strlen(argv[i]);
+
+		if (len + n + 2 > size) {
+			return -EINVAL;
+		}
+		memcpy(&buf[len], argv[i], n);
+		len += n;
+		buf[len++] = ' ';
+	}
+	buf[len] = '\0';
+
+	return 0;
+}
+#endif
+
+#if defined(CONFIG_RID_FILTER)
+static void print_rule(const struct rid_filter_rule_info *rule, void *user)
+{
+	const struct shell *sh = user;
+
+	shell_print(sh, "%3u %10u  %s", rule->index, rule->hits, rule->text);
+}
+
+static int cmd_rid_filter(const struct shell *sh, size_t argc, char *argv[])
+{
+	struct rid_filter_stats stats;
+
+	rid_filter_foreach(print_rule, (void *)sh);
+	rid_filter_get_stats(&stats);
+	shell_print(sh, "rules %u/%u predicates %u/%u frames %u dropped %u unmatched %u",
+		    stats.rules, CONFIG_RID_FILTER_MAX_RULES, stats.predicates,
+		    CONFIG_RID_FILTER_MAX_PREDICATES, stats.frames, stats.dropped, stats.unmatched);
+
+	return 0;
+}
+
+static int cmd_rid_filter_add(const struct shell *sh, size_t argc, char *argv[])
+{
+	char line[128];
+	int err;
+
+	if (join_args(argc, argv, line, sizeof(line)) < 0) {
+		shell_error(sh, "Rule too long");
+		return -EINVAL;
+	}
+
+	err = rid_filter_add(line);
+	if (err < 0) {
+		shell_error(sh, "%s", err == -ENOMEM ? "No room for the rule" : "Invalid rule");
+	}
+
+	return err;
+}
+
+static int cmd_rid_filter_clear(const struct shell *sh, size_t argc, char *argv[])
+{
+	rid_filter_clear();
+
+	return 0;
+}
+
+static int cmd_rid_filter_reset(const struct shell *sh, size_t argc, char *argv[])
+{
+	rid_filter_reset_stats();
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(rid_filter_cmds,
+	SHELL_CMD_ARG(add, NULL, "Append a rule: accept|drop [<field><op><value> ...]",
+		      cmd_rid_filter_add, 2, 16),
+	SHELL_CMD_ARG(clear, NULL, "Remove every rule", cmd_rid_filter_clear, 1, 0),
+	SHELL_CMD_ARG(reset, NULL, "Zero the hit counters", cmd_rid_filter_reset, 1, 0),
+	SHELL_SUBCMD_SET_END
+);
+#endif /* CONFIG_RID_FILTER */
+
+#if defined(CONFIG_RID_AUTH)
+static int cmd_rid_auth(const struct shell *sh, size_t argc, char *argv[])
+{
+	struct rid_auth_stats stats;
+
+	rid_auth_get_stats(&stats);
+	shell_print(sh, "pages %u repeats %u invalid %u no room %u, slabs %u/%u high-water %u",
+		    stats.pages, stats.repeats, stats.invalid, stats.no_room, stats.slabs_used,
+		    CONFIG_RID_AUTH_SLOTS, stats.slabs_high_water);
+	shell_print(sh, "blobs %u verified %u rejected %u unchecked %u, timed out %u superseded %u",
+		    stats.completed, stats.verified, stats.rejected, stats.unchecked,
+		    stats.timed_out, stats.superseded);
+	shell_print(sh, "reassembly latency avg %u max %u ms", stats.latency_avg_ms,
+		    stats.latency_max_ms);
+
+	return 0;
+}
+#endif /* CONFIG_RID_AUTH */
+
+#if defined(CONFIG_RID_GEOFENCE)
+static int cmd_rid_geofence(const struct shell *sh, size_t argc, char *argv[])
+{
+	struct rid_geofence_stats stats;
+
+	rid_geofence_get_stats(&stats);
+	shell_print(sh, "zones %u (%u wide) vertices %u/%u grid entries %u/%u",
+		    stats.zones, stats.wide_zones, stats.vertices, CONFIG_RID_GEOFENCE_MAX_VERTICES,
+		    stats.cell_entries, CONFIG_RID_GEOFENCE_GRID_ENTRIES);
+	shell_print(sh, "checks %u candidates %u enters %u exits %u breaches %u",
+		    stats.checks, stats.candidates, stats.enters, stats.exits, stats.breaches);
+
+	return 0;
+}
+
+static int cmd_rid_geofence_add(const struct shell *sh, size_t argc, char *argv[])
+{
+	char line[256];
+	int err;
+
+	if (join_args(argc, argv, line, sizeof(line)) < 0) {
+		shell_error(sh, "Zone too long, load it from a file instead");
+		return -EINVAL;
+	}
+
+	err = rid_geofence_add(line);
+	if (err < 0) {
+		shell_error(sh, "%s", err == -ENOMEM ? "No room for the zone" : "Invalid zone");
+	}
+
+	return err;
+}
+
+static int cmd_rid_geofence_clear(const struct shell *sh, size_t argc, char *argv[])
+{
+	rid_geofence_clear();
+
+	return 0;
+}
+
+static void print_zone(const struct rid_geofence_zone_info *zone, void *user)
+{
+	const struct shell *sh = user;
+	char shape[24];
+
+	if (zone->polygon) {
+		snprintf(shape, sizeof(shape), "%u vertices", zone->vertices);
+	} else {
+		snprintf(shape, sizeof(shape), "radius %u m", zone->radius);
+	}
+	shell_print(sh, "%5u %-10s %-14s at %d %d floor %d ceiling %d dm",
+		    zone->id, zone->restricted ? "restricted" : "monitored", shape,
+		    zone->latitude, zone->longitude, zone->floor, zone->ceiling);
+}
+
+static int cmd_rid_geofence_list(const struct shell *sh, size_t argc, char *argv[])
+{
+	rid_geofence_foreach(print_zone, (void *)sh);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(rid_geofence_cmds,
+	SHELL_CMD_ARG(add, NULL, "Add a zone: cylinder|polygon <id> restricted|monitored ...",
+		      cmd_rid_geofence_add, 4, 255),
+	SHELL_CMD_ARG(clear, NULL, "Remove every zone", cmd_rid_geofence_clear, 1, 0),
+	SHELL_CMD_ARG(list, NULL, "List the zones", cmd_rid_geofence_list, 1, 0),
+	SHELL_SUBCMD_SET_END
+);
+#endif /* CONFIG_RID_GEOFENCE */
+
+#if defined(CONFIG_RID_CLOCK)
+/* Show the clock, or set it from the host: "wifi rid clock $(date +%s.%N)". */
+static int cmd_rid_clock(const struct shell *sh, size_t argc, char *argv[])
+{
+	struct rid_clock_stats stats;
+	uint64_t unix_ms;
+
+	if (argc > 1) {
+		char *end;
+		uint64_t ms = strtoull(argv[1], &end, 10) * MSEC_PER_SEC;
+
+		if (*end == '.') {
+			// milliseconds from the first three digits of the fraction
+			for (int scale = 100; scale > 0 && isdigit((unsigned char)*++end); scale /= 10) {
+				ms += (*end - '0') * scale;
+			}
+			while (isdigit((unsigned char)*end)) {
+				end++;
+			}
+		}
+		if (end == argv[1] || *end != '\0' || ms < RID_CLOCK_ODID_EPOCH * (uint64_t)MSEC_PER_SEC) {
+			shell_error(sh, "Expected Unix time in seconds, e.g. 1760700000.250");
+			return -EINVAL;
+		}
+		rid_clock_set(ms, k_uptime_get_32());
+	}
+
+	rid_clock_get_stats(&stats);
+	if (rid_clock_get(k_uptime_get_32(), &unix_ms)) {
+		shell_print(sh, "%llu.%03u Unix time, from the %s", unix_ms / MSEC_PER_SEC,
+			    (uint32_t)(unix_ms % MSEC_PER_SEC), rid_clock_source_txt(stats.source));
+	} else {
+		shell_print(sh, "not set");
+	}
+	shell_print(sh, "steps %u (last %d ms) rejected %u positions ahead %u",
+		    stats.steps, stats.last_step_ms, stats.rejected, stats.ahead);
+
+	return 0;
+}
+#endif /* CONFIG_RID_CLOCK */
+
+#if defined(CONFIG_RID_MOTION)
+static void print_where(const struct rid_track *track, void *user)
+{
+	const struct shell *sh = user;
+	struct rid_motion_estimate est;
+
+	if (!rid_motion_predict(&track->motion, k_uptime_get_32(), &est)) {
+		return;
+	}
+	shell_print(sh, "%02x:%02x:%02x:%02x:%02x:%02x %d %d alt %d dm +-%u/%u m "
+		    "v %d %d %d cm/s, %u ms on",
+		    track->mac[0], track->mac[1], track->mac[2], track->mac[3], track->mac[4],
+		    track->mac[5], est.latitude, est.longitude, est.altitude,
+		    est.horizontal_error_cm / 100, est.vertical_error_cm / 100, est.velocity_east,
+		    est.velocity_north, est.vertical_speed, est.age_ms);
+}
+
+static int cmd_rid_where(const struct shell *sh, size_t argc, char *argv[])
+{
+	rid_track_foreach(print_where, (void *)sh);
+
+	return 0;
+}
+#endif /* CONFIG_RID_MOTION */
+
+SHELL_STATIC_SUBCMD_SET_CREATE(rid_cmds,
+	SHELL_COND_CMD_ARG(CONFIG_RID_STATS, stats, &rid_stats_cmds,
+			   "Per-stage latency percentiles and throughput since the last reset",
+			   cmd_rid_stats, 1, 0),
+	SHELL_COND_CMD_ARG(CONFIG_RID_CAPTURE, capture, &rid_capture_cmds,
+			   "Raw scan result capture", cmd_rid_capture, 1, 0),
+	SHELL_COND_CMD_ARG(CONFIG_RID_FILTER, filter, &rid_filter_cmds,
+			   "Frame filter rules and their hits", cmd_rid_filter, 1, 0),
+	SHELL_COND_CMD_ARG(CONFIG_RID_AUTH, auth, NULL,
+			   "Authentication reassembly and verification counters", cmd_rid_auth, 1, 0),
+	SHELL_COND_CMD_ARG(CONFIG_RID_GEOFENCE, geofence, &rid_geofence_cmds,
+			   "Geofence zones and alert counters", cmd_rid_geofence, 1, 0),
+	SHELL_COND_CMD_ARG(CONFIG_RID_CLOCK, clock, NULL,
+			   "Show the UTC clock, or set it: clock <Unix time>", cmd_rid_clock, 1, 1),
+	SHELL_COND_CMD_ARG(CONFIG_RID_MOTION, where, NULL,
+			   "Where every tracked aircraft is estimated to be now", cmd_rid_where, 1, 0),
+	SHELL_SUBCMD_SET_END
+);
+
+#if defined(CONFIG_NET_L2_WIFI_SHELL)
+// the Wi-Fi shell owns the "wifi" root command and cannot be extended, so stand alone
+SHELL_CMD_REGISTER(rid, &rid_cmds, "Remote ID scanner", NULL);
+#else
+SHELL_STATIC_SUBCMD_SET_CREATE(wifi_cmds,
+	SHELL_CMD(rid, &rid_cmds, "Remote ID scanner", NULL),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(wifi, &wifi_cmds, "Wi-Fi commands", NULL);
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+
+#include "rid_stats.h"
+
+// values 0..3 get a bucket each, then four buckets per power of two up to 2^32
+#define SUB_BITS     2
+#define SUB_BUCKETS  (1 << SUB_BITS)
+#define NUM_BUCKETS  (SUB_BUCKETS + (32 - SUB_BITS) * SUB_BUCKETS)
+
+enum stage_unit {
+	UNIT_CYCLES,
+	UNIT_US,
+	UNIT_MS,
+	UNIT_COUNT,
+};
+
+struct stage_histogram {
+	atomic_t buckets[NUM_BUCKETS];
+	atomic_t max;
+};
+
+static const struct {
+	const char *name;
+	enum stage_unit unit;
+} stage_info[RID_STAGE_COUNT] = {
+	[RID_STAGE_AIR]          = { "air->rx",      UNIT_MS },
+	[RID_STAGE_ENQUEUE]      = { "enqueue",      UNIT_CYCLES },
+	[RID_STAGE_QUEUE]        = { "queue",        UNIT_CYCLES },
+	[RID_STAGE_LOCATE]       = { "locate",       UNIT_CYCLES },
+	[RID_STAGE_FILTER]       = { "filter",       UNIT_CYCLES },
+	[RID_STAGE_DEDUP]        = { "dedup",        UNIT_CYCLES },
+	[RID_STAGE_DECODE]       = { "decode",       UNIT_CYCLES },
+	[RID_STAGE_OUTPUT]       = { "output",       UNIT_CYCLES },
+	[RID_STAGE_TRACK]        = { "track+print",  UNIT_CYCLES },
+	[RID_STAGE_GEOFENCE]     = { "geofence",     UNIT_CYCLES },
+	[RID_STAGE_AUTH]         = { "auth pages",   UNIT_MS },
+	[RID_STAGE_VERIFY]       = { "auth verify",  UNIT_CYCLES },
+	[RID_STAGE_LINK]         = { "rx->link",     UNIT_MS },
+	[RID_STAGE_AIR_LINK]     = { "air->link",    UNIT_MS },
+	[RID_STAGE_ALERT]        = { "alert",        UNIT_MS },
+	[RID_STAGE_AIR_ALERT]    = { "air->alert",   UNIT_MS },
+	[RID_STAGE_SCAN]         = { "scan",         UNIT_US },
+	[RID_STAGE_SCAN_RESULTS] = { "results/scan", UNIT_COUNT },
+	[RID_STAGE_DETECT]       = { "detect",       UNIT_MS },
+};
+
+static struct stage_histogram histograms[RID_STAGE_COUNT];
+static uint32_t cycles_per_us = 1;
+static uint64_t reset_time_us;
+
+static uint32_t bucket_of(uint32_t value)
+{
+	if (value < SUB_BUCKETS) {
+		return value;
+	}
+
+	uint32_t shift = 31 - __builtin_clz(value) - SUB_BITS;
+
+	return SUB_BUCKETS + shift * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+/* Middle of the range of values that land in bucket. */
+static uint32_t bucket_value(uint32_t bucket)
+{
+	if (bucket < SUB_BUCKETS) {
+		return bucket;
+	}
+
+	uint32_t shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+	uint32_t low = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+
+	return low + ((1U << shift) >> 1);
+}
+
+static uint32_t to_unit(enum rid_stage stage, uint32_t value)
+{
+	if (stage_info[stage].unit == UNIT_CYCLES) {
+		return (uint64_t)value * NSEC_PER_USEC / cycles_per_us;
+	}
+
+	return value;
+}
+
+void rid_stats_init(void)
+{
+	rid_cycles_init();
+
+#if defined(CONFIG_ARCH_POSIX)
+	// the host TSC rate is not known up front, so time it against the host clock
+	uint64_t t0 = rid_wall_time_us();
+	uint32_t c0 = rid_cycles_get();
+
+	while (rid_wall_time_us() - t0 < 10 * USEC_PER_MSEC) {
+	}
+	cycles_per_us = MAX((rid_cycles_get() - c0) / (uint32_t)(rid_wall_time_us() - t0), 1U);
+#elif defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+	cycles_per_us = MAX(SystemCoreClock / USEC_PER_SEC, 1U);
+#else
+	cycles_per_us = MAX(sys_clock_hw_cycles_per_sec() / USEC_PER_SEC, 1U);
+#endif
+
+	rid_stats_reset();
+}
+
+void rid_stats_record(enum rid_stage stage, uint32_t value)
+{
+	struct stage_histogram *h = &histograms[stage];
+	atomic_val_t max;
+
+	atomic_inc(&h->buckets[bucket_of(value)]);
+
+	do {
+		max = atomic_get(&h->max);
+	} while ((uint32_t)max < value && !atomic_cas(&h->max, max, value));
+}
+
+void rid_stats_summary(enum rid_stage stage, struct rid_stage_summary *summary)
+{
+	struct stage_histogram *h = &histograms[stage];
+	uint32_t counts[NUM_BUCKETS];
+	uint32_t total = 0;
+
+	// snapshot first, so the percentiles agree with the total even while recording goes on
+	for (int i = 0; i < NUM_BUCKETS; i++) {
+		counts[i] = atomic_get(&h->buckets[i]);
+		total += counts[i];
+	}
+
+	summary->name = stage_info[stage].name;
+	summary->unit = stage_info[stage].unit == UNIT_CYCLES ? "ns" :
+			stage_info[stage].unit == UNIT_US ? "us" :
+			stage_info[stage].unit == UNIT_MS ? "ms" : "";
+	summary->count = total;
+	summary->p50 = 0;
+	summary->p99 = 0;
+	summary->max = to_unit(stage, atomic_get(&h->max));
+
+	uint32_t p50_rank = DIV_ROUND_UP(total * 50ULL, 100);
+	uint32_t p99_rank = DIV_ROUND_UP(total * 99ULL, 100);
+	uint32_t seen = 0;
+
+	for (int i = 0; i < NUM_BUCKETS && seen < p99_rank; i++) {
+		if (counts[i] == 0) {
+			continue;
+		}
+		if (seen < p50_rank && seen + counts[i] >= p50_rank) {
+			summary->p50 = to_unit(stage, bucket_value(i));
+		}
+		seen += counts[i];
+		if (seen >= p99_rank) {
+			summary->p99 = to_unit(stage, bucket_value(i));
+		}
+	}
+
+	// the middle of the top bucket can lie above anything actually recorded
+	summary->p50 = MIN(summary->p50, summary->max);
+	summary->p99 = MIN(summary->p99, summary->max);
+}
+
+uint64_t rid_stats_elapsed_us(void)
+{
+	return rid_wall_time_us() - reset_time_us;
+}
+
+void rid_stats_reset(void)
+{
+	for (int s = 0; s < RID_STAGE_COUNT; s++) {
+		for (int i = 0; i < NUM_BUCKETS; i++) {
+			atomic_clear(&histograms[s].buckets[i]);
+		}
+		atomic_clear(&histograms[s].max);
+	}
+	reset_time_us = rid_wall_time_us();
+}
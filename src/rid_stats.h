@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Per-stage latency histograms
+ *
+ * Every stage of the scan and decode path records its duration into a
+ * log-linear histogram (four buckets per power of two, so percentiles are
+ * within 25%). Buckets are atomic counters: recording is lock-free, takes a
+ * handful of cycles and may happen from any thread.
+ */
+
+#ifndef RID_STATS_H_
+#define RID_STATS_H_
+
+#include <stdint.h>
+
+#include "rid_cycles.h"
+
+enum rid_stage {
+	RID_STAGE_AIR,           // position taken (Location timestamp) to the frame received, in ms
+	RID_STAGE_ENQUEUE,       // net_mgmt callback copying a raw result into the ring
+	RID_STAGE_QUEUE,         // waiting in the ring for the decoder thread
+	RID_STAGE_LOCATE,        // finding the ODID element in a raw frame
+	RID_STAGE_FILTER,        // running a Remote ID frame past the filter rules
+	RID_STAGE_DEDUP,         // looking a Remote ID frame up in the repeated frame cache
+	RID_STAGE_DECODE,        // decoding the message pack
+	RID_STAGE_OUTPUT,        // staging the binary record
+	RID_STAGE_TRACK,         // merging into the track table, including printing its events
+	RID_STAGE_GEOFENCE,      // testing one position against the geofence zones
+	RID_STAGE_AUTH,          // first Authentication page of a blob to the blob complete, in ms
+	RID_STAGE_VERIFY,        // checking a complete authentication blob, on its work queue
+	RID_STAGE_LINK,          // frame received to its record handed to the output backend, in ms
+	RID_STAGE_AIR_LINK,      // position taken to the record of its frame handed to the output backend, in ms
+	RID_STAGE_ALERT,         // frame received to its geofence alert handed to the output backend, in ms
+	RID_STAGE_AIR_ALERT,     // position taken to its geofence alert handed to the output backend, in ms
+	RID_STAGE_SCAN,          // scan request to scan done, in microseconds
+	RID_STAGE_SCAN_RESULTS,  // raw results per scan
+	RID_STAGE_DETECT,        // scanner last stopped listening to the first frame of a new aircraft, in ms
+	RID_STAGE_COUNT,
+};
+
+struct rid_stage_summary {
+	const char *name;
+	const char *unit;    // "ns", "us", "ms" or "" for plain counts
+	uint32_t count;
+	uint32_t p50;
+	uint32_t p99;
+	uint32_t max;
+};
+
+#if defined(CONFIG_RID_STATS)
+
+/* Start the cycle counter and measure its rate. */
+void rid_stats_init(void);
+
+void rid_stats_record(enum rid_stage stage, uint32_t value);
+
+/* Summarize a stage; cycle counts are converted to nanoseconds. */
+void rid_stats_summary(enum rid_stage stage, struct rid_stage_summary *summary);
+
+/* Microseconds since boot or the last rid_stats_reset(). */
+uint64_t rid_stats_elapsed_us(void);
+
+void rid_stats_reset(void);
+
+static inline uint32_t rid_stats_start(void)
+{
+	return rid_cycles_get();
+}
+
+static inline void rid_stats_stop(enum rid_stage stage, uint32_t start)
+{
+	rid_stats_record(stage, rid_cycles_get() - start);
+}
+
+#else
+
+static inline void rid_stats_init(void) {}
+static inline void rid_stats_record(enum rid_stage stage, uint32_t value) {}
+static inline uint32_t rid_stats_start(void) { return 0; }
+static inline void rid_stats_stop(enum rid_stage stage, uint32_t start) {}
+
+#endif /* CONFIG_RID_STATS */
+
+#endif /* RID_STATS_H_ */
@@ -0,0 +1,447 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+
+#include "rid_geo.h"
+#include "rid_track.h"
+
+#define TRACK_NIL     0xFFFF
+#define HASH_SIZE     (4 * CONFIG_RID_TRACK_CAPACITY)
+
+// one lap of the wheel must be longer than the timeout, so a track is never due in a later lap
+#define WHEEL_SLOTS   (CONFIG_RID_TRACK_TIMEOUT_MS / CONFIG_RID_TRACK_WHEEL_TICK_MS + 2)
+
+// 1e-7 degrees of latitude is about 1.1 cm, so one metre is roughly 90 units
+#define MIN_MOVE_E7   (CONFIG_RID_TRACK_MIN_MOVE * 90)
+#define MIN_MOVE_DM   (CONFIG_RID_TRACK_MIN_MOVE * 10)
+
+BUILD_ASSERT(CONFIG_RID_TRACK_CAPACITY < TRACK_NIL, "track indices are 16 bit");
+
+static struct rid_track tracks[CONFIG_RID_TRACK_CAPACITY];
+
+// open-addressed (linear probing) index from MAC hash to track, 0 = empty, else track index + 1
+static uint16_t hash_index[HASH_SIZE];
+
+static uint16_t wheel[WHEEL_SLOTS];
+static uint32_t wheel_tick;
+static bool wheel_started;
+
+static uint16_t free_list;
+static rid_track_event_cb event_cb;
+static struct rid_track_stats stats;
+
+static K_MUTEX_DEFINE(track_lock);
+
+static uint32_t mac_hash(const uint8_t mac[6])
+{
+	uint32_t h = ((uint32_t)mac[2] | (uint32_t)mac[3] << 8 | (uint32_t)mac[4] << 16 |
+		      (uint32_t)mac[5] << 24) ^ ((uint32_t)mac[0] << 8 | mac[1]);
+
+	// Fibonacci hashing spreads the mostly-sequential low bytes of vendor MACs
+	return (h * 2654435761U) % HASH_SIZE;
+}
+
+static void emit(enum rid_track_event event, const struct rid_track *track,
+		 const struct odid_message *msg)
+{
+	stats.events++;
+	if (event_cb != NULL) {
+		event_cb(event, track, msg);
+	}
+}
+
+static void wheel_unlink(uint16_t idx)
+{
+	struct rid_track *t = &tracks[idx];
+
+	if (t->wheel_prev != TRACK_NIL) {
+		tracks[t->wheel_prev].wheel_next = t->wheel_next;
+	} else {
+		wheel[t->wheel_slot] = t->wheel_next;
+	}
+	if (t->wheel_next != TRACK_NIL) {
+		tracks[t->wheel_next].wheel_prev = t->wheel_prev;
+	}
+}
+
+static void wheel_link(uint16_t idx)
+{
+	struct rid_track *t = &tracks[idx];
+	uint32_t deadline = t->last_seen + CONFIG_RID_TRACK_TIMEOUT_MS;
+
+	// round up, so that when the slot's tick comes around the deadline has passed
+	t->wheel_slot = DIV_ROUND_UP(deadline, CONFIG_RID_TRACK_WHEEL_TICK_MS) % WHEEL_SLOTS;
+	t->wheel_prev = TRACK_NIL;
+	t->wheel_next = wheel[t->wheel_slot];
+	if (t->wheel_next != TRACK_NIL) {
+		tracks[t->wheel_next].wheel_prev = idx;
+	}
+	wheel[t->wheel_slot] = idx;
+}
+
+/* The wheel starts turning at the first update or expiry, whichever comes first. */
+static void wheel_start(uint32_t now)
+{
+	if (!wheel_started) {
+		wheel_tick = now / CONFIG_RID_TRACK_WHEEL_TICK_MS;
+		wheel_started = true;
+	}
+}
+
+static int hash_find(const uint8_t mac[6])
+{
+	for (uint32_t i = 0, h = mac_hash(mac); i < HASH_SIZE; i++, h = (h + 1) % HASH_SIZE) {
+		if (hash_index[h] == 0) {
+			return -1;
+		}
+		if (memcmp(tracks[hash_index[h] - 1].mac, mac, 6) == 0) {
+			return h;
+		}
+	}
+
+	return -1;
+}
+
+static void hash_insert(uint16_t idx)
+{
+	uint32_t h = mac_hash(tracks[idx].mac);
+
+	while (hash_index[h] != 0) {
+		h = (h + 1) % HASH_SIZE;
+	}
+	hash_index[h] = idx + 1;
+}
+
+/* Backward-shift deletion keeps probe chains intact without tombstones. */
+static void hash_remove(uint32_t h)
+{
+	uint32_t hole = h;
+
+	hash_index[hole] = 0;
+	for (uint32_t next = (hole + 1) % HASH_SIZE; hash_index[next] != 0; next = (next + 1) % HASH_SIZE) {
+		uint32_t home = mac_hash(tracks[hash_index[next] - 1].mac);
+
+		// move the entry into the hole unless its home slot lies cyclically in (hole, next]
+		if ((next > hole && (home <= hole || home > next)) ||
+		    (next < hole && (home <= hole && home > next))) {
+			hash_index[hole] = hash_index[next];
+			hash_index[next] = 0;
+			hole = next;
+		}
+	}
+}
+
+static void track_free(uint16_t idx, bool evicted)
+{
+	struct rid_track *t = &tracks[idx];
+
+	emit(RID_TRACK_EXPIRED, t, NULL);
+	if (evicted) {
+		stats.evicted++;
+	} else {
+		stats.expired++;
+	}
+	stats.active--;
+
+	wheel_unlink(idx);
+	hash_remove(hash_find(t->mac));
+	t->wheel_next = free_list;
+	free_list = idx;
+}
+
+/* Free the track closest to expiry, i.e. the first one found going around the wheel. */
+static void evict_oldest(void)
+{
+	for (uint32_t i = 1; i <= WHEEL_SLOTS; i++) {
+		uint16_t idx = wheel[(wheel_tick + i) % WHEEL_SLOTS];
+
+		if (idx != TRACK_NIL) {
+			track_free(idx, true);
+			return;
+		}
+	}
+}
+
+static struct rid_track *track_alloc(const uint8_t mac[6], uint32_t now)
+{
+	if (free_list == TRACK_NIL) {
+		evict_oldest();
+	}
+
+	uint16_t idx = free_list;
+	struct rid_track *t = &tracks[idx];
+
+	free_list = t->wheel_next;
+	memset(t, 0, sizeof(*t));
+	memcpy(t->mac, mac, 6);
+	t->first_seen = now;
+	t->last_seen = now;
+
+	hash_insert(idx);
+	wheel_link(idx);
+	stats.created++;
+	stats.active++;
+
+	return t;
+}
+
+static bool moved(const struct rid_track *t, const struct odid_location *loc)
+{
+	// a degree of longitude is cos(latitude) as long as one of latitude
+	int64_t dlon = ((int64_t)loc->longitude - t->reported_longitude) * t->reported_cos_q15 >> 15;
+
+	return abs(loc->latitude - t->reported_latitude) >= MIN_MOVE_E7 ||
+	       llabs(dlon) >= MIN_MOVE_E7 ||
+	       abs(loc->geodetic_altitude - t->reported_altitude) >= MIN_MOVE_DM;
+}
+
+/* Store msg in the track. Returns the event it warrants, or -1 if it is a repeat. */
+static int merge(struct rid_track *t, const struct odid_message *msg)
+{
+	bool first = !(t->seen & BIT(msg->type));
+	bool changed = first;
+
+	switch (msg->type) {
+	case ODID_MSG_BASIC_ID: {
+		const struct odid_basic_id *m = &msg->basic_id;
+
+		changed |= t->id_type != m->id_type || t->ua_type != m->ua_type ||
+			   memcmp(t->uas_id, m->uas_id, ODID_ID_SIZE) != 0;
+		t->id_type = m->id_type;
+		t->ua_type = m->ua_type;
+		memcpy(t->uas_id, m->uas_id, ODID_ID_SIZE);
+		break;
+	}
+	case ODID_MSG_LOCATION:
+		t->location = msg->location;
+		t->seen |= BIT(msg->type);
+		if (!first && !moved(t, &msg->location)) {
+			return -1;
+		}
+		t->reported_latitude = msg->location.latitude;
+		t->reported_longitude = msg->location.longitude;
+		t->reported_altitude = msg->location.geodetic_altitude;
+		t->reported_cos_q15 = rid_geo_cos_q15(msg->location.latitude);
+		return first ? RID_TRACK_CHANGED : RID_TRACK_MOVED;
+	case ODID_MSG_SELF_ID: {
+		const struct odid_self_id *m = &msg->self_id;
+
+		changed |= t->description_type != m->description_type ||
+			   memcmp(t->description, m->description, ODID_STR_SIZE) != 0;
+		t->description_type = m->description_type;
+		memcpy(t->description, m->description, ODID_STR_SIZE);
+		break;
+	}
+	case ODID_MSG_SYSTEM: {
+		// the timestamp ticks every second, so it alone does not count as a change
+		struct odid_system m = msg->system;
+
+		m.timestamp = t->system.timestamp;
+		changed |= memcmp(&t->system, &m, sizeof(m)) != 0;
+		t->system = msg->system;
+		break;
+	}
+	case ODID_MSG_OPERATOR_ID: {
+		const struct odid_operator_id *m = &msg->operator_id;
+
+		changed |= t->operator_id_type != m->id_type ||
+			   memcmp(t->operator_id, m->operator_id, ODID_ID_SIZE) != 0;
+		t->operator_id_type = m->id_type;
+		memcpy(t->operator_id, m->operator_id, ODID_ID_SIZE);
+		break;
+	}
+	default:
+		return -1;
+	}
+
+	t->seen |= BIT(msg->type);
+
+	return changed ? RID_TRACK_CHANGED : -1;
+}
+
+/* Every position counts for the geofence, including the ones merge() treats as repeats. */
+static void geofence_check(struct rid_track *t, const struct odid_message *msg, uint32_t now)
+{
+#if defined(CONFIG_RID_GEOFENCE)
+	if (msg->type == ODID_MSG_LOCATION) {
+		rid_geofence_check(&t->geofence[RID_GEOFENCE_UA], RID_GEOFENCE_UA, t->mac,
+				   msg->location.latitude, msg->location.longitude,
+				   msg->location.geodetic_altitude, now);
+	} else if (msg->type == ODID_MSG_SYSTEM) {
+		rid_geofence_check(&t->geofence[RID_GEOFENCE_OPERATOR], RID_GEOFENCE_OPERATOR, t->mac,
+				   msg->system.operator_latitude, msg->system.operator_longitude,
+				   msg->system.operator_altitude, now);
+	}
+#endif
+}
+
+static void motion_update(struct rid_track *t, const struct odid_message *msg, uint32_t now)
+{
+#if defined(CONFIG_RID_MOTION)
+	if (msg->type == ODID_MSG_LOCATION) {
+		rid_motion_update(&t->motion, &msg->location, now);
+	}
+#endif
+}
+
+/* A Basic ID with a different UAS ID on a known MAC means another aircraft now uses that MAC. */
+static bool identity_changed(const struct rid_track *t, const struct odid_message *msgs, int count)
+{
+	if (!(t->seen & BIT(ODID_MSG_BASIC_ID))) {
+		return false;
+	}
+	for (int i = 0; i < count; i++) {
+		if (msgs[i].type == ODID_MSG_BASIC_ID &&
+		    memcmp(t->uas_id, msgs[i].basic_id.uas_id, ODID_ID_SIZE) != 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void rid_track_init(rid_track_event_cb cb)
+{
+	k_mutex_lock(&track_lock, K_FOREVER);
+
+	memset(hash_index, 0, sizeof(hash_index));
+	memset(&stats, 0, sizeof(stats));
+	for (int i = 0; i < WHEEL_SLOTS; i++) {
+		wheel[i] = TRACK_NIL;
+	}
+	for (int i = 0; i < CONFIG_RID_TRACK_CAPACITY; i++) {
+		tracks[i].wheel_next = (i + 1 < CONFIG_RID_TRACK_CAPACITY) ? i + 1 : TRACK_NIL;
+	}
+	free_list = 0;
+	wheel_started = false;
+	event_cb = cb;
+
+	k_mutex_unlock(&track_lock);
+}
+
+void rid_track_update(const uint8_t mac[6], int8_t rssi, uint16_t frequency,
+		      enum odid_transport transport, const struct odid_message *msgs, int count,
+		      uint32_t now)
+{
+	struct rid_track *t;
+	int h;
+
+	k_mutex_lock(&track_lock, K_FOREVER);
+
+	wheel_start(now);
+	h = hash_find(mac);
+	if (h >= 0 && identity_changed(&tracks[hash_index[h] - 1], msgs, count)) {
+		track_free(hash_index[h] - 1, false);
+		h = -1;
+	}
+
+	if (h < 0) {
+		t = track_alloc(mac, now);
+		emit(RID_TRACK_NEW, t, NULL);
+	} else {
+		uint16_t idx = hash_index[h] - 1;
+
+		t = &tracks[idx];
+		t->last_seen = now;
+		wheel_unlink(idx);
+		wheel_link(idx);
+	}
+
+	t->rssi = rssi;
+	t->frequency = frequency;
+	t->frames++;
+	stats.frames++;
+	stats.frames_over[transport]++;
+	if (!(t->transports & BIT(transport))) {
+		t->transports |= BIT(transport);
+		stats.aircraft_over[transport]++;
+	}
+
+	for (int i = 0; i < count; i++) {
+		int event = merge(t, &msgs[i]);
+
+		geofence_check(t, &msgs[i], now);
+		motion_update(t, &msgs[i], now);
+		if (event >= 0) {
+			emit(event, t, &msgs[i]);
+		} else {
+			stats.suppressed++;
+		}
+	}
+
+	k_mutex_unlock(&track_lock);
+}
+
+void rid_track_expire(uint32_t now)
+{
+	uint32_t now_tick = now / CONFIG_RID_TRACK_WHEEL_TICK_MS;
+
+	k_mutex_lock(&track_lock, K_FOREVER);
+
+	wheel_start(now);
+
+	// after a long gap every slot is due, but each only needs one visit
+	uint32_t ticks = MIN(now_tick - wheel_tick, WHEEL_SLOTS);
+
+	for (uint32_t i = 1; i <= ticks; i++) {
+		uint16_t idx = wheel[(wheel_tick + i) % WHEEL_SLOTS];
+
+		while (idx != TRACK_NIL) {
+			uint16_t next = tracks[idx].wheel_next;
+
+			if ((int32_t)(now - tracks[idx].last_seen) >= CONFIG_RID_TRACK_TIMEOUT_MS) {
+				track_free(idx, false);
+			}
+			idx = next;
+		}
+	}
+	wheel_tick = now_tick;
+
+	k_mutex_unlock(&track_lock);
+}
+
+#if defined(CONFIG_RID_MOTION)
+bool rid_track_where(const uint8_t mac[6], uint32_t now, struct rid_motion_estimate *est)
+{
+	bool found = false;
+
+	k_mutex_lock(&track_lock, K_FOREVER);
+
+	int h = hash_find(mac);
+
+	if (h >= 0) {
+		found = rid_motion_predict(&tracks[hash_index[h] - 1].motion, now, est);
+	}
+
+	k_mutex_unlock(&track_lock);
+
+	return found;
+}
+#endif
+
+void rid_track_foreach(void (*cb)(const struct rid_track *track, void *user), void *user)
+{
+	k_mutex_lock(&track_lock, K_FOREVER);
+
+	for (uint32_t h = 0; h < HASH_SIZE; h++) {
+		if (hash_index[h] != 0) {
+			cb(&tracks[hash_index[h] - 1], user);
+		}
+	}
+
+	k_mutex_unlock(&track_lock);
+}
+
+void rid_track_get_stats(struct rid_track_stats *out)
+{
+	k_mutex_lock(&track_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&track_lock);
+}
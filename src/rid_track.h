@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Per-aircraft track table
+ *
+ * Merges the messages of every received pack into one record per aircraft,
+ * keyed by transmitter MAC and, once a Basic ID has been seen, UAS ID.
+ * Instead of echoing every pack, the table reports deltas: a new aircraft,
+ * a message whose content changed, a position change beyond
+ * CONFIG_RID_TRACK_MIN_MOVE, and expiry after CONFIG_RID_TRACK_TIMEOUT_MS
+ * without a frame. Expiry is driven by a timer wheel, so aging costs nothing
+ * per update. With CONFIG_RID_GEOFENCE every aircraft and operator position
+ * is also run past the geofence zones, repeats included. With
+ * CONFIG_RID_MOTION every track filters its Location messages into an
+ * estimate of where the aircraft is now (see rid_motion.h).
+ */
+
+#ifndef RID_TRACK_H_
+#define RID_TRACK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "odid_decoder.h"
+#include "odid_locate.h"
+#include "rid_geofence.h"
+#include "rid_motion.h"
+
+enum rid_track_event {
+	RID_TRACK_NEW,       // first frame from this aircraft; msg is NULL
+	RID_TRACK_CHANGED,   // msg is a message type seen for the first time or with new content
+	RID_TRACK_MOVED,     // msg is a Location/Vector message beyond the movement threshold
+	RID_TRACK_EXPIRED,   // no frame within the timeout; msg is NULL, track is about to be freed
+};
+
+struct rid_track {
+	uint8_t mac[6];
+	int8_t rssi;                    // of the latest frame
+	uint16_t frequency;             // MHz, of the latest frame
+	uint8_t seen;                   // bit per enum odid_msg_type received so far
+	uint8_t transports;             // bit per enum odid_transport heard over so far
+
+	uint8_t id_type;
+	uint8_t ua_type;
+	uint8_t uas_id[ODID_ID_SIZE];
+	uint8_t description_type;
+	uint8_t description[ODID_STR_SIZE];
+	uint8_t operator_id_type;
+	uint8_t operator_id[ODID_ID_SIZE];
+	struct odid_location location;  // latest Location/Vector message
+	struct odid_system system;      // latest System message
+
+	uint32_t first_seen;            // ms since boot
+	uint32_t last_seen;             // ms since boot
+	uint32_t frames;
+
+	// position last reported with RID_TRACK_MOVED (or RID_TRACK_CHANGED for the first fix)
+	int32_t reported_latitude;
+	int32_t reported_longitude;
+	int32_t reported_altitude;
+	int32_t reported_cos_q15;       // cos(reported_latitude), scales longitude to latitude
+
+#if defined(CONFIG_RID_GEOFENCE)
+	// zones the aircraft and its operator are in
+	struct rid_geofence_state geofence[RID_GEOFENCE_SUBJECT_COUNT];
+#endif
+
+#if defined(CONFIG_RID_MOTION)
+	struct rid_motion motion;
+#endif
+
+	// timer wheel links, indices into the track pool
+	uint16_t wheel_prev;
+	uint16_t wheel_next;
+	uint16_t wheel_slot;
+};
+
+struct rid_track_stats {
+	uint32_t active;
+	uint32_t created;
+	uint32_t expired;
+	uint32_t evicted;    // tracks dropped early to make room for a new aircraft
+	uint32_t frames;     // packs merged
+	uint32_t events;     // events reported
+	uint32_t suppressed; // messages merged without an event (repeats)
+	uint32_t frames_over[ODID_TRANSPORT_COUNT];    // packs merged, by the transport they came over
+	uint32_t aircraft_over[ODID_TRANSPORT_COUNT];  // aircraft heard over each transport at least once
+};
+
+typedef void (*rid_track_event_cb)(enum rid_track_event event, const struct rid_track *track,
+				   const struct odid_message *msg);
+
+void rid_track_init(rid_track_event_cb cb);
+
+/* Merge one decoded pack received from mac over transport at now (ms since boot). */
+void rid_track_update(const uint8_t mac[6], int8_t rssi, uint16_t frequency,
+		      enum odid_transport transport, const struct odid_message *msgs, int count,
+		      uint32_t now);
+
+/* Expire every track not updated within the timeout. Cheap; call it often. */
+void rid_track_expire(uint32_t now);
+
+#if defined(CONFIG_RID_MOTION)
+/* Estimate where the aircraft transmitting from mac is at now (ms since
+ * boot). Returns false if it is not tracked or has not sent a position yet.
+ */
+bool rid_track_where(const uint8_t mac[6], uint32_t now, struct rid_motion_estimate *est);
+#endif
+
+/* Call cb for every active track, with the table locked. */
+void rid_track_foreach(void (*cb)(const struct rid_track *track, void *user), void *user);
+
+void rid_track_get_stats(struct rid_track_stats *stats);
+
+#endif /* RID_TRACK_H_ */